@@ -0,0 +1,125 @@
+#include "src/backends/protocol/otf_message.hh"
+
+#include <benchmark/benchmark.h>
+#include <fmt/format.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "src/backends/protocol/memory_socket.hh"
+
+namespace torchserve {
+namespace {
+// Request and response shapes: batch size, header count, payload bytes.
+void BatchShapes(benchmark::internal::Benchmark* benchmark) {
+  benchmark->ArgNames({"batch", "headers", "payload"})
+      ->ArgsProduct({{1, 8, 32}, {4, 16}, {1 << 10, 64 << 10, 1 << 20}});
+}
+
+// Frontend headers look like "x-header-0: value-0"
+void AddHeaders(std::map<std::string, std::string>& headers,
+                int64_t header_count) {
+  for (int64_t i = 0; i < header_count; ++i) {
+    headers[fmt::format("x-header-{}", i)] = fmt::format("value-{}", i);
+  }
+}
+
+std::vector<char> CreateInferenceFrame(const benchmark::State& state) {
+  InferenceRequestBatch batch;
+  for (int64_t i = 0; i < state.range(0); ++i) {
+    InferenceRequest request;
+    request.request_id = fmt::format("4b5b6c1e-2b1f-4a39-8d0c-{:012}", i);
+    AddHeaders(request.headers, state.range(1));
+    request.headers["body:contentType"] = "application/octet-stream";
+    request.parameters[PayloadType::kPARAMETER_NAME_BODY] =
+        std::vector<char>(state.range(2), 'x');
+    batch.push_back(request);
+  }
+  std::vector<char> frame;
+  OTFMessage::EncodeInferenceRequest(batch, frame);
+  return frame;
+}
+
+std::shared_ptr<InferenceResponseBatch> CreateResponseBatch(
+    const benchmark::State& state) {
+  auto batch = std::make_shared<InferenceResponseBatch>();
+  for (int64_t i = 0; i < state.range(0); ++i) {
+    auto request_id = fmt::format("4b5b6c1e-2b1f-4a39-8d0c-{:012}", i);
+    auto& response = batch->Add(request_id);
+    AddHeaders(response.headers, state.range(1));
+    response.SetResponse(200, "data_type", PayloadType::kDATA_TYPE_BYTES,
+                         std::vector<char>(state.range(2), 'x'));
+  }
+  return batch;
+}
+
+int64_t ResponseBytes(const InferenceResponseBatch& batch) {
+  int64_t bytes = 0;
+  for (const auto& response : batch) {
+    bytes += response.msg.size();
+  }
+  return bytes;
+}
+}  // namespace
+
+static void BM_RetrieveInferenceMsg(benchmark::State& state) {
+  auto frame = CreateInferenceFrame(state);
+  MemorySocket client_socket(frame);
+  for (auto _ : state) {
+    client_socket.Rewind();
+    OTFMessage::RetrieveCmd(client_socket);
+    auto batch = OTFMessage::RetrieveInferenceMsg(client_socket);
+    benchmark::DoNotOptimize(batch);
+  }
+  state.SetBytesProcessed(state.iterations() * frame.size());
+}
+BENCHMARK(BM_RetrieveInferenceMsg)->Apply(BatchShapes);
+
+static void BM_RetrieveInferenceMsgView(benchmark::State& state) {
+  auto frame = CreateInferenceFrame(state);
+  MemorySocket client_socket(frame);
+  for (auto _ : state) {
+    client_socket.Rewind();
+    OTFMessage::RetrieveCmd(client_socket);
+    auto batch = OTFMessage::RetrieveInferenceMsgView(client_socket);
+    benchmark::DoNotOptimize(batch);
+  }
+  state.SetBytesProcessed(state.iterations() * frame.size());
+}
+BENCHMARK(BM_RetrieveInferenceMsgView)->Apply(BatchShapes);
+
+static void BM_EncodeInferenceResponse(benchmark::State& state) {
+  auto batch = CreateResponseBatch(state);
+  for (auto _ : state) {
+    std::vector<char> data_buffer;
+    OTFMessage::EncodeInferenceResponse(batch, data_buffer);
+    benchmark::DoNotOptimize(data_buffer.data());
+  }
+  state.SetBytesProcessed(state.iterations() * ResponseBytes(*batch));
+}
+BENCHMARK(BM_EncodeInferenceResponse)->Apply(BatchShapes);
+
+static void BM_EncodeInferenceResponseIovec(benchmark::State& state) {
+  auto batch = CreateResponseBatch(state);
+  for (auto _ : state) {
+    std::vector<char> framing_buffer;
+    std::vector<iovec> iovecs;
+    OTFMessage::EncodeInferenceResponse(batch, framing_buffer, iovecs);
+    benchmark::DoNotOptimize(iovecs.data());
+  }
+  state.SetBytesProcessed(state.iterations() * ResponseBytes(*batch));
+}
+BENCHMARK(BM_EncodeInferenceResponseIovec)->Apply(BatchShapes);
+
+static void BM_EncodeLoadModelResponse(benchmark::State& state) {
+  std::string message(state.range(0), 'm');
+  for (auto _ : state) {
+    std::vector<char> data_buffer;
+    OTFMessage::EncodeLoadModelResponse(
+        std::make_unique<LoadModelResponse>(200, message), data_buffer);
+    benchmark::DoNotOptimize(data_buffer.data());
+  }
+}
+BENCHMARK(BM_EncodeLoadModelResponse)->ArgName("message")->Arg(32)->Arg(1024);
+}  // namespace torchserve
@@ -1,11 +1,30 @@
 #include "src/backends/core/backend.hh"
 
+#include <algorithm>
+#include <chrono>
 #include <memory>
+#include <sstream>
+#include <thread>
 
 #include "src/backends/handler/handler_factory.hh"
 #include "src/utils/logging.hh"
+#include "src/utils/metrics/registry.hh"
 
 namespace torchserve {
+namespace {
+// Whether at::set_num_threads only resizes the intra-op pool of the calling
+// thread, so that each instance can run with its own thread count. Holds
+// for OpenMP; ATen's native pool is process wide and can not be resized
+// once it started.
+bool HasPerThreadIntraOpPool() {
+#if AT_PARALLEL_OPENMP
+  return true;
+#else
+  return false;
+#endif
+}
+}  // namespace
+
 Backend::Backend() {}
 
 Backend::~Backend() {
@@ -15,18 +34,36 @@ Backend::~Backend() {
   // dl_loader_->CloseDL();
 }
 
-bool Backend::Initialize(const std::string &model_dir) {
+bool Backend::Initialize(const std::string &model_dir,
+                         unsigned int worker_index) {
   random_generator_.seed(time(0));
-  manifest_ = std::make_shared<torchserve::Manifest>();
-  auto manifest_file = fmt::format("{}/MAR-INF/MANIFEST.json", model_dir);
-  // TODO: windows
-  TS_LOGF(DEBUG, "Initializing from manifest: {}", manifest_file);
-  if (!manifest_->Initialize(manifest_file)) {
-    TS_LOGF(ERROR, "Could not initialize from manifest: {}", manifest_file);
+  worker_index_ = worker_index;
+  model_dir_ = model_dir;
+  manifest_ = LoadManifest(model_dir);
+  if (!manifest_) {
     return false;
   }
 
-  LoadHandler(model_dir);
+  instance_selection_ = CreateInstanceSelection(*manifest_);
+  response_cache_ = CreateResponseCache(*manifest_);
+  cpu_sets_ = CreateCpuSets(*manifest_);
+  cpu_instance_count_ = CreateCpuInstanceCount(*manifest_);
+  thread_settings_ = CreateThreadSettings(*manifest_);
+  if (thread_settings_.inter_op_threads > 0) {
+    try {
+      // process wide, and only before the first inter-op parallel work
+      at::set_num_interop_threads(thread_settings_.inter_op_threads);
+    } catch (const c10::Error &e) {
+      TS_LOGF(WARN, "Could not set {} inter-op threads: {}",
+              thread_settings_.inter_op_threads, e.msg());
+    }
+  }
+  if (!HasPerThreadIntraOpPool() && thread_settings_.intra_op_threads > 0) {
+    // same for all instances, see CreateModelInstance
+    at::set_num_threads(thread_settings_.intra_op_threads);
+  }
+
+  handler_ = LoadHandler(model_dir, *manifest_, dl_loader_);
 
   if (!handler_) {
     TS_LOG(ERROR, "Could not load handler");
@@ -38,9 +75,139 @@ bool Backend::Initialize(const std::string &model_dir) {
   return true;
 }
 
-void Backend::LoadHandler(const std::string &model_dir) {
-  const std::string &handler_str = manifest_->GetModel().handler;
-  std::size_t delimiter_pos = handler_str.find(manifest_->kHandler_Delimiter);
+std::shared_ptr<torchserve::Manifest> Backend::LoadManifest(
+    const std::string &model_dir) {
+  auto manifest = std::make_shared<torchserve::Manifest>();
+  auto manifest_file = fmt::format("{}/MAR-INF/MANIFEST.json", model_dir);
+  // TODO: windows
+  TS_LOGF(DEBUG, "Initializing from manifest: {}", manifest_file);
+  if (!manifest->Initialize(manifest_file)) {
+    TS_LOGF(ERROR, "Could not initialize from manifest: {}", manifest_file);
+    return nullptr;
+  }
+  return manifest;
+}
+
+Backend::InstanceSelection Backend::CreateInstanceSelection(
+    torchserve::Manifest &manifest) {
+  const auto &instance_selection = manifest.GetModel().instance_selection;
+  if (instance_selection == "power_of_two") {
+    return InstanceSelection::POWER_OF_TWO;
+  } else if (instance_selection == "round_robin") {
+    return InstanceSelection::ROUND_ROBIN;
+  } else if (!instance_selection.empty() &&
+             instance_selection != "least_outstanding") {
+    TS_LOGF(WARN, "Unknown instance selection {}, using least_outstanding",
+            instance_selection);
+  }
+  return InstanceSelection::LEAST_OUTSTANDING;
+}
+
+std::shared_ptr<ResponseCache> Backend::CreateResponseCache(
+    torchserve::Manifest &manifest) {
+  const auto &model = manifest.GetModel();
+  if (model.response_cache_mb.empty()) {
+    return nullptr;
+  }
+  try {
+    size_t capacity_bytes = std::stoull(model.response_cache_mb) << 20;
+    auto ttl = std::chrono::seconds(
+        model.response_cache_ttl_sec.empty()
+            ? 0
+            : std::stoll(model.response_cache_ttl_sec));
+    if (capacity_bytes > 0) {
+      return std::make_shared<ResponseCache>(
+          model.model_name,
+          fmt::format("{}:{}", model.model_name, model.model_version),
+          capacity_bytes, ttl);
+    }
+  } catch (const std::logic_error &e) {
+    TS_LOGF(ERROR, "Invalid {}: {} or {}: {}, response cache disabled",
+            torchserve::Manifest::kModel_ResponseCacheMb,
+            model.response_cache_mb,
+            torchserve::Manifest::kModel_ResponseCacheTtlSec,
+            model.response_cache_ttl_sec);
+  }
+  return nullptr;
+}
+
+std::vector<CpuAffinity::CpuSet> Backend::CreateCpuSets(
+    torchserve::Manifest &manifest) {
+  const auto &model = manifest.GetModel();
+  std::vector<CpuAffinity::CpuSet> cpu_sets;
+  if (model.cpu_affinity.empty()) {
+    return cpu_sets;
+  }
+  try {
+    if (model.cpu_affinity == "auto") {
+      auto nodes = CpuAffinity::GetNumaNodes();
+      auto instance_count = model.cpu_instances.empty()
+                                ? nodes.size()
+                                : std::stoul(model.cpu_instances);
+      cpu_sets = CpuAffinity::Partition(nodes, instance_count);
+    } else {
+      std::istringstream cpu_lists(model.cpu_affinity);
+      std::string cpu_list;
+      while (std::getline(cpu_lists, cpu_list, ';')) {
+        cpu_sets.push_back(CpuAffinity::ParseCpuList(cpu_list));
+      }
+    }
+  } catch (const std::logic_error &e) {
+    TS_LOGF(ERROR, "Invalid {}: {} or {}: {}, instances are not pinned",
+            torchserve::Manifest::kModel_CpuAffinity, model.cpu_affinity,
+            torchserve::Manifest::kModel_CpuInstances, model.cpu_instances);
+    return {};
+  }
+  for (size_t i = 0; i < cpu_sets.size(); ++i) {
+    TS_LOGF(INFO, "CPU model instance {} of {} runs on cpus {}", i,
+            model.model_name, CpuAffinity::ToCpuList(cpu_sets[i]));
+  }
+  return cpu_sets;
+}
+
+std::size_t Backend::CreateCpuInstanceCount(torchserve::Manifest &manifest) {
+  const auto &model = manifest.GetModel();
+  if (model.cpu_instances.empty()) {
+    return 1;
+  }
+  try {
+    return std::max(1UL, std::stoul(model.cpu_instances));
+  } catch (const std::logic_error &e) {
+    TS_LOGF(ERROR, "Invalid {}: {}, loading one CPU model instance",
+            torchserve::Manifest::kModel_CpuInstances, model.cpu_instances);
+    return 1;
+  }
+}
+
+Backend::ThreadSettings Backend::CreateThreadSettings(
+    torchserve::Manifest &manifest) {
+  const auto &model = manifest.GetModel();
+  ThreadSettings thread_settings;
+  thread_settings.autotune = model.autotune_threads == "true";
+  try {
+    if (!model.intra_op_threads.empty()) {
+      thread_settings.intra_op_threads =
+          std::max(0, std::stoi(model.intra_op_threads));
+    }
+    if (!model.inter_op_threads.empty()) {
+      thread_settings.inter_op_threads =
+          std::max(0, std::stoi(model.inter_op_threads));
+    }
+  } catch (const std::logic_error &e) {
+    TS_LOGF(ERROR, "Invalid {}: {} or {}: {}, using the default threads",
+            torchserve::Manifest::kModel_IntraOpThreads, model.intra_op_threads,
+            torchserve::Manifest::kModel_InterOpThreads,
+            model.inter_op_threads);
+    return {0, 0, thread_settings.autotune};
+  }
+  return thread_settings;
+}
+
+std::shared_ptr<BaseHandler> Backend::LoadHandler(
+    const std::string &model_dir, torchserve::Manifest &manifest,
+    std::unique_ptr<DLLoader<BaseHandler>> &dl_loader) {
+  const std::string &handler_str = manifest.GetModel().handler;
+  std::size_t delimiter_pos = handler_str.find(manifest.kHandler_Delimiter);
   if (delimiter_pos != std::string::npos) {
     TS_LOGF(DEBUG, "Loading custom handler: {}", handler_str);
 #ifdef __APPLE__
@@ -54,26 +221,28 @@ void Backend::LoadHandler(const std::string &model_dir) {
     std::string allocator_func = fmt::format("allocator{}", handler_class_name);
     std::string deleter_func = fmt::format("deleter{}", handler_class_name);
 
-    dl_loader_ = std::make_unique<DLLoader<BaseHandler>>(
+    dl_loader = std::make_unique<DLLoader<BaseHandler>>(
         lib_path, allocator_func, deleter_func);
-    dl_loader_->OpenDL();
-    handler_ = dl_loader_->GetInstance();
-  } else {
-    TS_LOGF(DEBUG, "Creating handler: {}", handler_str);
-    handler_ = HandlerFactory::GetInstance().createHandler(handler_str);
+    dl_loader->OpenDL();
+    return dl_loader->GetInstance();
   }
+  TS_LOGF(DEBUG, "Creating handler: {}", handler_str);
+  return HandlerFactory::GetInstance().createHandler(handler_str);
 }
 
 std::unique_ptr<torchserve::LoadModelResponse> Backend::LoadModel(
     std::shared_ptr<torchserve::LoadModelRequest> load_model_request) {
   /**
-   * TODO:
-   * in multi-thread, this function is called by workers.
-   * - check the model instance status in LoadModel
-   * - status_NOT_INIT: call LoadModelInternal and register the new model
-   * instance
-   * - status_INIT: wait for notification
-   * - status_READY: return the model instance if it is already.
+   * Called by the connection threads of a worker, possibly at the same time.
+   * A request is served by up to GetInstanceCount() instances, told apart by
+   * their ordinal. The instances loaded from an equal request decide:
+   * - fewer than GetInstanceCount() in INIT or READY: load a new instance
+   *   with the lowest free ordinal in LoadModelInternal. Loads run in
+   *   parallel, so N equal requests load N instances in about one load time.
+   * - one READY: share it.
+   * - all INIT: wait until a load in progress completes, then check again.
+   * A request for a model dir holding another version of the model swaps to
+   * that version instead, see SwapModel.
    *
    * Common steps:
    * serve/blob/master/ts/model_loader.py#L62
@@ -82,23 +251,237 @@ std::unique_ptr<torchserve::LoadModelResponse> Backend::LoadModel(
   // TODO: support request envelope:
   // serve/tree/master/ts/torch_handler/request_envelope
 
-  return LoadModelInternal(std::move(load_model_request));
+  std::shared_lock<std::shared_mutex> swap_lock(swap_mutex_);
+  if (IsNewModelVersion(load_model_request->model_dir)) {
+    swap_lock.unlock();
+    return SwapModel(std::move(load_model_request));
+  }
+  std::string model_instance_id;
+  std::size_t ordinal = 0;
+  {
+    std::unique_lock<std::mutex> lock(model_instance_mutex_);
+    while (true) {
+      auto model_instance_ids = FindModelInstanceIds(*load_model_request);
+      if (model_instance_ids.size() < GetInstanceCount(*load_model_request)) {
+        std::vector<bool> taken(model_instance_ids.size() + 1);
+        for (const auto &id : model_instance_ids) {
+          auto taken_ordinal = model_instance_table_[id].ordinal;
+          if (taken_ordinal < taken.size()) {
+            taken[taken_ordinal] = true;
+          }
+        }
+        ordinal = std::find(taken.begin(), taken.end(), false) - taken.begin();
+        break;
+      }
+      auto ready_id = std::find_if(
+          model_instance_ids.begin(), model_instance_ids.end(),
+          [this](const std::string &id) {
+            return model_instance_table_[id].status ==
+                   ModelInstanceStatus::READY;
+          });
+      if (ready_id != model_instance_ids.end()) {
+        TS_LOGF(DEBUG, "Reusing model instance: {}", *ready_id);
+        return std::make_unique<LoadModelResponse>(
+            200,
+            fmt::format("loaded model {}", load_model_request->model_name));
+      }
+      TS_LOGF(DEBUG, "Waiting for {} model instances in INIT",
+              model_instance_ids.size());
+      model_instance_cv_.wait(lock);
+    }
+    // registered as INIT before the lock is released, so that concurrent
+    // loads of an equal request count this one
+    model_instance_id = BuildModelInstanceId(load_model_request);
+    model_instance_table_[model_instance_id] = {
+        ModelInstanceStatus::INIT, std::shared_ptr<ModelInstance>(nullptr),
+        load_model_request, ordinal};
+  }
+  return LoadModelInternal(std::move(load_model_request), model_instance_id,
+                           ordinal);
 }
 
-std::unique_ptr<LoadModelResponse> Backend::LoadModelInternal(
-    std::shared_ptr<LoadModelRequest> load_model_request) {
-  std::string model_instance_id = BuildModelInstanceId(load_model_request);
-  try {
-    model_instance_table_[model_instance_id] = {
-        ModelInstanceStatus::INIT, std::shared_ptr<ModelInstance>(nullptr)};
+std::unique_ptr<torchserve::LoadModelResponse> Backend::SwapModel(
+    std::shared_ptr<torchserve::LoadModelRequest> load_model_request) {
+  // one swap at a time; LoadModel and GetModelInstance go on while the new
+  // version loads, only the final replacement below excludes them
+  std::unique_lock<std::mutex> swap_load_lock(swap_load_mutex_);
+  const auto &model_dir = load_model_request->model_dir;
+  if (model_dir == model_dir_) {
+    // swapped by a concurrent load of the same version
+    swap_load_lock.unlock();
+    return LoadModel(std::move(load_model_request));
+  }
+  auto manifest = LoadManifest(model_dir);
+  if (!manifest) {
+    return std::make_unique<LoadModelResponse>(
+        500, fmt::format("could not read the manifest in {}", model_dir));
+  }
+  // replaces dl_loader_ only once the swap succeeds
+  std::unique_ptr<DLLoader<BaseHandler>> dl_loader;
+  auto handler = LoadHandler(model_dir, *manifest, dl_loader);
+  if (!handler) {
+    return std::make_unique<LoadModelResponse>(
+        500, fmt::format("could not load handler {}",
+                         manifest->GetModel().handler));
+  }
+  handler->Initialize(model_dir, manifest);
+  auto response_cache = CreateResponseCache(*manifest);
+  auto cpu_sets = CreateCpuSets(*manifest);
+  auto cpu_instance_count = CreateCpuInstanceCount(*manifest);
+  auto instance_selection = CreateInstanceSelection(*manifest);
+  // inter-op threads can not change in a running process, the new version
+  // keeps them
+  auto thread_settings = CreateThreadSettings(*manifest);
+
+  // the new version replaces every ready instance of the old one with the
+  // same ordinal, e.g. on other devices, not only the one of this request;
+  // later loads add instances up to the new instance count
+  std::vector<std::pair<std::shared_ptr<LoadModelRequest>, std::size_t>>
+      load_model_requests;
+  {
+    std::lock_guard<std::mutex> lock(model_instance_mutex_);
+    for (const auto &model_instance_id : ready_model_instance_ids_) {
+      const auto &model_instance_info =
+          model_instance_table_[model_instance_id];
+      const auto &old_request = *model_instance_info.load_model_request;
+      load_model_requests.emplace_back(
+          std::make_shared<LoadModelRequest>(
+              model_dir, old_request.model_name, old_request.gpu_id,
+              old_request.handler, old_request.envelope,
+              old_request.batch_size, old_request.limit_max_image_pixels),
+          model_instance_info.ordinal);
+    }
+  }
+  if (std::none_of(load_model_requests.begin(), load_model_requests.end(),
+                   [&load_model_request](auto &request) {
+                     return *request.first == *load_model_request;
+                   })) {
+    load_model_requests.emplace_back(load_model_request, 0);
+  }
 
-    auto result = handler_->LoadModel(load_model_request);
-    SetModelInstanceInfo(model_instance_id, ModelInstanceStatus::READY,
-                         std::make_shared<ModelInstance>(
-                             model_instance_id, std::move(result.first),
-                             handler_, std::move(result.second)));
+  // loaded and warmed up while the old version keeps serving
+  std::map<std::string, ModelInstanceInfo> model_instance_table;
+  std::vector<std::string> ready_model_instance_ids;
+  for (auto &[request, ordinal] : load_model_requests) {
+    auto model_instance_id = BuildModelInstanceId(request);
+    CpuAffinity::CpuSet cpus;
+    if (request->gpu_id < 0 && !cpu_sets.empty()) {
+      cpus = cpu_sets[GetCpuSetIndex(ordinal, cpu_instance_count) %
+                      cpu_sets.size()];
+    }
+    try {
+      model_instance_table[model_instance_id] = {
+          ModelInstanceStatus::READY,
+          CreateModelInstance(handler, model_instance_id, request,
+                              response_cache, cpus, thread_settings,
+                              cpu_instance_count),
+          request, ordinal};
+      ready_model_instance_ids.push_back(model_instance_id);
+    } catch (const c10::Error &e) {
+      TS_LOGF(ERROR, "Error during model loading, keeping the old version: {}",
+              e.what());
+      return std::make_unique<LoadModelResponse>(500, e.msg());
+    } catch (const std::exception &e) {
+      TS_LOGF(ERROR, "Error during model loading, keeping the old version: {}",
+              e.what());
+      return std::make_unique<LoadModelResponse>(500, e.what());
+    }
+  }
+
+  {
+    // waits for the loads of the old version in progress; instances they
+    // add are replaced as well, their connections are served by the new ones
+    std::unique_lock<std::shared_mutex> swap_lock(swap_mutex_);
+    std::lock_guard<std::mutex> lock(model_instance_mutex_);
+    TS_LOGF(INFO, "Swapping model {} version {} to version {} in {}",
+            manifest_->GetModel().model_name,
+            manifest_->GetModel().model_version,
+            manifest->GetModel().model_version, model_dir);
+    model_dir_ = model_dir;
+    manifest_ = std::move(manifest);
+    handler_ = std::move(handler);
+    if (dl_loader) {
+      // the old library stays open for the old instances still running
+      dl_loader_ = std::move(dl_loader);
+    }
+    response_cache_ = std::move(response_cache);
+    cpu_sets_ = std::move(cpu_sets);
+    cpu_instance_count_ = cpu_instance_count;
+    thread_settings_ = thread_settings;
+    model_instance_table_.swap(model_instance_table);
+    ready_model_instance_ids_.swap(ready_model_instance_ids);
+    instance_selection_ = instance_selection;
+    round_robin_index_ = 0;
+  }
+  model_instance_cv_.notify_all();
+  // the old instances are released with model_instance_table here, or by the
+  // last batch still running on them
+  return std::make_unique<LoadModelResponse>(
+      200, fmt::format("loaded model {}", load_model_request->model_name));
+}
+
+bool Backend::IsNewModelVersion(const std::string &model_dir) {
+  if (model_dir == model_dir_) {
+    return false;
+  }
+  auto manifest_file = fmt::format("{}/MAR-INF/MANIFEST.json", model_dir);
+  torchserve::Manifest manifest;
+  if (!std::filesystem::exists(manifest_file) ||
+      !manifest.Initialize(manifest_file)) {
+    return false;
+  }
+  return manifest.GetModel().model_version !=
+         manifest_->GetModel().model_version;
+}
+
+std::vector<std::string> Backend::FindModelInstanceIds(
+    const torchserve::LoadModelRequest &load_model_request) {
+  std::vector<std::string> model_instance_ids;
+  for (const auto &[model_instance_id, model_instance_info] :
+       model_instance_table_) {
+    if ((model_instance_info.status == ModelInstanceStatus::READY ||
+         model_instance_info.status == ModelInstanceStatus::INIT) &&
+        model_instance_info.load_model_request &&
+        *model_instance_info.load_model_request == load_model_request) {
+      model_instance_ids.push_back(model_instance_id);
+    }
+  }
+  return model_instance_ids;
+}
+
+std::size_t Backend::GetInstanceCount(
+    const torchserve::LoadModelRequest &load_model_request) const {
+  return load_model_request.gpu_id < 0 ? cpu_instance_count_ : 1;
+}
+
+std::size_t Backend::GetCpuSetIndex(std::size_t ordinal,
+                                    std::size_t cpu_instance_count) const {
+  return worker_index_ * cpu_instance_count + ordinal;
+}
 
-    ready_model_instance_ids_.emplace_back(model_instance_id);
+std::unique_ptr<LoadModelResponse> Backend::LoadModelInternal(
+    std::shared_ptr<LoadModelRequest> load_model_request,
+    const std::string &model_instance_id, std::size_t ordinal) {
+  CpuAffinity::CpuSet cpus;
+  if (load_model_request->gpu_id < 0 && !cpu_sets_.empty()) {
+    // each ordinal keeps its cpus, also when it is reloaded after a failure
+    cpus = cpu_sets_[GetCpuSetIndex(ordinal, cpu_instance_count_) %
+                     cpu_sets_.size()];
+  }
+  try {
+    // handler_, response_cache_, cpu_sets_ and thread_settings_ only change
+    // in SwapModel, which waits for this load
+    auto model_instance = CreateModelInstance(
+        handler_, model_instance_id, load_model_request, response_cache_,
+        std::move(cpus), thread_settings_, cpu_instance_count_);
+    {
+      std::lock_guard<std::mutex> lock(model_instance_mutex_);
+      auto &model_instance_info = model_instance_table_[model_instance_id];
+      model_instance_info.status = ModelInstanceStatus::READY;
+      model_instance_info.model_instance = std::move(model_instance);
+      ready_model_instance_ids_.emplace_back(model_instance_id);
+    }
+    model_instance_cv_.notify_all();
     std::string message =
         fmt::format("loaded model {}", load_model_request->model_name);
     return std::make_unique<LoadModelResponse>(
@@ -108,12 +491,86 @@ std::unique_ptr<LoadModelResponse> Backend::LoadModelInternal(
     TS_LOGF(ERROR, "Error during model loading: {}", e.what());
     SetModelInstanceInfo(model_instance_id, ModelInstanceStatus::FAILED,
                          std::shared_ptr<ModelInstance>(nullptr));
+    model_instance_cv_.notify_all();
     return std::make_unique<LoadModelResponse>(
         // TODO: check existing
         500, e.msg());
+  } catch (const std::exception &e) {
+    // waiters must not be left behind an instance stuck in INIT
+    TS_LOGF(ERROR, "Error during model loading: {}", e.what());
+    SetModelInstanceInfo(model_instance_id, ModelInstanceStatus::FAILED,
+                         std::shared_ptr<ModelInstance>(nullptr));
+    model_instance_cv_.notify_all();
+    return std::make_unique<LoadModelResponse>(500, e.what());
   }
 }
 
+std::shared_ptr<ModelInstance> Backend::CreateModelInstance(
+    std::shared_ptr<BaseHandler> &handler, const std::string &model_instance_id,
+    std::shared_ptr<LoadModelRequest> &load_model_request,
+    std::shared_ptr<ResponseCache> response_cache, CpuAffinity::CpuSet cpus,
+    const ThreadSettings &thread_settings, std::size_t cpu_instance_count) {
+  // weights are allocated on the node of cpus by first touch
+  ScopedCpuAffinity cpu_affinity(cpus);
+  std::pair<std::shared_ptr<void>, std::shared_ptr<torch::Device>> result;
+  {
+    std::shared_lock<std::shared_mutex> tuning_lock(tuning_mutex_);
+    if (handler->IsLoadModelThreadSafe()) {
+      result = handler->LoadModel(load_model_request);
+    } else {
+      std::lock_guard<std::mutex> handler_lock(handler_load_mutex_);
+      result = handler->LoadModel(load_model_request);
+    }
+    // before READY, so that no batch is dispatched to a cold instance
+    handler->Warmup(result.first, result.second, load_model_request);
+  }
+
+  int intra_op_threads = thread_settings.intra_op_threads;
+  if (!HasPerThreadIntraOpPool()) {
+    // a single pool for all instances, set in Initialize if at all
+    if (thread_settings.autotune) {
+      TS_LOGF(WARN,
+              "Not tuning the intra-op threads of model instance {}, the "
+              "intra-op pool is not per thread: {}",
+              model_instance_id, at::get_parallel_info());
+    }
+    intra_op_threads = 0;
+  } else if (intra_op_threads == 0 && load_model_request->gpu_id < 0) {
+    // one thread per core the instance is pinned to, e.g. its NUMA node;
+    // tuning an unpinned instance tries up to its share of the host's cores
+    int max_threads = static_cast<int>(cpus.size());
+    if (max_threads == 0 && thread_settings.autotune) {
+      max_threads = std::max<int>(
+          1, std::thread::hardware_concurrency() / cpu_instance_count);
+    }
+    intra_op_threads = max_threads;
+    if (thread_settings.autotune) {
+      std::vector<int> candidates;
+      for (int threads = 1; threads < max_threads; threads *= 2) {
+        candidates.push_back(threads);
+      }
+      candidates.push_back(max_threads);
+      // timed alone, not while other instances load or tune
+      std::unique_lock<std::shared_mutex> tuning_lock(tuning_mutex_);
+      int previous_threads = at::get_num_threads();
+      int tuned_threads = handler->TuneIntraOpThreads(
+          result.first, result.second, load_model_request, candidates);
+      at::set_num_threads(previous_threads);
+      if (tuned_threads > 0) {
+        intra_op_threads = tuned_threads;
+      }
+    }
+  }
+  if (intra_op_threads > 0) {
+    TS_LOGF(INFO, "Model instance {} uses {} intra-op threads",
+            model_instance_id, intra_op_threads);
+  }
+  return std::make_shared<ModelInstance>(
+      model_instance_id, std::move(result.first), handler,
+      std::move(result.second), std::move(response_cache), std::move(cpus),
+      intra_op_threads);
+}
+
 std::string Backend::BuildModelInstanceId(
     std::shared_ptr<torchserve::LoadModelRequest> load_model_request) {
   std::string device_type("cpu");
@@ -127,6 +584,7 @@ std::string Backend::BuildModelInstanceId(
 void Backend::SetModelInstanceInfo(
     const std::string &model_instance_id, ModelInstanceStatus new_status,
     std::shared_ptr<torchserve::ModelInstance> new_model_instance) {
+  std::lock_guard<std::mutex> lock(model_instance_mutex_);
   model_instance_table_[model_instance_id].status = new_status;
   model_instance_table_[model_instance_id].model_instance =
       std::move(new_model_instance);
@@ -134,6 +592,7 @@ void Backend::SetModelInstanceInfo(
 
 torchserve::Backend::ModelInstanceStatus Backend::GetModelInstanceStatus(
     const std::string &model_instance_id) {
+  std::lock_guard<std::mutex> lock(model_instance_mutex_);
   auto model_instance_info = model_instance_table_.find(model_instance_id);
   if (model_instance_info == model_instance_table_.end()) {
     return torchserve::Backend::ModelInstanceStatus::NOT_INIT;
@@ -143,6 +602,7 @@ torchserve::Backend::ModelInstanceStatus Backend::GetModelInstanceStatus(
 
 std::shared_ptr<torchserve::ModelInstance> Backend::GetModelInstance(
     const std::string &model_instance_id) {
+  std::lock_guard<std::mutex> lock(model_instance_mutex_);
   auto model_instance_info = model_instance_table_.find(model_instance_id);
   if (model_instance_info == model_instance_table_.end()) {
     return std::shared_ptr<torchserve::ModelInstance>(nullptr);
@@ -151,13 +611,69 @@ std::shared_ptr<torchserve::ModelInstance> Backend::GetModelInstance(
 }
 
 std::shared_ptr<torchserve::ModelInstance> Backend::GetModelInstance() {
-  if (ready_model_instance_ids_.empty()) {
-    return std::shared_ptr<torchserve::ModelInstance>(nullptr);
+  std::shared_ptr<torchserve::ModelInstance> model_instance;
+  std::shared_ptr<torchserve::Manifest> manifest;
+  uint32_t in_flight = 0;
+  {
+    std::lock_guard<std::mutex> lock(model_instance_mutex_);
+    if (ready_model_instance_ids_.empty()) {
+      return std::shared_ptr<torchserve::ModelInstance>(nullptr);
+    }
+    model_instance =
+        model_instance_table_[ready_model_instance_ids_
+                                  [SelectReadyModelInstance()]]
+            .model_instance;
+    // counted under the lock so that concurrent callers see each other's
+    // choices
+    in_flight = ++model_instance->in_flight_;
+    // manifest_ may be swapped once the lock is released
+    manifest = manifest_;
   }
+  const auto &model_name = manifest->GetModel().model_name;
+  RecordInFlight(model_name, *model_instance, in_flight);
 
-  auto model_instance_info =
-      model_instance_table_.find(ready_model_instance_ids_[Random()]);
-  return model_instance_info->second.model_instance;
+  // the returned pointer shares ownership with model_instance and ends the
+  // in-flight count when the last copy is released
+  return std::shared_ptr<torchserve::ModelInstance>(
+      model_instance.get(),
+      [model_instance, model_name](torchserve::ModelInstance *) {
+        RecordInFlight(model_name, *model_instance,
+                       --model_instance->in_flight_);
+      });
+}
+
+std::size_t Backend::SelectReadyModelInstance() {
+  auto size = ready_model_instance_ids_.size();
+  if (size == 1) {
+    return 0;
+  }
+  auto in_flight = [this](std::size_t index) {
+    return model_instance_table_[ready_model_instance_ids_[index]]
+        .model_instance->GetInFlight();
+  };
+  switch (instance_selection_) {
+    case InstanceSelection::ROUND_ROBIN:
+      return round_robin_index_++ % size;
+    case InstanceSelection::POWER_OF_TWO: {
+      // two distinct random candidates, the less loaded one wins
+      auto first = Random();
+      auto second = (first + 1 + Random() % (size - 1)) % size;
+      return in_flight(second) < in_flight(first) ? second : first;
+    }
+    case InstanceSelection::LEAST_OUTSTANDING:
+    default: {
+      // ties go round robin so that idle instances share the load
+      std::size_t start = round_robin_index_++ % size;
+      std::size_t selected = start;
+      for (std::size_t i = 1; i < size; ++i) {
+        std::size_t candidate = (start + i) % size;
+        if (in_flight(candidate) < in_flight(selected)) {
+          selected = candidate;
+        }
+      }
+      return selected;
+    }
+  }
 }
 
 std::size_t Backend::Random() {
@@ -169,4 +685,22 @@ std::size_t Backend::Random() {
     return uint_distribution_(random_generator_);
   }
 }
+
+void Backend::RecordInFlight(const std::string &model_name,
+                             const ModelInstance &model_instance,
+                             uint32_t in_flight) {
+  try {
+    auto &in_flight_metric =
+        torchserve::MetricsRegistry::GetMetricsCacheInstance()->GetMetric(
+            torchserve::MetricType::GAUGE, "InstanceInFlight");
+    in_flight_metric.AddOrUpdate(
+        std::vector<std::string>{model_name, model_instance.GetInstanceId()},
+        in_flight);
+  } catch (std::runtime_error &e) {
+    TS_LOG(DEBUG, e.what());
+  } catch (std::invalid_argument &e) {
+    // not every metrics config defines this metric, don't flood the log
+    TS_LOGF(DEBUG, "Failed to record InstanceInFlight metric. {}", e.what());
+  }
+}
 }  // namespace torchserve
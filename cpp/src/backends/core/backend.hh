@@ -1,10 +1,13 @@
 #pragma once
 
 #include <atomic>
+#include <condition_variable>
 #include <filesystem>
 #include <memory>
+#include <mutex>
 #include <queue>
 #include <random>
+#include <shared_mutex>
 #include <stdexcept>
 #include <tuple>
 #include <unordered_map>
@@ -36,25 +39,62 @@ class Backend {
  public:
   enum ModelInstanceStatus { NOT_INIT, INIT, READY, FAILED };
 
+  // Policy of GetModelInstance(), set per model by the manifest's
+  // "instanceSelection": "least_outstanding" (default), "power_of_two" or
+  // "round_robin".
+  enum class InstanceSelection { LEAST_OUTSTANDING, POWER_OF_TWO, ROUND_ROBIN };
+
   // NOLINTBEGIN(cppcoreguidelines-pro-type-member-init)
   struct ModelInstanceInfo {
     ModelInstanceStatus status;
     std::shared_ptr<ModelInstance> model_instance;
+    std::shared_ptr<LoadModelRequest> load_model_request;
+    // tells apart the instances loaded from equal requests, from 0
+    std::size_t ordinal;
   };
   // NOLINTEND(cppcoreguidelines-pro-type-member-init)
 
+  // Threads of the model instances by the manifest, 0 for the libtorch
+  // default.
+  struct ThreadSettings {
+    int intra_op_threads = 0;
+    int inter_op_threads = 0;
+    bool autotune = false;
+  };
+
   Backend();
   virtual ~Backend();
 
-  bool Initialize(const std::string &model_dir);
+  // worker_index tells apart the worker processes of the model on the host,
+  // e.g. 0 to N-1 for N workers, so that their CPU instances are pinned to
+  // different cpu sets.
+  bool Initialize(const std::string &model_dir, unsigned int worker_index = 0);
 
   ModelInstanceStatus GetModelInstanceStatus(
       const std::string &model_instance_id);
 
   std::shared_ptr<torchserve::ModelInstance> GetModelInstance(
       const std::string &model_instance_id);
+
+  /**
+   * @brief
+   * Picks a ready model instance for a batch by the InstanceSelection
+   * policy. The instance counts as in flight (ModelInstance::GetInFlight)
+   * until the returned pointer and all of its copies are released, so
+   * callers hold it for the duration of the batch only.
+   * Returns nullptr if no instance is ready.
+   */
   std::shared_ptr<torchserve::ModelInstance> GetModelInstance();
 
+  // See BaseHandler::KeepsConnectionState.
+  bool KeepsConnectionState() const {
+    return handler_ && handler_->KeepsConnectionState();
+  }
+
+  InstanceSelection GetInstanceSelection() const {
+    return instance_selection_;
+  }
+
   void SetModelInstanceInfo(const std::string &model_instance_id,
                             ModelInstanceStatus new_status,
                             std::shared_ptr<ModelInstance> new_model_instance);
@@ -62,15 +102,88 @@ class Backend {
   std::unique_ptr<torchserve::LoadModelResponse> LoadModel(
       std::shared_ptr<torchserve::LoadModelRequest> load_model_request);
 
+  /**
+   * @brief
+   * Swaps the served model to the archive in load_model_request's model_dir,
+   * e.g. a new version, without stopping to serve. The new version is
+   * loaded and warmed up next to the old one, for this request and for the
+   * load request of every ready instance of the old version. Then the model
+   * instances are replaced at once. Batches already dispatched to an old
+   * instance complete on it, and the instance is released after its last
+   * batch. If a load fails, the old version stays in place.
+   * Same as LoadModel if model_dir is already served.
+   */
+  std::unique_ptr<torchserve::LoadModelResponse> SwapModel(
+      std::shared_ptr<torchserve::LoadModelRequest> load_model_request);
+
  protected:
   std::string BuildModelInstanceId(
       std::shared_ptr<torchserve::LoadModelRequest> load_model_request);
 
-  void LoadHandler(const std::string &model_dir);
+  // Returns nullptr if model_dir has no valid manifest.
+  static std::shared_ptr<torchserve::Manifest> LoadManifest(
+      const std::string &model_dir);
 
-  std::unique_ptr<torchserve::LoadModelResponse> LoadModelInternal(
-      std::shared_ptr<torchserve::LoadModelRequest> load_model_request);
+  // Sets dl_loader if the handler comes from a library in model_dir.
+  static std::shared_ptr<BaseHandler> LoadHandler(
+      const std::string &model_dir, torchserve::Manifest &manifest,
+      std::unique_ptr<DLLoader<BaseHandler>> &dl_loader);
 
+  static InstanceSelection CreateInstanceSelection(
+      torchserve::Manifest &manifest);
+
+  // Returns nullptr unless the manifest sets a responseCacheMb.
+  static std::shared_ptr<ResponseCache> CreateResponseCache(
+      torchserve::Manifest &manifest);
+
+  // Returns the cpus of each CPU model instance by the manifest's
+  // cpuAffinity, empty if they are not pinned.
+  static std::vector<CpuAffinity::CpuSet> CreateCpuSets(
+      torchserve::Manifest &manifest);
+
+  // Returns the number of CPU model instances by the manifest's
+  // cpuInstances, 1 by default.
+  static std::size_t CreateCpuInstanceCount(torchserve::Manifest &manifest);
+
+  static ThreadSettings CreateThreadSettings(torchserve::Manifest &manifest);
+
+  // Loads and warms up a model instance on handler, pinned to cpus if any,
+  // and picks its intra-op thread count. An unpinned instance is tuned up to
+  // its share of the cores among cpu_instance_count instances.
+  std::shared_ptr<ModelInstance> CreateModelInstance(
+      std::shared_ptr<BaseHandler> &handler,
+      const std::string &model_instance_id,
+      std::shared_ptr<LoadModelRequest> &load_model_request,
+      std::shared_ptr<ResponseCache> response_cache, CpuAffinity::CpuSet cpus,
+      const ThreadSettings &thread_settings, std::size_t cpu_instance_count);
+
+  // Whether model_dir holds another version of the model than the served
+  // one. Requires swap_mutex_ or swap_load_mutex_.
+  bool IsNewModelVersion(const std::string &model_dir);
+
+  // Loads the instance that LoadModel registered as INIT.
+  std::unique_ptr<torchserve::LoadModelResponse> LoadModelInternal(
+      std::shared_ptr<torchserve::LoadModelRequest> load_model_request,
+      const std::string &model_instance_id, std::size_t ordinal);
+
+  // Returns the ids of the READY or INIT model instances loaded from an
+  // equal request. Requires model_instance_mutex_.
+  std::vector<std::string> FindModelInstanceIds(
+      const torchserve::LoadModelRequest &load_model_request);
+
+  // Index in the cpu sets of the CPU instance with ordinal, before wrapping
+  // around: the instances of worker i take the sets after those of workers 0
+  // to i-1.
+  std::size_t GetCpuSetIndex(std::size_t ordinal,
+                             std::size_t cpu_instance_count) const;
+
+  // Number of instances that serve equal requests: cpuInstances on CPU, one
+  // per GPU.
+  std::size_t GetInstanceCount(
+      const torchserve::LoadModelRequest &load_model_request) const;
+
+  // archive of the served model version
+  std::string model_dir_;
   std::shared_ptr<torchserve::Manifest> manifest_;
 
   // key: model_instance_id
@@ -83,8 +196,45 @@ class Backend {
 
   std::unique_ptr<DLLoader<BaseHandler>> dl_loader_;
   std::shared_ptr<BaseHandler> handler_;
-
+  // shared by all model instances, nullptr if disabled
+  std::shared_ptr<ResponseCache> response_cache_;
+  // cpus of the CPU model instances of all workers, see GetCpuSetIndex
+  std::vector<CpuAffinity::CpuSet> cpu_sets_;
+  unsigned int worker_index_ = 0;
+  std::size_t cpu_instance_count_ = 1;
+  ThreadSettings thread_settings_;
+
+  // Returns the index in ready_model_instance_ids_ of the instance to use.
+  std::size_t SelectReadyModelInstance();
   std::size_t Random();
+  // Called when a lease of GetModelInstance() is taken and when it is
+  // released, so that the gauge follows the count both ways.
+  static void RecordInFlight(const std::string &model_name,
+                             const ModelInstance &model_instance,
+                             uint32_t in_flight);
+
+  InstanceSelection instance_selection_ = InstanceSelection::LEAST_OUTSTANDING;
+  std::size_t round_robin_index_ = 0;
   std::mt19937 random_generator_;
+
+  // guards model_instance_table_, ready_model_instance_ids_,
+  // round_robin_index_ and random_generator_, which are shared by all
+  // connection threads
+  std::mutex model_instance_mutex_;
+  // notified when a model instance leaves INIT
+  std::condition_variable model_instance_cv_;
+  // serializes handler_->LoadModel unless the handler allows concurrent loads
+  std::mutex handler_load_mutex_;
+  // held shared while an instance loads and warms up, and exclusively while
+  // one tunes its intra-op threads
+  std::shared_mutex tuning_mutex_;
+  // held shared by LoadModel and exclusively by SwapModel while it replaces
+  // model_dir_, manifest_, dl_loader_, handler_, response_cache_, cpu_sets_,
+  // cpu_instance_count_, thread_settings_, instance_selection_ and the model
+  // instances, under model_instance_mutex_ as well
+  std::shared_mutex swap_mutex_;
+  // held by SwapModel while it loads the new version, so that swaps do not
+  // overlap
+  std::mutex swap_load_mutex_;
 };
 }  // namespace torchserve
@@ -0,0 +1,164 @@
+#include "batch_aggregator.hh"
+
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+#include <vector>
+
+namespace torchserve {
+bool BatchAggregator::Predict(
+    std::shared_ptr<torchserve::InferenceRequestViewBatch> request_batch,
+    std::shared_ptr<torchserve::InferenceResponseBatch>& response_batch,
+    const IntermediateResponseSender& intermediate_response_sender) {
+  if (!response_batch) {
+    response_batch = std::make_shared<torchserve::InferenceResponseBatch>();
+  }
+  auto submission = std::make_shared<Submission>();
+  submission->request_batch = std::move(request_batch);
+  submission->response_batch = response_batch;
+  submission->intermediate_response_sender =
+      intermediate_response_sender ? &intermediate_response_sender : nullptr;
+  submission->deadline = std::chrono::steady_clock::now() + max_batch_delay_;
+
+  std::unique_lock<std::mutex> lock(mutex_);
+  queue_.push_back(submission);
+  queued_requests_ += submission->request_batch->requests.size();
+  cv_.notify_all();
+  while (!submission->done) {
+    if (forming_ || !submission->queued) {
+      // another caller forms the next batch, or runs the one with ours. A
+      // caller whose batch is running leaves the queue to the callers
+      // still in it, so that it can return as soon as its batch is done.
+      cv_.wait(lock);
+      continue;
+    }
+
+    // only the forming caller takes from the queue, so its head stays
+    forming_ = true;
+    cv_.wait_until(lock, queue_.front()->deadline,
+                   [this]() { return queued_requests_ >= batch_size_; });
+    auto batch = TakeBatch();
+    forming_ = false;
+    cv_.notify_all();
+
+    lock.unlock();
+    RunBatch(batch);
+    lock.lock();
+    for (auto& batch_submission : batch) {
+      batch_submission->done = true;
+    }
+    cv_.notify_all();
+  }
+  return submission->predicted;
+}
+
+std::vector<std::shared_ptr<BatchAggregator::Submission>>
+BatchAggregator::TakeBatch() {
+  std::vector<std::shared_ptr<Submission>> batch;
+  std::unordered_set<std::string_view> request_ids;
+  size_t requests = 0;
+  for (auto it = queue_.begin(); it != queue_.end();) {
+    size_t size = (*it)->request_batch->requests.size();
+    if (!batch.empty() && requests + size > batch_size_) {
+      break;
+    }
+    bool collides = false;
+    for (const auto& request : (*it)->request_batch->requests) {
+      collides = collides || request_ids.count(request.request_id) > 0;
+    }
+    if (collides) {
+      ++it;
+      continue;
+    }
+    for (const auto& request : (*it)->request_batch->requests) {
+      request_ids.insert(request.request_id);
+    }
+    requests += size;
+    (*it)->queued = false;
+    batch.push_back(*it);
+    it = queue_.erase(it);
+  }
+  queued_requests_ -= requests;
+  return batch;
+}
+
+void BatchAggregator::RunBatch(
+    const std::vector<std::shared_ptr<Submission>>& batch) {
+  auto model_instance = model_instance_provider_();
+  if (!model_instance) {
+    return;
+  }
+  if (batch.size() == 1) {
+    const auto* sender = batch[0]->intermediate_response_sender;
+    model_instance->Predict(std::move(batch[0]->request_batch),
+                            batch[0]->response_batch,
+                            sender ? *sender : IntermediateResponseSender());
+    batch[0]->predicted = true;
+    return;
+  }
+
+  // the views of the merged batch point into the batches of the submissions,
+  // e.g. their arenas or shared memory, which it keeps alive until Predict
+  // returns
+  auto merged_batch = std::make_shared<torchserve::InferenceRequestViewBatch>();
+  // by index in the merged batch, the submission of a request and its index
+  // there
+  std::vector<std::pair<Submission*, size_t>> placements;
+  std::unordered_map<std::string_view, Submission*> owners;
+  bool streaming = false;
+  for (const auto& submission : batch) {
+    submission->response_batch->Reset(*submission->request_batch);
+    for (auto& request : submission->request_batch->requests) {
+      owners[request.request_id] = submission.get();
+      placements.emplace_back(submission.get(), request.index);
+      request.index = merged_batch->requests.size();
+      merged_batch->requests.push_back(std::move(request));
+    }
+    submission->request_batch->requests.clear();
+    merged_batch->external_buffers.push_back(
+        std::move(submission->request_batch));
+    streaming = streaming || submission->intermediate_response_sender;
+  }
+
+  IntermediateResponseSender merged_sender;
+  if (streaming) {
+    merged_sender =
+        [this,
+         &owners](std::shared_ptr<InferenceResponseBatch>& intermediate_batch) {
+          std::unordered_map<Submission*,
+                             std::shared_ptr<InferenceResponseBatch>>
+              split;
+          for (const auto& response : *intermediate_batch) {
+            auto owner_it = owners.find(response.request_id);
+            if (owner_it == owners.end() ||
+                !owner_it->second->intermediate_response_sender) {
+              continue;
+            }
+            auto& owner_batch = split[owner_it->second];
+            if (!owner_batch) {
+              owner_batch = response_pool_.Acquire();
+              owner_batch->Clear();
+            }
+            owner_batch->Add(response.request_id) = response;
+          }
+          bool sent = true;
+          for (auto& [owner, owner_batch] : split) {
+            sent = (*owner->intermediate_response_sender)(owner_batch) && sent;
+            response_pool_.Release(std::move(owner_batch));
+          }
+          return sent;
+        };
+  }
+
+  auto merged_responses = response_pool_.Acquire();
+  model_instance->Predict(merged_batch, merged_responses, merged_sender);
+  for (size_t i = 0; i < placements.size(); ++i) {
+    auto [owner, index] = placements[i];
+    std::swap((*owner->response_batch)[index], (*merged_responses)[i]);
+    owner->predicted = true;
+  }
+  response_pool_.Release(std::move(merged_responses));
+}
+}  // namespace torchserve
@@ -0,0 +1,98 @@
+#pragma once
+
+#include <chrono>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "model_instance.hh"
+#include "src/utils/message.hh"
+#include "src/utils/object_pool.hh"
+
+namespace torchserve {
+/**
+ * @brief
+ * Dynamic batching across the connections of a worker process.
+ *
+ * The frontend batches per connection. When a worker serves several
+ * connections, BatchAggregator merges their InferenceRequestViewBatches into
+ * one batch of up to batch_size requests, or fewer once the oldest waiting
+ * batch has waited max_batch_delay, runs it on one model instance and
+ * moves each response back to its caller's batch, at its request's index.
+ * Intermediate responses are routed back by request id.
+ *
+ * There is no batching thread: one of the waiting callers forms the next
+ * batch and runs it, while the others wait for their responses or form the
+ * following batch, so batches run in parallel on several model instances.
+ * A batch larger than batch_size runs on its own, and batches with request
+ * ids already in the batch being formed wait for the next one.
+ */
+class BatchAggregator {
+ public:
+  // Returns the model instance to run the next batch on, nullptr if none is
+  // ready, e.g. Backend::GetModelInstance.
+  using ModelInstanceProvider =
+      std::function<std::shared_ptr<torchserve::ModelInstance>()>;
+
+  BatchAggregator(ModelInstanceProvider model_instance_provider,
+                  size_t batch_size,
+                  std::chrono::milliseconds max_batch_delay)
+      : model_instance_provider_(std::move(model_instance_provider)),
+        batch_size_(batch_size > 0 ? batch_size : 1),
+        max_batch_delay_(max_batch_delay){};
+  BatchAggregator(const BatchAggregator&) = delete;
+
+  /**
+   * @brief
+   * Like ModelInstance::Predict, but request_batch may run merged with the
+   * requests of other callers, its request views are moved into the merged
+   * batch, which keeps request_batch alive. Intermediate responses are
+   * routed back to the sender of their request. Blocks until the final
+   * responses are ready.
+   * @return false if no model instance is ready
+   */
+  bool Predict(
+      std::shared_ptr<torchserve::InferenceRequestViewBatch> request_batch,
+      std::shared_ptr<torchserve::InferenceResponseBatch>& response_batch,
+      const IntermediateResponseSender& intermediate_response_sender = {});
+
+ private:
+  struct Submission {
+    std::shared_ptr<torchserve::InferenceRequestViewBatch> request_batch;
+    const IntermediateResponseSender* intermediate_response_sender;
+    std::chrono::steady_clock::time_point deadline;
+    std::shared_ptr<torchserve::InferenceResponseBatch> response_batch;
+    bool queued = true;
+    bool done = false;
+    // answered by a model instance
+    bool predicted = false;
+  };
+
+  // response batches of merged batches and of split intermediate batches
+  static constexpr size_t kResponsePoolCapacity = 8;
+
+  // Takes the submissions of the next batch off the queue. Requires mutex_.
+  std::vector<std::shared_ptr<Submission>> TakeBatch();
+  void RunBatch(const std::vector<std::shared_ptr<Submission>>& batch);
+
+  ModelInstanceProvider model_instance_provider_;
+  const size_t batch_size_;
+  const std::chrono::milliseconds max_batch_delay_;
+
+  std::mutex mutex_;
+  std::condition_variable cv_;
+  std::deque<std::shared_ptr<Submission>> queue_;
+  // requests waiting in queue_
+  size_t queued_requests_ = 0;
+  // a caller is forming the next batch
+  bool forming_ = false;
+  // their responses are swapped into the callers' batches, so the pooled
+  // batches keep the callers' previous buffers for the next merged batch
+  ObjectPool<torchserve::InferenceResponseBatch> response_pool_{
+      kResponsePoolCapacity};
+};
+}  // namespace torchserve
@@ -1,24 +1,79 @@
 #include "model_instance.hh"
 
 #include <memory>
+#include <utility>
 
 namespace torchserve {
 
 ModelInstance::ModelInstance(const std::string& instance_id,
                              std::shared_ptr<void> model,
                              std::shared_ptr<torchserve::BaseHandler>& handler,
-                             std::shared_ptr<torch::Device> device)
+                             std::shared_ptr<torch::Device> device,
+                             std::shared_ptr<ResponseCache> response_cache,
+                             CpuAffinity::CpuSet cpus, int intra_op_threads)
     : instance_id_(instance_id),
       model_(model),
       handler_(handler),
-      device_(device) {}
+      device_(device),
+      response_cache_(std::move(response_cache)),
+      cpus_(std::move(cpus)),
+      intra_op_threads_(intra_op_threads) {
+  if (!cpus_.empty()) {
+    executor_ = std::make_unique<PinnedExecutor>(
+        cpus_, [this]() { SetIntraOpThreads(); });
+  }
+}
+
+void ModelInstance::Predict(
+    std::shared_ptr<torchserve::InferenceRequestViewBatch> request_batch,
+    std::shared_ptr<torchserve::InferenceResponseBatch>& response_batch,
+    const IntermediateResponseSender& intermediate_response_sender) {
+  if (executor_) {
+    // the executor's threads are pinned and sized once, not per batch
+    executor_->Run([&]() {
+      PredictOnThisThread(request_batch, response_batch,
+                          intermediate_response_sender);
+    });
+    return;
+  }
+  SetIntraOpThreads();
+  PredictOnThisThread(request_batch, response_batch,
+                      intermediate_response_sender);
+}
+
+void ModelInstance::SetIntraOpThreads() const {
+  // the intra-op pool is per thread with OpenMP, so instances sharing a
+  // thread may each set their own; with other parallel backends
+  // intra_op_threads_ is 0, see Backend::CreateModelInstance. Checked first
+  // as resizing is not free
+  if (intra_op_threads_ > 0 && at::get_num_threads() != intra_op_threads_) {
+    at::set_num_threads(intra_op_threads_);
+  }
+}
 
-std::shared_ptr<torchserve::InferenceResponseBatch> ModelInstance::Predict(
-    std::shared_ptr<torchserve::InferenceRequestBatch> request_batch) {
-  auto response_batch = std::make_shared<torchserve::InferenceResponseBatch>();
-  handler_->Handle(model_, device_, request_batch, response_batch);
+void ModelInstance::PredictOnThisThread(
+    std::shared_ptr<torchserve::InferenceRequestViewBatch>& request_batch,
+    std::shared_ptr<torchserve::InferenceResponseBatch>& response_batch,
+    const IntermediateResponseSender& intermediate_response_sender) {
+  if (!response_batch) {
+    response_batch = std::make_shared<torchserve::InferenceResponseBatch>();
+  }
+  response_batch->Reset(*request_batch);
+  if (!response_cache_) {
+    handler_->Handle(model_, device_, request_batch, response_batch,
+                     intermediate_response_sender);
+    return;
+  }
 
-  return response_batch;
+  // the cache answers hits at their index and removes them from
+  // request_batch, the handler answers the rest at theirs
+  auto misses = response_cache_->Lookup(*request_batch, *response_batch);
+  if (request_batch->requests.empty()) {
+    return;
+  }
+  handler_->Handle(model_, device_, request_batch, response_batch,
+                   intermediate_response_sender);
+  response_cache_->Store(misses, *response_batch);
 }
 
 }  // namespace torchserve
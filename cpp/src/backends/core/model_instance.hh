@@ -3,27 +3,73 @@
 #include <torch/script.h>
 #include <torch/torch.h>
 
+#include <atomic>
+#include <cstdint>
+#include <memory>
 #include <string>
 
+#include "src/backends/core/response_cache.hh"
 #include "src/backends/handler/base_handler.hh"
+#include "src/utils/cpu_affinity.hh"
 
 namespace torchserve {
 class ModelInstance {
  public:
   ModelInstance(const std::string& instance_id, std::shared_ptr<void> model,
                 std::shared_ptr<torchserve::BaseHandler>& handler,
-                std::shared_ptr<torch::Device> device);
+                std::shared_ptr<torch::Device> device,
+                std::shared_ptr<ResponseCache> response_cache = nullptr,
+                CpuAffinity::CpuSet cpus = {}, int intra_op_threads = 0);
   virtual ~ModelInstance() = default;
 
-  std::shared_ptr<torchserve::InferenceResponseBatch> Predict(
-      std::shared_ptr<torchserve::InferenceRequestBatch> request_batch);
+  // Answers request_batch into response_batch, in request order, see
+  // InferenceResponseBatch::Reset. response_batch is reused, e.g. from an
+  // ObjectPool, or created if it is null.
+  // intermediate_response_sender enables streaming, see
+  // BaseHandler::SendIntermediateResponse. With a response cache, requests
+  // whose response is cached are answered without the handler. Runs on the
+  // instance's executor, pinned to its cpus, if any, or else on the calling
+  // thread, with the instance's intra-op thread count.
+  void Predict(
+      std::shared_ptr<torchserve::InferenceRequestViewBatch> request_batch,
+      std::shared_ptr<torchserve::InferenceResponseBatch>& response_batch,
+      const IntermediateResponseSender& intermediate_response_sender = {});
+
+  const std::string& GetInstanceId() const { return instance_id_; }
+
+  // Number of callers holding this instance from Backend::GetModelInstance(),
+  // i.e. batches dispatched to it that have not completed yet.
+  uint32_t GetInFlight() const { return in_flight_.load(); }
+
+  // cores the instance is pinned to, empty if it is not
+  const CpuAffinity::CpuSet& GetCpus() const { return cpus_; }
 
  protected:
+  friend class Backend;
+
   // instance_id naming convention:
   // device_type + ":" + device_id (or object id)
   std::string instance_id_;
   std::shared_ptr<void> model_;
   std::shared_ptr<torchserve::BaseHandler> handler_;
   std::shared_ptr<torch::Device> device_;
+  // shared by the instances of a model, nullptr if disabled
+  std::shared_ptr<ResponseCache> response_cache_;
+  // cores the instance's executor is pinned to, empty for any
+  CpuAffinity::CpuSet cpus_;
+  // set on the thread predicting, 0 to keep its setting
+  int intra_op_threads_;
+  std::atomic<uint32_t> in_flight_{0};
+
+ private:
+  void SetIntraOpThreads() const;
+  void PredictOnThisThread(
+      std::shared_ptr<torchserve::InferenceRequestViewBatch>& request_batch,
+      std::shared_ptr<torchserve::InferenceResponseBatch>& response_batch,
+      const IntermediateResponseSender& intermediate_response_sender);
+
+  // threads pinned to cpus_ once, nullptr if cpus_ is empty; last, so that
+  // they are joined before the members they use are destroyed
+  std::unique_ptr<PinnedExecutor> executor_;
 };
 }  // namespace torchserve
@@ -0,0 +1,226 @@
+#include "src/backends/core/response_cache.hh"
+
+#include <algorithm>
+#include <iterator>
+#include <stdexcept>
+#include <string_view>
+#include <vector>
+
+#include "src/utils/logging.hh"
+#include "src/utils/metrics/registry.hh"
+
+namespace torchserve {
+namespace {
+const std::string_view kContentTypeSuffix = ":contentType";
+// bookkeeping of an entry besides its msg and headers
+constexpr size_t kEntryOverheadBytes = 128;
+
+bool IsContentTypeHeader(std::string_view name) {
+  return name == PayloadType::kHEADER_NAME_DATA_TYPE ||
+         name == PayloadType::kHEADER_NAME_BODY_TYPE ||
+         (name.size() > kContentTypeSuffix.size() &&
+          name.substr(name.size() - kContentTypeSuffix.size()) ==
+              kContentTypeSuffix);
+}
+
+// Fields by name, the last one of each name like
+// InferenceRequestView::GetHeader, so that requests that only differ in the
+// order of their fields have equal keys.
+std::vector<const InferenceRequestView::Header*> SortByName(
+    const std::vector<InferenceRequestView::Header>& fields) {
+  std::vector<const InferenceRequestView::Header*> sorted;
+  sorted.reserve(fields.size());
+  for (const auto& field : fields) {
+    sorted.push_back(&field);
+  }
+  std::stable_sort(sorted.begin(), sorted.end(),
+                   [](const auto* lhs, const auto* rhs) {
+                     return lhs->first < rhs->first;
+                   });
+  auto last = std::unique(sorted.rbegin(), sorted.rend(),
+                          [](const auto* lhs, const auto* rhs) {
+                            return lhs->first == rhs->first;
+                          });
+  sorted.erase(sorted.begin(), last.base());
+  return sorted;
+}
+
+// each piece is preceded by its size, so that pieces can not run into each
+// other, e.g. name "ab" value "c" and name "a" value "bc"
+void HashPiece(std::string_view piece, Hasher128& hasher) {
+  uint64_t size = piece.size();
+  hasher.Update(&size, sizeof(size));
+  hasher.Update(piece);
+}
+
+void AppendPiece(std::string_view piece, std::string& parts) {
+  uint64_t size = piece.size();
+  parts.append(reinterpret_cast<const char*>(&size), sizeof(size));
+  parts.append(piece);
+}
+}  // namespace
+
+std::optional<ResponseCache::Key> ResponseCache::MakeKey(
+    const InferenceRequestView& request) const {
+  if (request.GetHeader(PayloadType::kHEADER_NAME_SEQUENCE_ID)) {
+    return std::nullopt;
+  }
+  // the payloads are hashed where they are, only the digest is kept
+  Key key;
+  Hasher128 hasher;
+  HashPiece(model_id_, hasher);
+  for (const auto* parameter : SortByName(request.parameters)) {
+    AppendPiece(parameter->first, key.parts);
+    HashPiece(parameter->first, hasher);
+    HashPiece(parameter->second, hasher);
+  }
+  for (const auto* header : SortByName(request.headers)) {
+    if (IsContentTypeHeader(header->first)) {
+      AppendPiece(header->first, key.parts);
+      AppendPiece(header->second, key.parts);
+      HashPiece(header->first, hasher);
+      HashPiece(header->second, hasher);
+    }
+  }
+  key.digest = hasher.Digest();
+  return key;
+}
+
+ResponseCache::Misses ResponseCache::Lookup(
+    InferenceRequestViewBatch& request_batch,
+    InferenceResponseBatch& response_batch) {
+  auto& requests = request_batch.requests;
+  Misses misses;
+  size_t hits = 0;
+  auto now = std::chrono::steady_clock::now();
+  auto kept = requests.begin();
+  for (auto& request : requests) {
+    auto key = MakeKey(request);
+    std::shared_ptr<const InferenceResponse> cached;
+    if (key) {
+      std::lock_guard<std::mutex> lock(mutex_);
+      auto entry_it = FindEntry(*key);
+      if (entry_it != entries_.end()) {
+        if (entry_it->expires < now) {
+          EraseEntry(entry_it);
+        } else {
+          entries_.splice(entries_.begin(), entries_, entry_it);
+          cached = entry_it->response;
+        }
+      }
+    }
+
+    if (cached) {
+      // copied into the response's own buffers
+      auto& response = response_batch[request.index];
+      response = *cached;
+      response.request_id.assign(request.request_id);
+      ++hits;
+      continue;
+    }
+    if (key) {
+      misses.push_back(Miss{request.index, std::move(*key)});
+    }
+    if (&*kept != &request) {
+      *kept = std::move(request);
+    }
+    ++kept;
+  }
+  requests.erase(kept, requests.end());
+
+  RecordCount("ResponseCacheHit", hits);
+  RecordCount("ResponseCacheMiss", misses.size());
+  return misses;
+}
+
+void ResponseCache::Store(const Misses& misses,
+                          const InferenceResponseBatch& response_batch) {
+  auto expires = ttl_.count() > 0
+                     ? std::chrono::steady_clock::now() + ttl_
+                     : std::chrono::steady_clock::time_point::max();
+  size_t evictions = 0;
+  for (const auto& [index, key] : misses) {
+    const auto& response = response_batch[index];
+    if (response.code != 200 ||
+        response.headers.count(PayloadType::kHEADER_NAME_STREAM_NEXT) > 0) {
+      continue;
+    }
+    size_t bytes = kEntryOverheadBytes + sizeof(key.digest) +
+                   key.parts.size() + response.msg.size();
+    for (const auto& [name, value] : response.headers) {
+      bytes += name.size() + value.size();
+    }
+    if (bytes > capacity_bytes_) {
+      continue;
+    }
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto entry_it = FindEntry(key);
+    if (entry_it != entries_.end()) {
+      EraseEntry(entry_it);
+    }
+    entries_.push_front(
+        Entry{key, std::make_shared<const InferenceResponse>(response), bytes,
+              expires});
+    index_.emplace(key.digest.low, entries_.begin());
+    bytes_ += bytes;
+    while (bytes_ > capacity_bytes_) {
+      EraseEntry(std::prev(entries_.end()));
+      ++evictions;
+    }
+  }
+  RecordCount("ResponseCacheEviction", evictions);
+}
+
+size_t ResponseCache::Size() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return entries_.size();
+}
+
+size_t ResponseCache::Bytes() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return bytes_;
+}
+
+std::list<ResponseCache::Entry>::iterator ResponseCache::FindEntry(
+    const Key& key) {
+  auto [begin, end] = index_.equal_range(key.digest.low);
+  for (auto index_it = begin; index_it != end; ++index_it) {
+    if (index_it->second->key == key) {
+      return index_it->second;
+    }
+  }
+  return entries_.end();
+}
+
+void ResponseCache::EraseEntry(std::list<Entry>::iterator entry_it) {
+  bytes_ -= entry_it->bytes;
+  auto [begin, end] = index_.equal_range(entry_it->key.digest.low);
+  for (auto index_it = begin; index_it != end; ++index_it) {
+    if (index_it->second == entry_it) {
+      index_.erase(index_it);
+      break;
+    }
+  }
+  entries_.erase(entry_it);
+}
+
+void ResponseCache::RecordCount(const std::string& metric_name,
+                                size_t count) {
+  if (count == 0) {
+    return;
+  }
+  try {
+    auto& metric =
+        torchserve::MetricsRegistry::GetMetricsCacheInstance()->GetMetric(
+            torchserve::MetricType::COUNTER, metric_name);
+    metric.AddOrUpdate(std::vector<std::string>{model_name_, "Model"},
+                       static_cast<double>(count));
+  } catch (std::runtime_error& e) {
+    TS_LOG(DEBUG, e.what());
+  } catch (std::invalid_argument& e) {
+    // not every metrics config defines this metric, don't flood the log
+    TS_LOGF(DEBUG, "Failed to record {} metric. {}", metric_name, e.what());
+  }
+}
+}  // namespace torchserve
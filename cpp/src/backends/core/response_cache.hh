@@ -0,0 +1,112 @@
+#pragma once
+
+#include <chrono>
+#include <cstddef>
+#include <cstdint>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "src/utils/hash128.hh"
+#include "src/utils/message.hh"
+
+namespace torchserve {
+/**
+ * @brief
+ * Responses of a model keyed by the content of their requests, so that
+ * repeated identical payloads (thumbnails, canned prompts) skip the handler.
+ *
+ * The key covers the model id with the parameters of a request and their
+ * content type headers; other headers do not count. The payloads are hashed
+ * in place into a 128-bit digest and not kept, so a key is a few dozen
+ * bytes whatever the size of the request; a hit compares the digest and
+ * the parameter names and content types, which are kept. Requests of a
+ * sequence (ts_request_sequence_id) are never cached since their responses
+ * depend on session state, and neither are streamed or failed responses.
+ *
+ * Bounded by bytes with LRU eviction, entries expire after ttl (0 for
+ * never). Hits, misses and evictions are recorded as the ResponseCacheHit,
+ * ResponseCacheMiss and ResponseCacheEviction counters. Thread-safe.
+ */
+class ResponseCache {
+ public:
+  struct Key {
+    // of the model id and every piece of the request, payloads included
+    Digest128 digest;
+    // the parameter names and the content type headers, each preceded by
+    // its size
+    std::string parts;
+
+    bool operator==(const Key& other) const {
+      return digest == other.digest && parts == other.parts;
+    }
+    bool operator!=(const Key& other) const { return !(*this == other); }
+  };
+
+  // key of a request a batch sends to the handler, by the index of the
+  // request and its response
+  struct Miss {
+    size_t index;
+    Key key;
+  };
+  using Misses = std::vector<Miss>;
+
+  ResponseCache(const std::string& model_name, const std::string& model_id,
+                size_t capacity_bytes, std::chrono::seconds ttl)
+      : model_name_(model_name),
+        model_id_(model_id),
+        capacity_bytes_(capacity_bytes),
+        ttl_(ttl){};
+
+  /**
+   * @brief
+   * Answers the requests of request_batch whose response is cached, at
+   * their index in response_batch, see InferenceResponseBatch::Reset, and
+   * removes these requests from request_batch.
+   * @return the keys of the remaining requests that can be cached
+   */
+  Misses Lookup(InferenceRequestViewBatch& request_batch,
+                InferenceResponseBatch& response_batch);
+
+  // Stores the responses of misses, evicting the least recently used ones if
+  // needed.
+  void Store(const Misses& misses,
+             const InferenceResponseBatch& response_batch);
+
+  // nullopt if the request can not be cached
+  std::optional<Key> MakeKey(const InferenceRequestView& request) const;
+
+  size_t Size() const;
+  size_t Bytes() const;
+
+ private:
+  struct Entry {
+    Key key;
+    std::shared_ptr<const InferenceResponse> response;
+    size_t bytes;
+    std::chrono::steady_clock::time_point expires;
+  };
+
+  // requires mutex_
+  std::list<Entry>::iterator FindEntry(const Key& key);
+  void EraseEntry(std::list<Entry>::iterator entry_it);
+
+  void RecordCount(const std::string& metric_name, size_t count);
+
+  const std::string model_name_;
+  const std::string model_id_;
+  const size_t capacity_bytes_;
+  const std::chrono::seconds ttl_;
+
+  mutable std::mutex mutex_;
+  size_t bytes_ = 0;
+  // most recently used first
+  std::list<Entry> entries_;
+  // by the low half of the key digest, colliding keys share a bucket
+  std::unordered_multimap<size_t, std::list<Entry>::iterator> index_;
+};
+}  // namespace torchserve
@@ -1,35 +1,207 @@
 #include "base_handler.hh"
 
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <sstream>
+
+#include "src/backends/handler/raw_tensor.hh"
+
 namespace torchserve {
+void BaseHandler::Initialize(const std::string& model_dir,
+                             std::shared_ptr<torchserve::Manifest>& manifest) {
+  model_dir_ = model_dir;
+  manifest_ = manifest;
+  const auto& cache_mb = manifest_->GetModel().session_state_cache_mb;
+  if (!cache_mb.empty()) {
+    try {
+      session_store_.SetCapacityBytes(std::stoull(cache_mb) << 20);
+    } catch (const std::logic_error& e) {
+      TS_LOGF(ERROR, "Invalid {}: {}",
+              torchserve::Manifest::kModel_SessionStateCacheMb, cache_mb);
+    }
+  }
+  const auto& response_timeout_sec = manifest_->GetModel().response_timeout_sec;
+  if (!response_timeout_sec.empty()) {
+    try {
+      response_timeout_ =
+          std::chrono::seconds(std::stoll(response_timeout_sec));
+    } catch (const std::logic_error& e) {
+      TS_LOGF(ERROR, "Invalid {}: {}",
+              torchserve::Manifest::kModel_ResponseTimeoutSec,
+              response_timeout_sec);
+    }
+  }
+}
+
+void BaseHandler::Warmup(
+    std::shared_ptr<void> model, std::shared_ptr<torch::Device>& device,
+    std::shared_ptr<LoadModelRequest>& load_model_request) {
+  std::vector<std::vector<char>> samples;
+  if (!LoadWarmupSamples(samples)) {
+    return;
+  }
+  const auto& model_config = manifest_->GetModel();
+  int iterations = GetWarmupIterations();
+  int max_batch_size = std::max(1, load_model_request->batch_size);
+  std::vector<int> batch_sizes;
+  for (int batch_size = 1; batch_size < max_batch_size; batch_size *= 2) {
+    batch_sizes.push_back(batch_size);
+  }
+  batch_sizes.push_back(max_batch_size);
+
+  auto start_time = std::chrono::steady_clock::now();
+  size_t failed = 0;
+  for (int batch_size : batch_sizes) {
+    for (int iteration = 0; iteration < iterations; ++iteration) {
+      failed += RunWarmupBatch(model, device, samples, batch_size);
+    }
+  }
+  std::chrono::duration<double, std::milli> duration =
+      std::chrono::steady_clock::now() - start_time;
+  TS_LOGF(INFO, "Warmed up model {} with batch sizes up to {} in {} ms",
+          model_config.model_name, max_batch_size, duration.count());
+  if (failed > 0) {
+    TS_LOGF(WARN, "{} warmup requests of model {} failed", failed,
+            model_config.model_name);
+  }
+}
+
+int BaseHandler::TuneIntraOpThreads(
+    std::shared_ptr<void> model, std::shared_ptr<torch::Device>& device,
+    std::shared_ptr<LoadModelRequest>& load_model_request,
+    const std::vector<int>& candidates) {
+  std::vector<std::vector<char>> samples;
+  if (candidates.empty() || !LoadWarmupSamples(samples)) {
+    return 0;
+  }
+  int iterations = GetWarmupIterations();
+  int batch_size = std::max(1, load_model_request->batch_size);
+  int best_threads = 0;
+  double best_duration = 0;
+  for (int threads : candidates) {
+    at::set_num_threads(threads);
+    // the first batch pays for the thread pool resize
+    RunWarmupBatch(model, device, samples, batch_size);
+    auto start_time = std::chrono::steady_clock::now();
+    size_t failed = 0;
+    for (int iteration = 0; iteration < iterations; ++iteration) {
+      failed += RunWarmupBatch(model, device, samples, batch_size);
+    }
+    std::chrono::duration<double, std::milli> duration =
+        std::chrono::steady_clock::now() - start_time;
+    TS_LOGF(DEBUG, "{} intra-op threads: {} batches in {} ms", threads,
+            iterations, duration.count());
+    if (failed == 0 &&
+        (best_threads == 0 || duration.count() < best_duration)) {
+      best_threads = threads;
+      best_duration = duration.count();
+    }
+  }
+  return best_threads;
+}
+
+bool BaseHandler::LoadWarmupSamples(std::vector<std::vector<char>>& samples) {
+  const auto& warmup_samples = manifest_->GetModel().warmup_samples;
+  if (warmup_samples.empty()) {
+    return false;
+  }
+  std::istringstream sample_files(warmup_samples);
+  std::string sample_file;
+  while (std::getline(sample_files, sample_file, ',')) {
+    auto path = fmt::format("{}/{}", model_dir_, sample_file);
+    std::ifstream sample_stream(path, std::ios::in | std::ios::binary);
+    if (!sample_stream) {
+      TS_LOGF(WARN, "Cannot open warmup sample {}, skipping warmup", path);
+      return false;
+    }
+    samples.emplace_back(std::istreambuf_iterator<char>(sample_stream),
+                         std::istreambuf_iterator<char>());
+  }
+  return !samples.empty();
+}
+
+int BaseHandler::GetWarmupIterations() {
+  const auto& warmup_iterations = manifest_->GetModel().warmup_iterations;
+  if (warmup_iterations.empty()) {
+    return 1;
+  }
+  try {
+    return std::stoi(warmup_iterations);
+  } catch (const std::logic_error& e) {
+    TS_LOGF(ERROR, "Invalid {}: {}",
+            torchserve::Manifest::kModel_WarmupIterations, warmup_iterations);
+    return 1;
+  }
+}
+
+size_t BaseHandler::RunWarmupBatch(
+    std::shared_ptr<void>& model, std::shared_ptr<torch::Device>& device,
+    const std::vector<std::vector<char>>& samples, int batch_size) {
+  // sent the way the frontend sends a request body, the bodies point to
+  // samples, which outlive the batch
+  auto request_batch = std::make_shared<InferenceRequestViewBatch>();
+  request_batch->requests.reserve(batch_size);
+  for (int i = 0; i < batch_size; ++i) {
+    const auto& sample = samples[i % samples.size()];
+    auto& request = request_batch->requests.emplace_back();
+    request.index = i;
+    request.request_id =
+        request_batch->arena.Copy(fmt::format("warmup_{}", i));
+    request.headers.emplace_back(
+        torchserve::PayloadType::kHEADER_NAME_BODY_TYPE,
+        torchserve::PayloadType::kDATA_TYPE_BYTES);
+    request.parameters.emplace_back(
+        torchserve::PayloadType::kPARAMETER_NAME_BODY,
+        std::string_view(sample.data(), sample.size()));
+  }
+  auto response_batch = std::make_shared<InferenceResponseBatch>();
+  response_batch->Reset(*request_batch);
+  Handle(model, device, request_batch, response_batch);
+  size_t failed = 0;
+  for (const auto& response : *response_batch) {
+    failed += response.code != 200;
+  }
+  return failed;
+}
 
 void BaseHandler::Handle(
     std::shared_ptr<void> model, std::shared_ptr<torch::Device>& device,
-    std::shared_ptr<torchserve::InferenceRequestBatch>& request_batch,
-    std::shared_ptr<torchserve::InferenceResponseBatch>& response_batch) {
-  std::string req_ids = "";
-  std::map<uint8_t, std::string> map_idx_to_req_id;
-  std::pair<std::string&, std::map<uint8_t, std::string>&> idx_to_req_id(
-      req_ids, map_idx_to_req_id);
+    std::shared_ptr<torchserve::InferenceRequestViewBatch>& request_batch,
+    std::shared_ptr<torchserve::InferenceResponseBatch>& response_batch,
+    const IntermediateResponseSender& intermediate_response_sender) {
+  DropExpiredRequests(*request_batch, *response_batch);
+  if (request_batch->requests.empty()) {
+    return;
+  }
+  intermediate_response_sender_ =
+      intermediate_response_sender ? &intermediate_response_sender : nullptr;
+  intermediate_response_sent_ = false;
+  handled_model_ = model.get();
+  BatchContext batch_context;
+  batch_context.Reserve(request_batch->requests.size());
   std::string just_passed = "";
   try {
     auto start_time = std::chrono::system_clock::now();
     auto inputs =
-        Preprocess(device, idx_to_req_id, request_batch, response_batch);
+        Preprocess(device, batch_context, request_batch, response_batch);
     just_passed = "Preprocessing";
     auto outputs =
-        Inference(model, inputs, device, idx_to_req_id, response_batch);
+        Inference(model, inputs, device, batch_context, response_batch);
     just_passed = "Inference";
-    Postprocess(outputs, idx_to_req_id, response_batch);
+    Postprocess(outputs, batch_context, response_batch);
+    batch_context.Finish();
     just_passed = "Postprocessing";
     auto stop_time = std::chrono::system_clock::now();
     std::chrono::duration<double, std::milli> duration = stop_time - start_time;
+    auto request_ids = batch_context.RequestIds();
     try {
       auto& handler_time_metric =
           torchserve::MetricsRegistry::GetMetricsCacheInstance()->GetMetric(
               torchserve::MetricType::GAUGE, "HandlerTime");
       handler_time_metric.AddOrUpdate(
           std::vector<std::string>{manifest_->GetModel().model_name, "Model"},
-          idx_to_req_id.first, duration.count());
+          request_ids, duration.count());
     } catch (std::runtime_error& e) {
       TS_LOG(ERROR, e.what());
     } catch (std::invalid_argument& e) {
@@ -41,7 +213,7 @@ void BaseHandler::Handle(
               torchserve::MetricType::GAUGE, "PredictionTime");
       prediction_time_metric.AddOrUpdate(
           std::vector<std::string>{manifest_->GetModel().model_name, "Model"},
-          idx_to_req_id.first, duration.count());
+          request_ids, duration.count());
     } catch (std::runtime_error& e) {
       TS_LOG(ERROR, e.what());
     } catch (std::invalid_argument& e) {
@@ -49,7 +221,152 @@ void BaseHandler::Handle(
     }
   } catch (...) {
     TS_LOG(ERROR, "Failed to handle this batch after: {}", just_passed);
+    batch_context.FailPending("failed to handle the batch");
+  }
+
+  // the final response closes the stream of a streamed request; handlers
+  // that set ts_stream_next themselves, e.g. for continuous batching, keep
+  // their value
+  intermediate_response_sender_ = nullptr;
+  handled_model_ = nullptr;
+  for (auto& response : *response_batch) {
+    if (intermediate_response_sent_ && IsStreamed(response)) {
+      response.headers[torchserve::PayloadType::kHEADER_NAME_STREAM_NEXT] =
+          "false";
+    }
+  }
+
+  for (const auto& request : request_batch->requests) {
+    if (request.GetHeader(
+            torchserve::PayloadType::kHEADER_NAME_SEQUENCE_END) == "true") {
+      session_store_.Erase(GetSequenceId(request));
+    }
+  }
+}
+
+bool BaseHandler::SendIntermediateResponse(
+    std::shared_ptr<torchserve::InferenceResponseBatch>& intermediate_batch,
+    std::shared_ptr<torchserve::InferenceResponseBatch>& response_batch) {
+  if (intermediate_response_sender_ == nullptr) {
+    return false;
   }
+  intermediate_response_sent_ = true;
+  for (auto& response : *intermediate_batch) {
+    response.headers[torchserve::PayloadType::kHEADER_NAME_STREAM_NEXT] =
+        "true";
+    auto* final_response = response_batch->Find(response.request_id);
+    if (final_response != nullptr) {
+      final_response
+          ->headers[torchserve::PayloadType::kHEADER_NAME_STREAM_NEXT] = "true";
+    }
+  }
+  return (*intermediate_response_sender_)(intermediate_batch);
+}
+
+bool BaseHandler::IsStreamed(const torchserve::InferenceResponse& response) {
+  auto stream_next_it =
+      response.headers.find(torchserve::PayloadType::kHEADER_NAME_STREAM_NEXT);
+  return stream_next_it != response.headers.end() &&
+         stream_next_it->second == "true";
+}
+
+size_t BaseHandler::DropExpiredRequests(
+    torchserve::InferenceRequestViewBatch& request_batch,
+    torchserve::InferenceResponseBatch& response_batch) {
+  auto now = std::chrono::steady_clock::now();
+  auto& requests = request_batch.requests;
+  auto kept = requests.begin();
+  size_t expired = 0;
+  for (auto& request : requests) {
+    auto deadline = GetDeadline(request);
+    if (!deadline || *deadline >= now) {
+      if (&*kept != &request) {
+        *kept = std::move(request);
+      }
+      ++kept;
+      continue;
+    }
+    response_batch[request.index].SetResponse(
+        torchserve::PayloadType::kCODE_DEADLINE_EXCEEDED, "data_type",
+        torchserve::PayloadType::kCONTENT_TYPE_TEXT,
+        "Request deadline exceeded");
+    // the last request of a sequence still ends it
+    if (request.GetHeader(
+            torchserve::PayloadType::kHEADER_NAME_SEQUENCE_END) == "true") {
+      session_store_.Erase(GetSequenceId(request));
+    }
+    ++expired;
+  }
+  requests.erase(kept, requests.end());
+  if (expired == 0) {
+    return 0;
+  }
+
+  TS_LOGF(DEBUG, "Dropped {} expired requests of model {}", expired,
+          manifest_->GetModel().model_name);
+  try {
+    auto& expired_metric =
+        torchserve::MetricsRegistry::GetMetricsCacheInstance()->GetMetric(
+            torchserve::MetricType::COUNTER, "RequestsExpired");
+    expired_metric.AddOrUpdate(
+        std::vector<std::string>{manifest_->GetModel().model_name, "Model"},
+        expired);
+  } catch (std::runtime_error& e) {
+    TS_LOG(DEBUG, e.what());
+  } catch (std::invalid_argument& e) {
+    TS_LOGF(DEBUG, "Failed to record RequestsExpired metric. {}", e.what());
+  }
+  return expired;
+}
+
+std::optional<std::chrono::steady_clock::time_point> BaseHandler::GetDeadline(
+    const torchserve::InferenceRequestView& request) const {
+  using steady_clock = std::chrono::steady_clock;
+  using system_clock = std::chrono::system_clock;
+  bool received = request.received != steady_clock::time_point();
+  // wall clock epoch times are moved to the steady clock by the current
+  // offset between the clocks
+  auto to_milliseconds = [](std::string_view value) {
+    return std::chrono::milliseconds(std::stoll(std::string(value)));
+  };
+  auto to_time_point = [&to_milliseconds](std::string_view epoch_ms) {
+    return steady_clock::now() +
+           (system_clock::time_point(to_milliseconds(epoch_ms)) -
+            system_clock::now());
+  };
+  try {
+    auto timeout =
+        request.GetHeader(torchserve::PayloadType::kHEADER_NAME_TIMEOUT);
+    if (timeout && received) {
+      return request.received + to_milliseconds(*timeout);
+    }
+    auto deadline =
+        request.GetHeader(torchserve::PayloadType::kHEADER_NAME_DEADLINE);
+    if (deadline) {
+      return to_time_point(*deadline);
+    }
+    if (response_timeout_.count() == 0) {
+      return std::nullopt;
+    }
+    auto enqueue_time =
+        request.GetHeader(torchserve::PayloadType::kHEADER_NAME_ENQUEUE_TIME);
+    if (enqueue_time) {
+      return to_time_point(*enqueue_time) + response_timeout_;
+    }
+    if (received) {
+      return request.received + response_timeout_;
+    }
+  } catch (const std::logic_error& e) {
+    TS_LOGF(WARN, "Invalid deadline of request id: {}", request.request_id);
+  }
+  return std::nullopt;
+}
+
+std::string BaseHandler::GetSequenceId(
+    const torchserve::InferenceRequestView& request) {
+  return std::string(
+      request.GetHeader(torchserve::PayloadType::kHEADER_NAME_SEQUENCE_ID)
+          .value_or(""));
 }
 
 std::shared_ptr<torch::Device> BaseHandler::GetTorchDevice(
@@ -69,8 +386,8 @@ std::shared_ptr<torch::Device> BaseHandler::GetTorchDevice(
 
 c10::IValue BaseHandler::Preprocess(
     std::shared_ptr<torch::Device>& device,
-    std::pair<std::string&, std::map<uint8_t, std::string>&>& idx_to_req_id,
-    std::shared_ptr<torchserve::InferenceRequestBatch>& request_batch,
+    torchserve::BatchContext& batch_context,
+    std::shared_ptr<torchserve::InferenceRequestViewBatch>& request_batch,
     std::shared_ptr<torchserve::InferenceResponseBatch>& response_batch) {
   /**
    * @brief
@@ -80,30 +397,25 @@ c10::IValue BaseHandler::Preprocess(
   auto batch_ivalue = c10::impl::GenericList(c10::TensorType::get());
 
   std::vector<torch::Tensor> batch_tensors;
-  uint8_t idx = 0;
-  for (auto& request : *request_batch) {
-    (*response_batch)[request.request_id] =
-        std::make_shared<torchserve::InferenceResponse>(request.request_id);
-    idx_to_req_id.first += idx_to_req_id.first.empty()
-                               ? request.request_id
-                               : "," + request.request_id;
-    auto data_it =
-        request.parameters.find(torchserve::PayloadType::kPARAMETER_NAME_DATA);
-    auto dtype_it =
-        request.headers.find(torchserve::PayloadType::kHEADER_NAME_DATA_TYPE);
-    if (data_it == request.parameters.end()) {
-      data_it = request.parameters.find(
-          torchserve::PayloadType::kPARAMETER_NAME_BODY);
-      dtype_it =
-          request.headers.find(torchserve::PayloadType::kHEADER_NAME_BODY_TYPE);
-    }
-
-    if (data_it == request.parameters.end() ||
-        dtype_it == request.headers.end()) {
+  batch_tensors.reserve(request_batch->requests.size());
+  for (auto& request : request_batch->requests) {
+    auto* response = &(*response_batch)[request.index];
+    auto data =
+        request.GetParameter(torchserve::PayloadType::kPARAMETER_NAME_DATA);
+    auto dtype =
+        request.GetHeader(torchserve::PayloadType::kHEADER_NAME_DATA_TYPE);
+    if (!data) {
+      data =
+          request.GetParameter(torchserve::PayloadType::kPARAMETER_NAME_BODY);
+      dtype =
+          request.GetHeader(torchserve::PayloadType::kHEADER_NAME_BODY_TYPE);
+    }
+
+    if (!data || !dtype) {
       TS_LOGF(ERROR, "Empty payload for request id: {}", request.request_id);
-      (*response_batch)[request.request_id]->SetResponse(
-          500, "data_type", torchserve::PayloadType::kCONTENT_TYPE_TEXT,
-          "Empty payload");
+      response->SetResponse(500, "data_type",
+                            torchserve::PayloadType::kCONTENT_TYPE_TEXT,
+                            "Empty payload");
       continue;
     }
     /*
@@ -121,7 +433,17 @@ c10::IValue BaseHandler::Preprocess(
     */
 
     try {
-      if (dtype_it->second == torchserve::PayloadType::kDATA_TYPE_BYTES) {
+      if (*dtype == torchserve::PayloadType::kDATA_TYPE_RAW_TENSOR ||
+          (*dtype == torchserve::PayloadType::kDATA_TYPE_BYTES &&
+           RawTensor::IsRawTensor(*data))) {
+        // raw tensor, wrapped in place in the arena or the shared memory
+        // the request was read into; torch::stack below copies it out of
+        // the request before the request batch is released.
+        batch_tensors.emplace_back(RawTensor::Decode(*data).to(*device));
+        // reply in the same format, see Postprocess
+        auto index = batch_context.Add(request.request_id, response);
+        batch_context[index].raw_tensor = true;
+      } else if (*dtype == torchserve::PayloadType::kDATA_TYPE_BYTES) {
         // case2: the image is sent as bytesarray
         // torch::serialize::InputArchive archive;
         // archive.load_from(std::istringstream
@@ -137,23 +459,24 @@ c10::IValue BaseHandler::Preprocess(
 
         images.emplace_back(torch::pickle_load(bytes).toTensor().to(*device));
         */
+        // pickle_load only reads from a vector
         batch_tensors.emplace_back(
-            torch::pickle_load(data_it->second).toTensor().to(*device));
-        idx_to_req_id.second[idx++] = request.request_id;
-      } else if (dtype_it->second == "List") {
+            torch::pickle_load(std::vector<char>(data->begin(), data->end()))
+                .toTensor()
+                .to(*device));
+        batch_context.Add(request.request_id, response);
+      } else if (*dtype == "List") {
         // case3: the image is a list
       }
     } catch (const std::runtime_error& e) {
       TS_LOGF(ERROR, "Failed to load tensor for request id: {}, error: {}",
               request.request_id, e.what());
-      auto response = (*response_batch)[request.request_id];
       response->SetResponse(500, "data_type",
                             torchserve::PayloadType::kDATA_TYPE_STRING,
                             "runtime_error, failed to load tensor");
     } catch (const c10::Error& e) {
       TS_LOGF(ERROR, "Failed to load tensor for request id: {}, c10 error: {}",
               request.request_id, e.msg());
-      auto response = (*response_batch)[request.request_id];
       response->SetResponse(500, "data_type",
                             torchserve::PayloadType::kDATA_TYPE_STRING,
                             "c10 error, failed to load tensor");
@@ -169,7 +492,7 @@ c10::IValue BaseHandler::Preprocess(
 c10::IValue BaseHandler::Inference(
     std::shared_ptr<void> model, c10::IValue& inputs,
     std::shared_ptr<torch::Device>& device,
-    std::pair<std::string&, std::map<uint8_t, std::string>&>& idx_to_req_id,
+    torchserve::BatchContext& batch_context,
     std::shared_ptr<torchserve::InferenceResponseBatch>& response_batch) {
   if (device == nullptr) {
     TS_LOG(WARN, "device is nullptr");
@@ -183,42 +506,42 @@ c10::IValue BaseHandler::Inference(
     return jit_model->forward(input_vec).toTensor();
   } catch (const std::runtime_error& e) {
     TS_LOGF(ERROR, "Failed to predict, error: {}", e.what());
-    for (auto& kv : idx_to_req_id.second) {
-      auto response = (*response_batch)[kv.second];
-      response->SetResponse(500, "data_type",
-                            torchserve::PayloadType::kDATA_TYPE_STRING,
-                            "runtime_error, failed to inference");
-    }
+    batch_context.FailPending("runtime_error, failed to inference");
     throw e;
   }
 }
 
 void BaseHandler::Postprocess(
-    c10::IValue& inputs,
-    std::pair<std::string&, std::map<uint8_t, std::string>&>& idx_to_req_id,
+    c10::IValue& inputs, torchserve::BatchContext& batch_context,
     std::shared_ptr<torchserve::InferenceResponseBatch>& response_batch) {
   auto data = inputs.toTensor();
-  for (const auto& kv : idx_to_req_id.second) {
+  for (size_t i = 0; i < batch_context.Size(); ++i) {
+    auto& slot = batch_context[i];
+    if (slot.status == BatchContext::Status::FAILED) {
+      continue;
+    }
     try {
-      auto response = (*response_batch)[kv.second];
-      response->SetResponse(200, "data_type",
-                            torchserve::PayloadType::kDATA_TYPE_BYTES,
-                            torch::pickle_save(at::IValue(data[kv.first])));
+      auto* response = slot.response;
+      if (slot.raw_tensor) {
+        // encoded in place, the msg of a reused response keeps its capacity
+        RawTensor::Encode(data[i], response->msg);
+        response->code = 200;
+        response->headers["data_type"] =
+            torchserve::PayloadType::kDATA_TYPE_RAW_TENSOR;
+      } else {
+        response->SetResponse(200, "data_type",
+                              torchserve::PayloadType::kDATA_TYPE_BYTES,
+                              torch::pickle_save(at::IValue(data[i])));
+      }
     } catch (const std::runtime_error& e) {
       TS_LOGF(ERROR, "Failed to load tensor for request id: {}, error: {}",
-              kv.second, e.what());
-      auto response = (*response_batch)[kv.second];
-      response->SetResponse(500, "data_type",
-                            torchserve::PayloadType::kDATA_TYPE_STRING,
-                            "runtime_error, failed to postprocess tensor");
+              slot.request_id, e.what());
+      batch_context.Fail(i, "runtime_error, failed to postprocess tensor");
     } catch (const c10::Error& e) {
       TS_LOGF(ERROR,
               "Failed to postprocess tensor for request id: {}, error: {}",
-              kv.second, e.msg());
-      auto response = (*response_batch)[kv.second];
-      response->SetResponse(500, "data_type",
-                            torchserve::PayloadType::kDATA_TYPE_STRING,
-                            "c10 error, failed to postprocess tensor");
+              slot.request_id, e.msg());
+      batch_context.Fail(i, "c10 error, failed to postprocess tensor");
     }
   }
 }
@@ -7,15 +7,24 @@
 #include <functional>
 #include <map>
 #include <memory>
+#include <optional>
 #include <ratio>
 #include <utility>
+#include <vector>
 
+#include "src/backends/handler/batch_context.hh"
+#include "src/backends/handler/session_store.hh"
 #include "src/utils/logging.hh"
 #include "src/utils/message.hh"
 #include "src/utils/metrics/registry.hh"
 #include "src/utils/model_archive.hh"
 
 namespace torchserve {
+// Delivers an intermediate response batch to the frontend. Returns false if
+// it could not be sent.
+using IntermediateResponseSender =
+    std::function<bool(std::shared_ptr<torchserve::InferenceResponseBatch>&)>;
+
 /**
  * @brief
  * TorchBaseHandler <=> BaseHandler:
@@ -32,29 +41,67 @@ class BaseHandler {
   virtual ~BaseHandler() = default;
 
   virtual void Initialize(const std::string& model_dir,
-                          std::shared_ptr<torchserve::Manifest>& manifest) {
-    model_dir_ = model_dir;
-    manifest_ = manifest;
-  };
+                          std::shared_ptr<torchserve::Manifest>& manifest);
 
   virtual std::pair<std::shared_ptr<void>, std::shared_ptr<torch::Device>>
   LoadModel(std::shared_ptr<LoadModelRequest>& load_model_request) = 0;
 
+  /**
+   * @brief
+   * Runs batches of the manifest's warmupSamples through a model returned by
+   * LoadModel before its instance is reported ready, so that live requests
+   * do not pay for the lazy initialization of the first batches, e.g.
+   * profiling executor passes, allocator growth or oneDNN primitives.
+   * Each batch size the instance is expected to see, powers of two up to the
+   * load request's batch size and the batch size itself, runs
+   * warmupIterations times. Does nothing without warmupSamples; handlers can
+   * override it, e.g. to warm up on synthetic inputs.
+   */
+  virtual void Warmup(
+      std::shared_ptr<void> model, std::shared_ptr<torch::Device>& device,
+      std::shared_ptr<LoadModelRequest>& load_model_request);
+
+  /**
+   * @brief
+   * Times warmupIterations batches of the warmupSamples, at the load
+   * request's batch size, with each of the intra-op thread counts in
+   * candidates. Returns the fastest count, or 0 without warmupSamples.
+   * Leaves at::set_num_threads at the last candidate.
+   */
+  virtual int TuneIntraOpThreads(
+      std::shared_ptr<void> model, std::shared_ptr<torch::Device>& device,
+      std::shared_ptr<LoadModelRequest>& load_model_request,
+      const std::vector<int>& candidates);
+
+  // Whether LoadModel can run on several threads at once, e.g. to load
+  // instances for different devices in parallel. Handlers that keep state
+  // from LoadModel in members must leave this false.
+  virtual bool IsLoadModelThreadSafe() const { return false; }
+
+  // Whether Handle keeps state of one frontend connection between calls,
+  // e.g. a decode set the frontend drives. The worker then serves a single
+  // connection and does not batch across connections.
+  virtual bool KeepsConnectionState() const { return false; }
+
+  // Preprocess adds a slot to batch_context for each request it batches, in
+  // the order of the model's input batch. Inference and Postprocess answer
+  // the slots, and skip the ones that failed. The requests point into
+  // request_batch, which is released after Handle returns, so inputs that
+  // wrap their payloads in place must be copied before then.
   virtual c10::IValue Preprocess(
       std::shared_ptr<torch::Device>& device,
-      std::pair<std::string&, std::map<uint8_t, std::string>&>& idx_to_req_id,
-      std::shared_ptr<torchserve::InferenceRequestBatch>& request_batch,
+      torchserve::BatchContext& batch_context,
+      std::shared_ptr<torchserve::InferenceRequestViewBatch>& request_batch,
       std::shared_ptr<torchserve::InferenceResponseBatch>& response_batch);
 
   virtual c10::IValue Inference(
       std::shared_ptr<void> model, c10::IValue& inputs,
       std::shared_ptr<torch::Device>& device,
-      std::pair<std::string&, std::map<uint8_t, std::string>&>& idx_to_req_id,
+      torchserve::BatchContext& batch_context,
       std::shared_ptr<torchserve::InferenceResponseBatch>& response_batch);
 
   virtual void Postprocess(
-      c10::IValue& data,
-      std::pair<std::string&, std::map<uint8_t, std::string>&>& idx_to_req_id,
+      c10::IValue& data, torchserve::BatchContext& batch_context,
       std::shared_ptr<torchserve::InferenceResponseBatch>& response_batch);
 
   /**
@@ -62,18 +109,99 @@ class BaseHandler {
    * function Predict <=> entry point function handle
    * /serve/ts/torch_handler/base_handler.py#L205
    * @param inference_request
+   * @param response_batch reset for request_batch, the response of each
+   * request is at its index, see InferenceResponseBatch::Reset
+   * @param intermediate_response_sender used by SendIntermediateResponse,
+   * streaming is disabled if empty
    * @return std::shared_ptr<torchserve::InferenceResponse>
    */
   void Handle(
       std::shared_ptr<void> model, std::shared_ptr<torch::Device>& device,
-      std::shared_ptr<torchserve::InferenceRequestBatch>& request_batch,
-      std::shared_ptr<torchserve::InferenceResponseBatch>& response_batch);
+      std::shared_ptr<torchserve::InferenceRequestViewBatch>& request_batch,
+      std::shared_ptr<torchserve::InferenceResponseBatch>& response_batch,
+      const IntermediateResponseSender& intermediate_response_sender = {});
 
  protected:
   std::shared_ptr<torch::Device> GetTorchDevice(
       std::shared_ptr<torchserve::LoadModelRequest>& load_model_request);
 
+  /**
+   * @brief
+   * send_intermediate_predict_response <=>
+   * serve/ts/protocol/otf_message_handler.py
+   *
+   * Sends partial results for the requests in intermediate_batch ahead of
+   * their final responses in response_batch, e.g. one generated token at a
+   * time. Can be called any number of times from Preprocess, Inference or
+   * Postprocess, on the thread running Handle. intermediate_batch is sent
+   * before this returns and can be reused afterwards.
+   *
+   * The final response of a streamed request ends the stream, so it should
+   * only carry what has not been sent yet; IsStreamed tells whether a
+   * response has been streamed.
+   *
+   * @return false if streaming is not enabled for this call or sending failed
+   */
+  bool SendIntermediateResponse(
+      std::shared_ptr<torchserve::InferenceResponseBatch>& intermediate_batch,
+      std::shared_ptr<torchserve::InferenceResponseBatch>& response_batch);
+
+  static bool IsStreamed(const torchserve::InferenceResponse& response);
+
+  // The model of the Handle call in progress on this thread, for handlers
+  // that keep state per model, e.g. per ModelInstance, in Preprocess or
+  // Postprocess, which are not given the model.
+  static const void* HandledModel() { return handled_model_; }
+
+  // Reads the manifest's warmupSamples, returns false if there are none or
+  // one can not be read.
+  bool LoadWarmupSamples(std::vector<std::vector<char>>& samples);
+
+  int GetWarmupIterations();
+
+  // Handles a batch of batch_size requests made of samples, returns the
+  // number of requests that failed.
+  size_t RunWarmupBatch(std::shared_ptr<void>& model,
+                        std::shared_ptr<torch::Device>& device,
+                        const std::vector<std::vector<char>>& samples,
+                        int batch_size);
+
+  // Answers the requests of request_batch whose deadline has passed with
+  // kCODE_DEADLINE_EXCEEDED and removes them from request_batch, so that no
+  // work is spent on responses the client no longer waits for. Returns the
+  // number of requests removed.
+  size_t DropExpiredRequests(
+      torchserve::InferenceRequestViewBatch& request_batch,
+      torchserve::InferenceResponseBatch& response_batch);
+
+  // Deadline of a request on the steady clock, nullopt if none, by the first
+  // of:
+  // - its ts_request_timeout_ms header, from the time it was received,
+  // - its ts_request_deadline_ms header,
+  // - response_timeout_ from its ts_request_enqueue_time_ms header, or from
+  //   the time it was received.
+  std::optional<std::chrono::steady_clock::time_point> GetDeadline(
+      const torchserve::InferenceRequestView& request) const;
+
+  // Sequence id of a request sent with sequence batching, empty if none.
+  static std::string GetSequenceId(
+      const torchserve::InferenceRequestView& request);
+
   std::shared_ptr<torchserve::Manifest> manifest_;
   std::string model_dir_;
+  // State of sequences kept between their requests, keyed by sequence id.
+  // The state of a sequence is dropped after its last request, i.e. the one
+  // with ts_request_sequence_end "true".
+  SessionStore session_store_;
+  // the manifest's responseTimeoutSec, 0 if not set
+  std::chrono::milliseconds response_timeout_{0};
+
+ private:
+  // the handler is shared by the connections of a worker, so the sender of
+  // the Handle call in progress is kept per thread
+  inline static thread_local const IntermediateResponseSender*
+      intermediate_response_sender_ = nullptr;
+  inline static thread_local bool intermediate_response_sent_ = false;
+  inline static thread_local const void* handled_model_ = nullptr;
 };
 }  // namespace torchserve
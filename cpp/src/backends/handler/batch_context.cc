@@ -0,0 +1,51 @@
+#include "src/backends/handler/batch_context.hh"
+
+namespace torchserve {
+size_t BatchContext::Add(std::string_view request_id,
+                         InferenceResponse* response) {
+  auto& slot = slots_.emplace_back();
+  slot.request_id = request_id;
+  slot.response = response;
+  return slots_.size() - 1;
+}
+
+void BatchContext::Fail(size_t index, const std::string& message) {
+  auto& slot = slots_[index];
+  slot.response->SetResponse(500, "data_type",
+                             torchserve::PayloadType::kDATA_TYPE_STRING,
+                             message);
+  slot.status = Status::FAILED;
+}
+
+void BatchContext::FailPending(const std::string& message) {
+  for (size_t i = 0; i < slots_.size(); ++i) {
+    if (slots_[i].status == Status::PENDING) {
+      Fail(i, message);
+    }
+  }
+}
+
+void BatchContext::Finish() {
+  for (auto& slot : slots_) {
+    if (slot.status == Status::PENDING) {
+      slot.status = Status::DONE;
+    }
+  }
+}
+
+std::string BatchContext::RequestIds() const {
+  size_t size = 0;
+  for (const auto& slot : slots_) {
+    size += slot.request_id.size() + 1;
+  }
+  std::string request_ids;
+  request_ids.reserve(size);
+  for (const auto& slot : slots_) {
+    if (!request_ids.empty()) {
+      request_ids += ',';
+    }
+    request_ids += slot.request_id;
+  }
+  return request_ids;
+}
+}  // namespace torchserve
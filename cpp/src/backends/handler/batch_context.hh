@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstddef>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "src/utils/message.hh"
+
+namespace torchserve {
+/**
+ * @brief
+ * The requests of a batch that reach the model, passed by BaseHandler::Handle
+ * through Preprocess, Inference and Postprocess. Slot i is the request at
+ * position i of the model's input batch, e.g. row i of a stacked tensor, so
+ * handlers find its request id and response without a lookup.
+ *
+ * Preprocess adds a slot for every request it batches; requests it rejects
+ * get their error response without a slot.
+ */
+class BatchContext {
+ public:
+  enum class Status {
+    // waiting for its response
+    PENDING,
+    // response set by Postprocess
+    DONE,
+    // error response set, later stages skip the slot
+    FAILED
+  };
+
+  struct Slot {
+    // into the request batch of the call, which outlives the context
+    std::string_view request_id;
+    // in the response batch of the call, which outlives the context
+    InferenceResponse* response = nullptr;
+    Status status = Status::PENDING;
+    // answer with a raw tensor, as the request was sent, see
+    // BaseHandler::Postprocess
+    bool raw_tensor = false;
+  };
+
+  // Reserves slots for a batch of batch_size requests.
+  void Reserve(size_t batch_size) { slots_.reserve(batch_size); }
+
+  // Adds the request at the next position of the batch, returns its index.
+  size_t Add(std::string_view request_id, InferenceResponse* response);
+
+  // Answers the request of slot index with a 500 error message and skips it
+  // in the later stages.
+  void Fail(size_t index, const std::string& message);
+
+  // Fails every pending slot, e.g. after the batch failed in Inference.
+  void FailPending(const std::string& message);
+
+  // Marks every pending slot done, called after Postprocess.
+  void Finish();
+
+  Slot& operator[](size_t index) { return slots_[index]; }
+  const Slot& operator[](size_t index) const { return slots_[index]; }
+
+  size_t Size() const { return slots_.size(); }
+  bool Empty() const { return slots_.empty(); }
+
+  std::vector<Slot>::iterator begin() { return slots_.begin(); }
+  std::vector<Slot>::iterator end() { return slots_.end(); }
+  std::vector<Slot>::const_iterator begin() const { return slots_.begin(); }
+  std::vector<Slot>::const_iterator end() const { return slots_.end(); }
+
+  // Comma separated request ids of the slots, e.g. for metrics and logs.
+  std::string RequestIds() const;
+
+ private:
+  std::vector<Slot> slots_;
+};
+}  // namespace torchserve
@@ -0,0 +1,326 @@
+#include "src/backends/handler/continuous_batching_handler.hh"
+
+#include <algorithm>
+#include <numeric>
+#include <stdexcept>
+
+namespace torchserve {
+void ContinuousBatchingHandler::Warmup(
+    std::shared_ptr<void> model, std::shared_ptr<torch::Device>& device,
+    std::shared_ptr<LoadModelRequest>& load_model_request) {
+  if (continuous_batching_) {
+    if (!manifest_->GetModel().warmup_samples.empty()) {
+      TS_LOG(WARN, "Warmup is not supported with continuous batching");
+    }
+    return;
+  }
+  BaseHandler::Warmup(model, device, load_model_request);
+}
+
+int ContinuousBatchingHandler::TuneIntraOpThreads(
+    std::shared_ptr<void> model, std::shared_ptr<torch::Device>& device,
+    std::shared_ptr<LoadModelRequest>& load_model_request,
+    const std::vector<int>& candidates) {
+  // same as Warmup, the samples would start sequences
+  if (continuous_batching_) {
+    return 0;
+  }
+  return BaseHandler::TuneIntraOpThreads(model, device, load_model_request,
+                                         candidates);
+}
+
+ContinuousBatchingHandler::ModelState&
+ContinuousBatchingHandler::GetModelState(const void* model) {
+  std::lock_guard<std::mutex> lock(models_mutex_);
+  auto& state = models_[model];
+  if (!state) {
+    state = std::make_unique<ModelState>();
+  }
+  return *state;
+}
+
+c10::IValue ContinuousBatchingHandler::Preprocess(
+    std::shared_ptr<torch::Device>& device,
+    torchserve::BatchContext& batch_context,
+    std::shared_ptr<torchserve::InferenceRequestViewBatch>& request_batch,
+    std::shared_ptr<torchserve::InferenceResponseBatch>& response_batch) {
+  auto& state = GetModelState(HandledModel());
+  std::lock_guard<std::mutex> lock(state.mutex);
+  Sequences live_sequences;
+  for (auto& request : request_batch->requests) {
+    auto* response = &(*response_batch)[request.index];
+
+    auto data =
+        request.GetParameter(torchserve::PayloadType::kPARAMETER_NAME_DATA);
+    if (!data) {
+      data =
+          request.GetParameter(torchserve::PayloadType::kPARAMETER_NAME_BODY);
+    }
+
+    std::shared_ptr<Sequence> sequence;
+    if (data) {
+      auto sequence_id = GetSequenceId(request);
+      std::shared_ptr<Sequence> previous;
+      if (!sequence_id.empty()) {
+        previous =
+            std::static_pointer_cast<Sequence>(session_store_.Get(sequence_id));
+        session_store_.Erase(sequence_id);
+      }
+      try {
+        sequence = StartSequence(std::string(*data), previous);
+        sequence->sequence_id = sequence_id;
+      } catch (const std::runtime_error& e) {
+        TS_LOGF(ERROR, "Failed to start sequence for request id: {}, error: {}",
+                request.request_id, e.what());
+        response->SetResponse(500, "data_type",
+                              torchserve::PayloadType::kDATA_TYPE_STRING,
+                              "runtime_error, failed to start sequence");
+        continue;
+      }
+    } else {
+      auto sequence_it = state.sequences.find(request.request_id);
+      if (!continuous_batching_ || sequence_it == state.sequences.end()) {
+        TS_LOGF(ERROR, "Empty payload for request id: {}", request.request_id);
+        response->SetResponse(500, "data_type",
+                              torchserve::PayloadType::kCONTENT_TYPE_TEXT,
+                              "Empty payload");
+        continue;
+      }
+      sequence = sequence_it->second;
+    }
+    live_sequences[std::string(request.request_id)] = sequence;
+    batch_context.Add(request.request_id, response);
+  }
+  if (continuous_batching_) {
+    // the frontend sends every live request in each iteration, the others
+    // are dropped
+    state.sequences = std::move(live_sequences);
+  } else {
+    for (auto& [request_id, sequence] : live_sequences) {
+      state.sequences[request_id] = sequence;
+    }
+  }
+  return c10::IValue();
+}
+
+c10::IValue ContinuousBatchingHandler::Inference(
+    std::shared_ptr<void> model, c10::IValue& inputs,
+    std::shared_ptr<torch::Device>& device,
+    torchserve::BatchContext& batch_context,
+    std::shared_ptr<torchserve::InferenceResponseBatch>& response_batch) {
+  auto& state = GetModelState(model.get());
+  std::unique_lock<std::mutex> lock(state.mutex);
+  std::vector<std::string_view> request_ids;
+  std::vector<std::shared_ptr<Sequence>> sequences;
+  request_ids.reserve(batch_context.Size());
+  sequences.reserve(batch_context.Size());
+  for (const auto& slot : batch_context) {
+    auto sequence_it = state.sequences.find(slot.request_id);
+    if (sequence_it == state.sequences.end()) {
+      // like std::map::at, which only takes the key type before C++26
+      throw std::out_of_range("no sequence for request id: " +
+                              std::string(slot.request_id));
+    }
+    request_ids.push_back(slot.request_id);
+    sequences.push_back(sequence_it->second);
+  }
+
+  std::vector<std::string> texts(sequences.size());
+  std::string error;
+  try {
+    if (!continuous_batching_) {
+      // other calls join the generation in the meantime
+      lock.unlock();
+      Generate(model, state, request_ids, sequences, texts, response_batch);
+    } else if (!sequences.empty()) {
+      Step(model, sequences);
+      for (size_t i = 0; i < sequences.size(); ++i) {
+        texts[i] = sequences[i]->piece;
+      }
+    }
+  } catch (const std::runtime_error& e) {
+    error = e.what();
+  } catch (const c10::Error& e) {
+    error = e.msg();
+  }
+  if (!lock.owns_lock()) {
+    lock.lock();
+  }
+  if (!error.empty()) {
+    // the state of a failed step is unknown, so the whole decode set fails
+    TS_LOGF(ERROR, "Failed to run inference on requests: {}, error: {}",
+            batch_context.RequestIds(), error);
+    for (auto request_id : request_ids) {
+      auto sequence_it = state.sequences.find(request_id);
+      if (sequence_it != state.sequences.end()) {
+        state.sequences.erase(sequence_it);
+      }
+    }
+    batch_context.FailPending("failed to generate the next token");
+  }
+
+  c10::List<std::string> outputs;
+  for (auto& text : texts) {
+    outputs.push_back(std::move(text));
+  }
+  return outputs;
+}
+
+void ContinuousBatchingHandler::Generate(
+    std::shared_ptr<void>& model, ModelState& state,
+    const std::vector<std::string_view>& request_ids,
+    std::vector<std::shared_ptr<Sequence>>& sequences,
+    std::vector<std::string>& texts,
+    std::shared_ptr<torchserve::InferenceResponseBatch>& response_batch) {
+  std::unique_lock<std::mutex> lock(state.mutex);
+  std::vector<std::shared_ptr<Decoding>> decodings;
+  decodings.reserve(sequences.size());
+  for (auto& sequence : sequences) {
+    decodings.push_back(std::make_shared<Decoding>());
+    decodings.back()->sequence = sequence;
+    state.decoding.push_back(decodings.back());
+  }
+
+  bool streaming = true;
+  std::vector<size_t> active(sequences.size());
+  std::iota(active.begin(), active.end(), 0);
+  // reused by every step, recycling the responses senders did not keep
+  auto intermediate_batch =
+      std::make_shared<torchserve::InferenceResponseBatch>();
+  std::vector<std::pair<size_t, size_t>> streamed;
+  while (!active.empty()) {
+    bool collect = std::any_of(active.begin(), active.end(), [&](size_t i) {
+      return decodings[i]->finished || !decodings[i]->error.empty() ||
+             (streaming && !decodings[i]->pieces.empty());
+    });
+    if (!collect) {
+      if (state.stepping) {
+        state.step_cv.wait(lock);
+      } else {
+        RunStep(model, state, lock);
+      }
+      continue;
+    }
+
+    // the last pieces of a sequence go into its final response
+    intermediate_batch->Clear();
+    streamed.clear();
+    std::vector<size_t> unfinished;
+    for (auto i : active) {
+      auto& decoding = *decodings[i];
+      if (!decoding.error.empty()) {
+        // sequences that joined after the failed Step leave as well
+        auto is_own = [&decodings](const std::shared_ptr<Decoding>& entry) {
+          return std::find(decodings.begin(), decodings.end(), entry) !=
+                 decodings.end();
+        };
+        state.decoding.erase(std::remove_if(state.decoding.begin(),
+                                            state.decoding.end(), is_own),
+                             state.decoding.end());
+        throw std::runtime_error(decoding.error);
+      }
+      if (decoding.finished || !streaming) {
+        texts[i] += decoding.pieces;
+        decoding.pieces.clear();
+      } else if (!decoding.pieces.empty()) {
+        intermediate_batch->Add(request_ids[i])
+            .SetResponse(200, "data_type",
+                         torchserve::PayloadType::kDATA_TYPE_STRING,
+                         decoding.pieces);
+        streamed.emplace_back(i, decoding.pieces.size());
+      }
+      if (!decoding.finished) {
+        unfinished.push_back(i);
+      }
+    }
+    active = std::move(unfinished);
+    if (intermediate_batch->Empty()) {
+      continue;
+    }
+    // Steps of other calls go on while this one sends
+    lock.unlock();
+    bool sent = SendIntermediateResponse(intermediate_batch, response_batch);
+    lock.lock();
+    if (sent) {
+      for (auto [i, size] : streamed) {
+        decodings[i]->pieces.erase(0, size);
+      }
+    } else {
+      // the pieces that were not sent are collected into texts
+      streaming = false;
+    }
+  }
+}
+
+void ContinuousBatchingHandler::RunStep(std::shared_ptr<void>& model,
+                                        ModelState& state,
+                                        std::unique_lock<std::mutex>& lock) {
+  state.stepping = true;
+  auto decoding = state.decoding;
+  std::vector<std::shared_ptr<Sequence>> step_sequences;
+  step_sequences.reserve(decoding.size());
+  for (auto& entry : decoding) {
+    step_sequences.push_back(entry->sequence);
+  }
+  lock.unlock();
+  std::string error;
+  try {
+    Step(model, step_sequences);
+  } catch (const std::runtime_error& e) {
+    error = e.what();
+  } catch (const c10::Error& e) {
+    error = e.msg();
+  }
+  lock.lock();
+  state.stepping = false;
+
+  for (auto& entry : decoding) {
+    if (!error.empty()) {
+      entry->error = error;
+    } else {
+      entry->pieces += entry->sequence->piece;
+      entry->finished = entry->sequence->finished;
+    }
+  }
+  // finished and failed sequences leave the decode set
+  state.decoding.erase(
+      std::remove_if(state.decoding.begin(), state.decoding.end(),
+                     [](const std::shared_ptr<Decoding>& entry) {
+                       return entry->finished || !entry->error.empty();
+                     }),
+      state.decoding.end());
+  state.step_cv.notify_all();
+}
+
+void ContinuousBatchingHandler::Postprocess(
+    c10::IValue& data, torchserve::BatchContext& batch_context,
+    std::shared_ptr<torchserve::InferenceResponseBatch>& response_batch) {
+  auto& state = GetModelState(HandledModel());
+  std::lock_guard<std::mutex> lock(state.mutex);
+  auto texts = data.toList();
+  for (size_t i = 0; i < batch_context.Size(); ++i) {
+    auto& slot = batch_context[i];
+    if (slot.status == BatchContext::Status::FAILED) {
+      continue;
+    }
+    auto sequence_it = state.sequences.find(slot.request_id);
+    bool finished =
+        sequence_it == state.sequences.end() || sequence_it->second->finished;
+    auto* response = slot.response;
+    response->SetResponse(200, "data_type",
+                          torchserve::PayloadType::kDATA_TYPE_STRING,
+                          texts.get(i).toStringRef());
+    if (continuous_batching_) {
+      response->headers[torchserve::PayloadType::kHEADER_NAME_STREAM_NEXT] =
+          finished ? "false" : "true";
+    }
+    if (finished && sequence_it != state.sequences.end()) {
+      if (!sequence_it->second->sequence_id.empty()) {
+        session_store_.Put(sequence_it->second->sequence_id,
+                           sequence_it->second);
+      }
+      state.sequences.erase(sequence_it);
+    }
+  }
+}
+}  // namespace torchserve
@@ -0,0 +1,170 @@
+#pragma once
+
+#include <condition_variable>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "src/backends/handler/base_handler.hh"
+
+namespace torchserve {
+/**
+ * @brief
+ * ContinuousBatchingHandler <=>
+ * ts/torch_handler/distributed/base_neuronx_continuous_batching_handler.py
+ *
+ * Iteration-level batching for generative handlers: the sequences of a batch
+ * are decoded together, one token per Step, instead of one after the other.
+ *
+ * With continuous_batching_ set, the model config has to set
+ * continuousBatching: true so the frontend's ContinuousBatching aggregator
+ * drives the worker, and every Handle call is one iteration over the decode
+ * set:
+ * - requests with a payload join it as new sequences,
+ * - requests resent without a payload (cached in backend) continue,
+ * - Step advances all of them by one token,
+ * - each request gets the piece generated in this iteration with
+ *   ts_stream_next "true", or "false" once its sequence finished, which
+ *   makes the frontend drop it from the next iteration.
+ * Finished sequences leave the decode set right away, and so do sequences
+ * the frontend no longer sends, e.g. because the client went away. The
+ * decode set therefore belongs to a single frontend connection, see
+ * KeepsConnectionState.
+ *
+ * Otherwise a Handle call runs Step until every sequence of its batch
+ * finished, finished sequences leave the decode set as soon as they are done
+ * and pieces are streamed if the worker supports it. Concurrent Handle calls
+ * on the same model, e.g. of several connections, share the decode set: the
+ * sequences of a call join it at the next Step of the generation in
+ * progress.
+ *
+ * The handler is shared by the ModelInstances of a worker, so the decode
+ * set, its sequences and the Step in progress are kept per model: each
+ * instance steps its own sequences with its own model, concurrently with
+ * the others.
+ *
+ * A finished sequence of a request with a sequence id is kept in
+ * session_store_, and the next request of that sequence continues it, e.g.
+ * a conversation reuses the KV cache of its previous turns.
+ */
+class ContinuousBatchingHandler : public BaseHandler {
+ public:
+  // Skipped with continuous_batching_, a warmup batch would replace the
+  // decode set of the connection being served.
+  void Warmup(std::shared_ptr<void> model,
+              std::shared_ptr<torch::Device>& device,
+              std::shared_ptr<LoadModelRequest>& load_model_request) override;
+
+  bool KeepsConnectionState() const override { return continuous_batching_; }
+
+  int TuneIntraOpThreads(std::shared_ptr<void> model,
+                         std::shared_ptr<torch::Device>& device,
+                         std::shared_ptr<LoadModelRequest>& load_model_request,
+                         const std::vector<int>& candidates) override;
+
+  c10::IValue Preprocess(
+      std::shared_ptr<torch::Device>& device,
+      torchserve::BatchContext& batch_context,
+      std::shared_ptr<torchserve::InferenceRequestViewBatch>& request_batch,
+      std::shared_ptr<torchserve::InferenceResponseBatch>& response_batch)
+      override;
+
+  c10::IValue Inference(
+      std::shared_ptr<void> model, c10::IValue& inputs,
+      std::shared_ptr<torch::Device>& device,
+      torchserve::BatchContext& batch_context,
+      std::shared_ptr<torchserve::InferenceResponseBatch>& response_batch)
+      override;
+
+  void Postprocess(
+      c10::IValue& data, torchserve::BatchContext& batch_context,
+      std::shared_ptr<torchserve::InferenceResponseBatch>& response_batch)
+      override;
+
+ protected:
+  // Generation state of one request, extended by the handler with e.g. its
+  // tokens, position and KV cache.
+  struct Sequence : public SessionStore::State {
+    // handlers add the memory they hold, e.g. the KV cache
+    size_t Bytes() const override { return sizeof(Sequence) + piece.size(); }
+
+    // text generated by the last Step, sent as the response of this iteration
+    std::string piece;
+    bool finished = false;
+    // session the sequence is kept for once finished, empty if none
+    std::string sequence_id;
+  };
+
+  // Creates the sequence of a new request, e.g. tokenizes the prompt.
+  // previous is the finished sequence of the same session, if any, which the
+  // new one may continue. Throws std::runtime_error if the prompt can not be
+  // used.
+  virtual std::shared_ptr<Sequence> StartSequence(
+      const std::string& prompt, std::shared_ptr<Sequence> previous) = 0;
+
+  // Advances every sequence by one token, a sequence that did not run yet
+  // prefills its prompt first. Sets piece and finished of each sequence.
+  virtual void Step(std::shared_ptr<void>& model,
+                    std::vector<std::shared_ptr<Sequence>>& sequences) = 0;
+
+  // one Step per Handle call, driven by the frontend, see above
+  bool continuous_batching_ = false;
+
+ private:
+  // A sequence in the decode set shared by the Generate calls.
+  struct Decoding {
+    std::shared_ptr<Sequence> sequence;
+    // pieces generated since its Generate call last collected them
+    std::string pieces;
+    bool finished = false;
+    // set if its Step failed
+    std::string error;
+  };
+
+  // by request id, found by the request views' ids without a copy
+  using Sequences =
+      std::map<std::string, std::shared_ptr<Sequence>, std::less<>>;
+
+  // The decode state of one model.
+  struct ModelState {
+    // guards the members below; with continuous_batching_ also held across
+    // Step
+    std::mutex mutex;
+    Sequences sequences;
+    std::vector<std::shared_ptr<Decoding>> decoding;
+    // whether a Generate call runs Step, one at a time
+    bool stepping = false;
+    // notified when a Step completes
+    std::condition_variable step_cv;
+  };
+
+  // The state of model, created on first use.
+  ModelState& GetModelState(const void* model);
+
+  // Joins sequences to the decode set of state and runs Step, or waits for
+  // the Step of another call, until every sequence finished. Appends the
+  // pieces that were not streamed to texts. Throws std::runtime_error if a
+  // Step failed.
+  void Generate(std::shared_ptr<void>& model, ModelState& state,
+                const std::vector<std::string_view>& request_ids,
+                std::vector<std::shared_ptr<Sequence>>& sequences,
+                std::vector<std::string>& texts,
+                std::shared_ptr<torchserve::InferenceResponseBatch>&
+                    response_batch);
+
+  // Runs one Step over the decode set of state with lock, on state.mutex,
+  // released meanwhile.
+  void RunStep(std::shared_ptr<void>& model, ModelState& state,
+               std::unique_lock<std::mutex>& lock);
+
+  // guards models_, not the states in it
+  std::mutex models_mutex_;
+  // by model, see BaseHandler::HandledModel; never erased, so references
+  // stay valid for the lifetime of the handler
+  std::unordered_map<const void*, std::unique_ptr<ModelState>> models_;
+};
+}  // namespace torchserve
@@ -0,0 +1,164 @@
+#include "raw_tensor.hh"
+
+#include <algorithm>
+#include <array>
+#include <cstring>
+#include <limits>
+#include <stdexcept>
+#include <type_traits>
+
+namespace torchserve {
+namespace {
+struct RawTensorDtype {
+  // follows c10::ScalarType
+  uint8_t code;
+  torch::ScalarType scalar_type;
+  int64_t element_size;
+};
+
+constexpr std::array<RawTensorDtype, 10> kDtypes = {{
+    {0, torch::kByte, 1},
+    {1, torch::kChar, 1},
+    {2, torch::kShort, 2},
+    {3, torch::kInt, 4},
+    {4, torch::kLong, 8},
+    {5, torch::kHalf, 2},
+    {6, torch::kFloat, 4},
+    {7, torch::kDouble, 8},
+    {11, torch::kBool, 1},
+    {15, torch::kBFloat16, 2},
+}};
+
+template <typename T>
+T ReadLittleEndian(const char* data) {
+  using Unsigned = std::make_unsigned_t<T>;
+  Unsigned value = 0;
+  for (size_t i = 0; i < sizeof(T); ++i) {
+    value |= static_cast<Unsigned>(static_cast<uint8_t>(data[i])) << (8 * i);
+  }
+  return static_cast<T>(value);
+}
+
+template <typename T>
+void WriteLittleEndian(char* data, T value) {
+  auto unsigned_value = static_cast<std::make_unsigned_t<T>>(value);
+  for (size_t i = 0; i < sizeof(T); ++i) {
+    data[i] = static_cast<char>((unsigned_value >> (8 * i)) & 0xff);
+  }
+}
+
+size_t HeaderSize(size_t ndim) {
+  return RawTensor::kFixedHeaderSize + 2 * ndim * sizeof(int64_t);
+}
+}  // namespace
+
+bool RawTensor::IsRawTensor(std::string_view payload) {
+  return payload.size() >= kFixedHeaderSize &&
+         std::memcmp(payload.data(), kMagic, sizeof(kMagic)) == 0;
+}
+
+torch::Tensor RawTensor::Decode(std::string_view payload) {
+  if (!IsRawTensor(payload)) {
+    throw std::runtime_error("raw tensor payload has no valid header");
+  }
+  const char* header = payload.data();
+  if (static_cast<uint8_t>(header[4]) != kVersion) {
+    throw std::runtime_error("unsupported raw tensor version");
+  }
+  auto dtype_code = static_cast<uint8_t>(header[5]);
+  auto dtype_it = std::find_if(
+      kDtypes.begin(), kDtypes.end(),
+      [dtype_code](const auto& dtype) { return dtype.code == dtype_code; });
+  if (dtype_it == kDtypes.end()) {
+    throw std::runtime_error("unsupported raw tensor dtype");
+  }
+  auto ndim = ReadLittleEndian<uint16_t>(header + 6);
+  size_t header_size = HeaderSize(ndim);
+  if (payload.size() < header_size) {
+    throw std::runtime_error("truncated raw tensor header");
+  }
+
+  std::vector<int64_t> shape(ndim);
+  std::vector<int64_t> strides(ndim);
+  const char* dims = header + kFixedHeaderSize;
+  for (size_t i = 0; i < ndim; ++i) {
+    shape[i] = ReadLittleEndian<int64_t>(dims + i * sizeof(int64_t));
+    strides[i] =
+        ReadLittleEndian<int64_t>(dims + (ndim + i) * sizeof(int64_t));
+  }
+
+  // elements spanned by the tensor, i.e. one past its last element
+  int64_t span = 1;
+  bool empty = false;
+  for (size_t i = 0; i < ndim; ++i) {
+    if (shape[i] < 0 || strides[i] < 0) {
+      throw std::runtime_error("negative raw tensor shape or stride");
+    }
+    int64_t extent = 0;
+    if (shape[i] == 0) {
+      empty = true;
+    } else if (__builtin_mul_overflow(shape[i] - 1, strides[i], &extent) ||
+               __builtin_add_overflow(span, extent, &span)) {
+      throw std::runtime_error("raw tensor shape overflows");
+    }
+  }
+  int64_t data_size = 0;
+  if (!empty &&
+      __builtin_mul_overflow(span, dtype_it->element_size, &data_size)) {
+    throw std::runtime_error("raw tensor shape overflows");
+  }
+  if (static_cast<uint64_t>(data_size) > payload.size() - header_size) {
+    throw std::runtime_error("raw tensor data is shorter than its shape");
+  }
+
+  auto options = torch::TensorOptions().dtype(dtype_it->scalar_type);
+  // from_blob takes a mutable pointer, the tensor is only read
+  return torch::from_blob(const_cast<char*>(payload.data()) + header_size,
+                          shape, strides, options);
+}
+
+std::vector<char> RawTensor::Encode(const torch::Tensor& tensor) {
+  std::vector<char> payload;
+  Encode(tensor, payload);
+  return payload;
+}
+
+void RawTensor::Encode(const torch::Tensor& tensor,
+                       std::vector<char>& payload) {
+  auto cpu_tensor = tensor.to(torch::kCPU).contiguous();
+  auto dtype_it = std::find_if(kDtypes.begin(), kDtypes.end(),
+                               [&cpu_tensor](const auto& dtype) {
+                                 return dtype.scalar_type ==
+                                        cpu_tensor.scalar_type();
+                               });
+  if (dtype_it == kDtypes.end()) {
+    throw std::runtime_error("unsupported raw tensor dtype");
+  }
+  auto ndim = static_cast<size_t>(cpu_tensor.dim());
+  if (ndim > std::numeric_limits<uint16_t>::max()) {
+    throw std::runtime_error("too many raw tensor dimensions");
+  }
+
+  size_t header_size = HeaderSize(ndim);
+  size_t data_size = cpu_tensor.nbytes();
+  // keeps the capacity of payload, its bytes are all overwritten
+  payload.resize(header_size + data_size);
+  char* header = payload.data();
+  std::memcpy(header, kMagic, sizeof(kMagic));
+  header[4] = static_cast<char>(kVersion);
+  header[5] = static_cast<char>(dtype_it->code);
+  WriteLittleEndian<uint16_t>(header + 6, static_cast<uint16_t>(ndim));
+  char* dims = header + kFixedHeaderSize;
+  auto shape = cpu_tensor.sizes();
+  auto strides = cpu_tensor.strides();
+  for (size_t i = 0; i < ndim; ++i) {
+    WriteLittleEndian<int64_t>(dims + i * sizeof(int64_t), shape[i]);
+    WriteLittleEndian<int64_t>(dims + (ndim + i) * sizeof(int64_t),
+                               strides[i]);
+  }
+  if (data_size > 0) {
+    std::memcpy(payload.data() + header_size, cpu_tensor.data_ptr(),
+                data_size);
+  }
+}
+}  // namespace torchserve
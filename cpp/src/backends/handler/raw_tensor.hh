@@ -0,0 +1,48 @@
+#pragma once
+
+#include <torch/torch.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace torchserve {
+/**
+ * @brief
+ * Codec for PayloadType::kDATA_TYPE_RAW_TENSOR payloads, a cheaper
+ * alternative to torch::pickle_load / torch::pickle_save.
+ *
+ * Layout, all fields little-endian:
+ *   magic "TSRT" | version u8 | dtype u8 | ndim u16 |
+ *   shape int64[ndim] | strides int64[ndim] | data
+ * dtype uses the c10::ScalarType numbering, strides are in elements. The
+ * header size is a multiple of 8 so that data is aligned for every dtype as
+ * long as the payload buffer is.
+ */
+class RawTensor {
+ public:
+  static constexpr char kMagic[4] = {'T', 'S', 'R', 'T'};
+  static constexpr uint8_t kVersion = 1;
+  static constexpr size_t kFixedHeaderSize = 8;
+
+  // Checks the magic only, used to detect raw tensors sent as plain bytes.
+  static bool IsRawTensor(std::string_view payload);
+
+  /**
+   * @brief
+   * Wraps the data of payload in a tensor without copying it, so payload
+   * must outlive the returned tensor (clone it otherwise). The tensor must
+   * not be written to, payload may be read-only, e.g. shared memory.
+   * Throws std::runtime_error if the payload is malformed.
+   */
+  static torch::Tensor Decode(std::string_view payload);
+
+  // Header followed by the bytes of tensor, copied once from its storage.
+  static std::vector<char> Encode(const torch::Tensor& tensor);
+
+  // Like Encode, into payload, reusing its capacity, e.g. the msg of a
+  // pooled response.
+  static void Encode(const torch::Tensor& tensor, std::vector<char>& payload);
+};
+}  // namespace torchserve
@@ -0,0 +1,77 @@
+#include "src/backends/handler/session_store.hh"
+
+#include <iterator>
+
+#include "src/utils/logging.hh"
+
+namespace torchserve {
+std::shared_ptr<SessionStore::State> SessionStore::Get(
+    const std::string& sequence_id) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto index_it = index_.find(sequence_id);
+  if (index_it == index_.end()) {
+    return nullptr;
+  }
+  entries_.splice(entries_.begin(), entries_, index_it->second);
+  return index_it->second->state;
+}
+
+void SessionStore::Put(const std::string& sequence_id,
+                       std::shared_ptr<State> state) {
+  size_t bytes = state->Bytes();
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto index_it = index_.find(sequence_id);
+  if (index_it != index_.end()) {
+    EraseEntry(index_it->second);
+  }
+  if (bytes > capacity_bytes_) {
+    TS_LOGF(WARN,
+            "Session state of sequence id: {} needs {} bytes, more than the "
+            "capacity of {} bytes, it is not kept",
+            sequence_id, bytes, capacity_bytes_);
+    return;
+  }
+  entries_.push_front(Entry{sequence_id, std::move(state), bytes});
+  index_[sequence_id] = entries_.begin();
+  bytes_ += bytes;
+  Evict();
+}
+
+void SessionStore::Erase(const std::string& sequence_id) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto index_it = index_.find(sequence_id);
+  if (index_it != index_.end()) {
+    EraseEntry(index_it->second);
+  }
+}
+
+void SessionStore::SetCapacityBytes(size_t capacity_bytes) {
+  std::lock_guard<std::mutex> lock(mutex_);
+  capacity_bytes_ = capacity_bytes;
+  Evict();
+}
+
+size_t SessionStore::Size() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return entries_.size();
+}
+
+size_t SessionStore::Bytes() const {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return bytes_;
+}
+
+void SessionStore::EraseEntry(std::list<Entry>::iterator entry_it) {
+  bytes_ -= entry_it->bytes;
+  index_.erase(entry_it->sequence_id);
+  entries_.erase(entry_it);
+}
+
+void SessionStore::Evict() {
+  while (bytes_ > capacity_bytes_ && !entries_.empty()) {
+    TS_LOGF(DEBUG, "Evicting session state of sequence id: {}",
+            entries_.back().sequence_id);
+    EraseEntry(std::prev(entries_.end()));
+  }
+}
+}  // namespace torchserve
@@ -0,0 +1,70 @@
+#pragma once
+
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <utility>
+
+namespace torchserve {
+/**
+ * @brief
+ * State that handlers keep between the requests of a sequence (session),
+ * e.g. the tokens and KV cache of a multi-turn conversation, keyed by the
+ * sequence id header the frontend sets with sequence batching.
+ *
+ * The store is bounded by the bytes the states report; the least recently
+ * used sessions are evicted to make room. Thread-safe.
+ */
+class SessionStore {
+ public:
+  struct State {
+    virtual ~State() = default;
+
+    // memory held by the state, counted against the capacity of the store
+    virtual size_t Bytes() const = 0;
+  };
+
+  static constexpr size_t kDefaultCapacityBytes = 256UL << 20;
+
+  explicit SessionStore(size_t capacity_bytes = kDefaultCapacityBytes)
+      : capacity_bytes_(capacity_bytes) {}
+
+  // Returns nullptr if there is no state for sequence_id, e.g. because it was
+  // evicted. A state that is found becomes the most recently used.
+  std::shared_ptr<State> Get(const std::string& sequence_id);
+
+  // Stores state for sequence_id, replacing the previous one. Its size is
+  // taken now, so a state that grows has to be put again. A state larger
+  // than the capacity is not kept.
+  void Put(const std::string& sequence_id, std::shared_ptr<State> state);
+
+  void Erase(const std::string& sequence_id);
+
+  // Evicts the least recently used states until the rest fits.
+  void SetCapacityBytes(size_t capacity_bytes);
+
+  size_t Size() const;
+  size_t Bytes() const;
+
+ private:
+  struct Entry {
+    std::string sequence_id;
+    std::shared_ptr<State> state;
+    size_t bytes;
+  };
+
+  // requires mutex_
+  void EraseEntry(std::list<Entry>::iterator entry_it);
+  void Evict();
+
+  mutable std::mutex mutex_;
+  size_t capacity_bytes_;
+  size_t bytes_ = 0;
+  // most recently used first
+  std::list<Entry> entries_;
+  std::unordered_map<std::string, std::list<Entry>::iterator> index_;
+};
+}  // namespace torchserve
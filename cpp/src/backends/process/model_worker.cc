@@ -1,5 +1,7 @@
 #include "src/backends/process/model_worker.hh"
 
+#include <sys/mman.h>
+
 namespace fs = std::filesystem;
 
 namespace torchserve {
@@ -7,9 +9,47 @@ void SocketServer::Initialize(
     const std::string& socket_type, const std::string& socket_name,
     const std::string& host_addr, const std::string& port_num,
     const torchserve::Manifest::RuntimeType& runtime_type,
-    torchserve::DeviceType device_type, const std::string& model_dir) {
+    torchserve::DeviceType device_type, const std::string& model_dir,
+    unsigned int pipeline_depth, unsigned int max_connections,
+    bool use_io_uring, const std::string& capture_file,
+    unsigned int batch_size, unsigned int max_batch_delay_msec,
+    size_t shm_ring_bytes, size_t shm_min_response_bytes,
+    unsigned int worker_index) {
   unsigned short socket_family = AF_INET;
   socket_type_ = socket_type;
+  pipeline_depth_ = pipeline_depth;
+  max_connections_ = std::max(max_connections, 1U);
+  if (use_io_uring) {
+#ifdef TS_IO_URING_SUPPORTED
+    use_io_uring_ = IoUringSocket::IsSupported();
+    if (!use_io_uring_) {
+      TS_LOG(WARN, "Falling back to posix sockets");
+    }
+#else
+    TS_LOG(WARN, "io_uring is not supported on this platform");
+#endif
+  }
+  if (!capture_file.empty()) {
+    try {
+      capture_writer_ = std::make_shared<CaptureWriter>(capture_file);
+      TS_LOGF(INFO, "Capturing commands to {}", capture_file);
+    } catch (const std::runtime_error& e) {
+      TS_LOGF(ERROR, "Capture disabled: {}", e.what());
+    }
+  }
+  if (shm_ring_bytes > 0) {
+    auto ring_name = "/ts_worker_" + std::to_string(getpid());
+    auto region = SharedMemoryRegion::Create(ring_name, shm_ring_bytes);
+    if (region) {
+      shared_memory_channel_ = std::make_shared<SharedMemoryChannel>();
+      shared_memory_channel_->ring =
+          std::make_unique<SharedMemoryRing>(std::move(region));
+      shared_memory_channel_->min_response_size = shm_min_response_bytes;
+      TS_LOGF(INFO, "Shared memory payloads enabled, ring: {}", ring_name);
+    } else {
+      TS_LOG(ERROR, "Shared memory payloads disabled");
+    }
+  }
   if (device_type != "cpu" && device_type != "gpu") {
     TS_LOGF(WARN, "Invalid device type: {}", device_type);
   }
@@ -46,9 +86,23 @@ void SocketServer::Initialize(
     TS_LOGF(FATAL, "Failed to create socket descriptor. errno: {}", errno);
   }
 
-  if (!CreateBackend(runtime_type, model_dir)) {
+  if (!CreateBackend(runtime_type, model_dir, worker_index)) {
     TS_LOGF(FATAL, "Failed to create backend, model_dir: {}", model_dir);
   }
+  if (backend_->KeepsConnectionState() &&
+      (max_connections_ > 1 || batch_size > 0)) {
+    // another connection's batch would end the sequences of this one
+    TS_LOG(FATAL,
+           "The handler keeps state per connection, it requires "
+           "max_connections 1 and batch_size 0");
+  }
+  if (batch_size > 0) {
+    batch_aggregator_ = std::make_shared<BatchAggregator>(
+        [backend = backend_]() { return backend->GetModelInstance(); },
+        batch_size, std::chrono::milliseconds(max_batch_delay_msec));
+    TS_LOGF(INFO, "Batching up to {} requests across connections, delay {} ms",
+            batch_size, max_batch_delay_msec);
+  }
 }
 
 void SocketServer::Run() {
@@ -85,7 +139,7 @@ void SocketServer::Run() {
   if (bind(server_socket_, srv_sock_address, name_len) < 0) {
     TS_LOGF(FATAL, "Could not bind socket. errno: {}", errno);
   }
-  if (listen(server_socket_, 1) == -1) {
+  if (listen(server_socket_, static_cast<int>(max_connections_)) == -1) {
     TS_LOGF(FATAL, "Failed to listen on socket. errno: {}", errno);
   }
   TS_LOG(INFO, "Socket bind successful");
@@ -93,7 +147,20 @@ void SocketServer::Run() {
   // TODO: fix logging format to include logging level
   TS_LOG(INFO, "INFO Torch worker started.");
 
+  // number of connections being served, only used if max_connections_ > 1.
+  // Run never returns, so the connection threads can refer to these.
+  std::mutex connections_mutex;
+  std::condition_variable connections_cv;
+  unsigned int active_connections = 0;
+
   while (true) {
+    if (max_connections_ > 1) {
+      std::unique_lock<std::mutex> lock(connections_mutex);
+      connections_cv.wait(lock, [&]() {
+        return active_connections < max_connections_;
+      });
+    }
+
     socklen_t len = sizeof(client_sock_address);
     auto client_sock =
         accept(server_socket_, (sockaddr*)&client_sock_address, &len);
@@ -101,54 +168,285 @@ void SocketServer::Run() {
       TS_LOGF(FATAL, "Failed to accept client. errno: {}", errno);
     }
     TS_LOGF(INFO, "Connection accepted: {}", socket_name_);
-    auto model_worker =
-        std::make_unique<torchserve::SocketModelWorker>(client_sock, backend_);
+
+    if (max_connections_ == 1) {
+      RunModelWorker(client_sock);
+      if (shared_memory_channel_) {
+        shm_unlink(
+            shared_memory_channel_->ring->GetRegion()->GetName().c_str());
+      }
+      // the frontend starts a new worker process for each connection
+      std::exit(0);
+    }
+
+    {
+      std::lock_guard<std::mutex> lock(connections_mutex);
+      ++active_connections;
+    }
+    std::thread([&, client_sock]() {
+      RunModelWorker(client_sock);
+      {
+        std::lock_guard<std::mutex> lock(connections_mutex);
+        --active_connections;
+      }
+      connections_cv.notify_one();
+    }).detach();
+  }
+}
+
+void SocketServer::RunModelWorker(int client_sock) {
+  std::unique_ptr<BufferedSocket> client_socket;
+#ifdef TS_IO_URING_SUPPORTED
+  if (use_io_uring_) {
+    try {
+      client_socket = std::make_unique<IoUringSocket>(client_sock);
+    } catch (const SocketError& e) {
+      TS_LOGF(WARN, "Falling back to posix sockets: {}", e.what());
+    }
+  }
+#endif
+  if (!client_socket) {
+    client_socket = std::make_unique<BufferedSocket>(client_sock);
+  }
+  auto model_worker = std::make_unique<torchserve::SocketModelWorker>(
+      std::move(client_socket), backend_, capture_writer_, batch_aggregator_,
+      shared_memory_channel_);
+  if (pipeline_depth_ > 0) {
+    model_worker->RunPipelined(pipeline_depth_);
+  } else {
     model_worker->Run();
   }
 }
 
 bool SocketServer::CreateBackend(
     const torchserve::Manifest::RuntimeType& runtime_type,
-    const std::string& model_dir) {
+    const std::string& model_dir, unsigned int worker_index) {
   if (runtime_type == "LSP") {
     backend_ = std::make_shared<torchserve::Backend>();
-    return backend_->Initialize(model_dir);
+    return backend_->Initialize(model_dir, worker_index);
   }
   return false;
 }
 
-[[noreturn]] void SocketModelWorker::Run() {
+SocketModelWorker::SocketModelWorker(
+    std::unique_ptr<BufferedSocket> client_socket,
+    std::shared_ptr<torchserve::Backend> backend,
+    std::shared_ptr<CaptureWriter> capture_writer,
+    std::shared_ptr<BatchAggregator> batch_aggregator,
+    std::shared_ptr<SharedMemoryChannel> shared_memory_channel)
+    : client_socket_(std::move(client_socket)),
+      backend_(backend),
+      capture_writer_(std::move(capture_writer)),
+      batch_aggregator_(std::move(batch_aggregator)),
+      shared_memory_channel_(std::move(shared_memory_channel)) {
+  if (capture_writer_) {
+    capture_connection_id_ = capture_writer_->NextConnectionId();
+    client_socket_->SetCaptureEnabled(true);
+  }
+}
+
+void SocketModelWorker::Run() {
   TS_LOG(INFO, "Handle connection");
+  try {
+    HandleCommands();
+  } catch (const SocketError& e) {
+    TS_LOG(INFO, e.what());
+  }
+}
+
+[[noreturn]] void SocketModelWorker::HandleCommands() {
   while (true) {
-    char cmd = torchserve::OTFMessage::RetrieveCmd(client_socket_);
+    char cmd = torchserve::OTFMessage::RetrieveCmd(*client_socket_);
+    auto received = std::chrono::steady_clock::now();
 
     if (cmd == 'I') {
       TS_LOG(INFO, "INFER request received");
-      auto model_instance = backend_->GetModelInstance();
-      if (!model_instance) {
+      auto inference_requests = RetrieveInferenceRequests(received);
+      CaptureCommand(received);
+      auto response = response_pool_.Acquire();
+      // handed over, so that the shared memory the requests point to is
+      // released once Predict returns, before the responses are written
+      if (!Predict(std::move(inference_requests), response,
+                   [this](std::shared_ptr<InferenceResponseBatch>& batch) {
+                     return SendInferenceResponse(batch);
+                   })) {
         TS_LOG(ERROR,
                "Model is not loaded yet, not able to process this inference "
                "request.");
-      } else {
-        auto response = model_instance->Predict(
-            torchserve::OTFMessage::RetrieveInferenceMsg(client_socket_));
-        if (!torchserve::OTFMessage::SendInferenceResponse(client_socket_,
-                                                           response)) {
-          TS_LOG(ERROR, "Error writing inference response to socket");
-        }
+      } else if (!SendInferenceResponse(response)) {
+        TS_LOG(ERROR, "Error writing inference response to socket");
       }
+      response_pool_.Release(std::move(response));
     } else if (cmd == 'L') {
       TS_LOG(INFO, "LOAD request received");
+      auto load_model_request =
+          torchserve::OTFMessage::RetrieveLoadMsg(*client_socket_);
+      CaptureCommand(received);
       // TODO: error handling
-      auto backend_response = backend_->LoadModel(
-          torchserve::OTFMessage::RetrieveLoadMsg(client_socket_));
+      auto backend_response = backend_->LoadModel(load_model_request);
       if (!torchserve::OTFMessage::SendLoadModelResponse(
-              client_socket_, std::move(backend_response))) {
+              *client_socket_, std::move(backend_response))) {
         TS_LOG(ERROR, "Error writing response to socket");
       }
     } else {
       TS_LOGF(ERROR, "Received unknown command: {}", cmd);
+      CaptureCommand(received);
     }
   }
 }
+
+void SocketModelWorker::RunPipelined(unsigned int pipeline_depth) {
+  TS_LOGF(INFO, "Handle connection, pipeline depth: {}", pipeline_depth);
+  PipelineQueue decoded_queue(pipeline_depth);
+  PipelineQueue result_queue(pipeline_depth);
+
+  std::thread execute_thread(
+      [&]() { ExecuteStage(decoded_queue, result_queue); });
+  std::thread write_thread([&]() { WriteStage(result_queue); });
+  try {
+    ReadStage(decoded_queue);
+  } catch (const SocketError& e) {
+    TS_LOG(INFO, e.what());
+  }
+
+  // let the remaining commands drain through the pipeline
+  decoded_queue.Close();
+  execute_thread.join();
+  write_thread.join();
+}
+
+void SocketModelWorker::ReadStage(PipelineQueue& decoded_queue) {
+  while (true) {
+    auto item = std::make_unique<PipelineItem>();
+    item->cmd = torchserve::OTFMessage::RetrieveCmd(*client_socket_);
+    auto received = std::chrono::steady_clock::now();
+
+    if (item->cmd == 'I') {
+      TS_LOG(INFO, "INFER request received");
+      item->inference_requests = RetrieveInferenceRequests(received);
+    } else if (item->cmd == 'L') {
+      TS_LOG(INFO, "LOAD request received");
+      item->load_model_request =
+          torchserve::OTFMessage::RetrieveLoadMsg(*client_socket_);
+    } else {
+      TS_LOGF(ERROR, "Received unknown command: {}", item->cmd);
+      CaptureCommand(received);
+      continue;
+    }
+    CaptureCommand(received);
+    if (!decoded_queue.Push(std::move(item))) {
+      return;
+    }
+  }
+}
+
+void SocketModelWorker::ExecuteStage(PipelineQueue& decoded_queue,
+                                     PipelineQueue& result_queue) {
+  while (auto item = decoded_queue.Pop()) {
+    if ((*item)->cmd == 'I') {
+      (*item)->inference_responses = response_pool_.Acquire();
+      // The requests are handed over, see HandleCommands. Intermediate
+      // responses go through the writer thread as well, so that they are
+      // sent in order with the other responses.
+      bool predicted = Predict(
+          std::move((*item)->inference_requests), (*item)->inference_responses,
+          [this,
+           &result_queue](std::shared_ptr<InferenceResponseBatch>& batch) {
+            auto intermediate_item = std::make_unique<PipelineItem>();
+            intermediate_item->cmd = 'I';
+            intermediate_item->inference_responses = response_pool_.Acquire();
+            intermediate_item->inference_responses->Clear();
+            for (const auto& response : *batch) {
+              intermediate_item->inference_responses->Add(
+                  response.request_id) = response;
+            }
+            return result_queue.Push(std::move(intermediate_item));
+          });
+      if (!predicted) {
+        TS_LOG(ERROR,
+               "Model is not loaded yet, not able to process this inference "
+               "request.");
+        response_pool_.Release(std::move((*item)->inference_responses));
+        continue;
+      }
+    } else {
+      // TODO: error handling
+      (*item)->load_model_response =
+          backend_->LoadModel((*item)->load_model_request);
+    }
+    if (!result_queue.Push(std::move(*item))) {
+      break;
+    }
+  }
+  result_queue.Close();
+}
+
+void SocketModelWorker::WriteStage(PipelineQueue& result_queue) {
+  while (auto item = result_queue.Pop()) {
+    if ((*item)->cmd == 'I') {
+      if (!SendInferenceResponse((*item)->inference_responses)) {
+        TS_LOG(ERROR, "Error writing inference response to socket");
+      }
+      response_pool_.Release(std::move((*item)->inference_responses));
+    } else if (!torchserve::OTFMessage::SendLoadModelResponse(
+                   *client_socket_,
+                   std::move((*item)->load_model_response))) {
+      TS_LOG(ERROR, "Error writing response to socket");
+    }
+  }
+}
+
+std::shared_ptr<torchserve::InferenceRequestViewBatch>
+SocketModelWorker::RetrieveInferenceRequests(
+    std::chrono::steady_clock::time_point received) {
+  // handlers read the requests in the arena they were received into
+  auto request_batch =
+      torchserve::OTFMessage::RetrieveInferenceMsgView(*client_socket_);
+  if (shared_memory_channel_) {
+    // handlers read the payloads in the mapped segments, which are
+    // released once request_batch is destroyed, i.e. after Predict
+    torchserve::OTFMessage::ResolveSharedMemoryReferences(
+        *request_batch, shared_memory_channel_->registry);
+  }
+  for (auto& request : request_batch->requests) {
+    request.received = received;
+  }
+  return request_batch;
+}
+
+bool SocketModelWorker::SendInferenceResponse(
+    std::shared_ptr<torchserve::InferenceResponseBatch>& response_batch) {
+  if (shared_memory_channel_) {
+    torchserve::OTFMessage::WriteResponsesToSharedMemory(
+        response_batch, *shared_memory_channel_->ring,
+        shared_memory_channel_->min_response_size);
+  }
+  return torchserve::OTFMessage::SendInferenceResponse(*client_socket_,
+                                                       response_batch);
+}
+
+bool SocketModelWorker::Predict(
+    std::shared_ptr<torchserve::InferenceRequestViewBatch> request_batch,
+    std::shared_ptr<torchserve::InferenceResponseBatch>& response_batch,
+    const IntermediateResponseSender& intermediate_response_sender) {
+  if (batch_aggregator_) {
+    return batch_aggregator_->Predict(std::move(request_batch), response_batch,
+                                      intermediate_response_sender);
+  }
+  auto model_instance = backend_->GetModelInstance();
+  if (!model_instance) {
+    return false;
+  }
+  model_instance->Predict(std::move(request_batch), response_batch,
+                          intermediate_response_sender);
+  return true;
+}
+
+void SocketModelWorker::CaptureCommand(
+    std::chrono::steady_clock::time_point received) {
+  if (capture_writer_) {
+    capture_writer_->Write(capture_connection_id_, received,
+                           client_socket_->TakeCapturedFrame());
+  }
+}
 }  // namespace torchserve
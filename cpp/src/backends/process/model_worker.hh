@@ -6,14 +6,29 @@
 #include <sys/un.h>
 #include <unistd.h>
 
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
 #include <cstdio>
+#include <cstdlib>
 #include <filesystem>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <tuple>
 
 #include "src/backends/core/backend.hh"
+#include "src/backends/core/batch_aggregator.hh"
+#include "src/backends/protocol/buffered_socket.hh"
+#include "src/backends/protocol/capture.hh"
+#ifdef TS_IO_URING_SUPPORTED
+#include "src/backends/protocol/io_uring_socket.hh"
+#endif
 #include "src/backends/protocol/otf_message.hh"
+#include "src/backends/protocol/shared_memory.hh"
+#include "src/utils/bounded_queue.hh"
+#include "src/utils/object_pool.hh"
 #include "src/utils/config.hh"
 #include "src/utils/logging.hh"
 #include "src/utils/model_archive.hh"
@@ -42,14 +57,22 @@ class SocketServer {
                   const std::string& port_num,
                   const torchserve::Manifest::RuntimeType& runtime_type,
                   torchserve::DeviceType device_type,
-                  const std::string& model_dir);
+                  const std::string& model_dir, unsigned int pipeline_depth,
+                  unsigned int max_connections, bool use_io_uring,
+                  const std::string& capture_file = "",
+                  unsigned int batch_size = 0,
+                  unsigned int max_batch_delay_msec = 0,
+                  size_t shm_ring_bytes = 0,
+                  size_t shm_min_response_bytes = 0,
+                  unsigned int worker_index = 0);
 
   void Run();
 
  private:
   SocketServer(){};
   bool CreateBackend(const torchserve::Manifest::RuntimeType& runtime_type,
-                     const std::string& model_dir);
+                     const std::string& model_dir, unsigned int worker_index);
+  void RunModelWorker(int client_sock);
 
   // TODO; impl.
   // short MAX_FAILURE_THRESHOLD = 5;
@@ -58,20 +81,101 @@ class SocketServer {
   std::string socket_type_;
   std::string socket_name_;
   int port_ = 9000;
+  // 0: serial worker loop, otherwise see SocketModelWorker::RunPipelined
+  unsigned int pipeline_depth_ = 0;
+  // 1: the process serves a single frontend connection and exits with it.
+  // N > 1: up to N concurrent connections, each on its own thread, sharing
+  // backend_ and its model instances.
+  unsigned int max_connections_ = 1;
+  // serve connections with IoUringSocket instead of BufferedSocket
+  bool use_io_uring_ = false;
+  // records the commands of all connections if set
+  std::shared_ptr<CaptureWriter> capture_writer_;
   std::shared_ptr<torchserve::Backend> backend_;
+  // merges the batches of concurrent connections if set
+  std::shared_ptr<BatchAggregator> batch_aggregator_;
+  // shared by all connections if set
+  std::shared_ptr<SharedMemoryChannel> shared_memory_channel_;
 };
 
 class SocketModelWorker {
  public:
-  SocketModelWorker(int client_socket,
-                    std::shared_ptr<torchserve::Backend> backend)
-      : client_socket_(client_socket), backend_(backend){};
+  // Every command received is recorded to capture_writer if it is set.
+  // Inference runs through batch_aggregator if it is set. Payloads go through
+  // shared_memory_channel if it is set.
+  SocketModelWorker(
+      std::unique_ptr<BufferedSocket> client_socket,
+      std::shared_ptr<torchserve::Backend> backend,
+      std::shared_ptr<CaptureWriter> capture_writer = nullptr,
+      std::shared_ptr<BatchAggregator> batch_aggregator = nullptr,
+      std::shared_ptr<SharedMemoryChannel> shared_memory_channel = nullptr);
   ~SocketModelWorker() = default;
 
-  [[noreturn]] void Run();
+  // Returns once the frontend disconnects.
+  void Run();
+
+  /**
+   * @brief
+   * Pipelined variant of Run: a reader thread decodes the next command while
+   * an inference thread runs the current one and a writer thread sends the
+   * previous response. The stages are connected by BoundedQueues of
+   * pipeline_depth entries. Each stage is a single thread and the queues are
+   * FIFO, so responses are sent in the order the commands were received.
+   */
+  void RunPipelined(unsigned int pipeline_depth);
 
  private:
-  Socket client_socket_;
+  // A command travelling through the pipeline stages.
+  struct PipelineItem {
+    char cmd = '\0';
+    std::shared_ptr<torchserve::LoadModelRequest> load_model_request;
+    std::shared_ptr<torchserve::InferenceRequestViewBatch> inference_requests;
+    std::unique_ptr<torchserve::LoadModelResponse> load_model_response;
+    std::shared_ptr<torchserve::InferenceResponseBatch> inference_responses;
+  };
+  using PipelineQueue = BoundedQueue<std::unique_ptr<PipelineItem>>;
+
+  // response batches kept for reuse, enough for a few pipelined commands
+  static constexpr size_t kResponsePoolCapacity = 8;
+
+  // Serial command loop, exits by throwing SocketError on disconnect.
+  [[noreturn]] void HandleCommands();
+
+  void ReadStage(PipelineQueue& decoded_queue);
+  void ExecuteStage(PipelineQueue& decoded_queue, PipelineQueue& result_queue);
+  void WriteStage(PipelineQueue& result_queue);
+
+  // Decodes the requests of an 'I' command with
+  // OTFMessage::RetrieveInferenceMsgView, resolving shared memory references.
+  // Each request is stamped with received, the time its command arrived,
+  // which its deadline is measured from, see BaseHandler::GetDeadline.
+  std::shared_ptr<torchserve::InferenceRequestViewBatch>
+  RetrieveInferenceRequests(std::chrono::steady_clock::time_point received);
+
+  // Sends a response batch, large responses through the shared memory ring.
+  bool SendInferenceResponse(
+      std::shared_ptr<torchserve::InferenceResponseBatch>& response_batch);
+
+  // Runs request_batch directly on a model instance or through
+  // batch_aggregator_, answering into response_batch. Returns false if no
+  // model is loaded.
+  bool Predict(
+      std::shared_ptr<torchserve::InferenceRequestViewBatch> request_batch,
+      std::shared_ptr<torchserve::InferenceResponseBatch>& response_batch,
+      const IntermediateResponseSender& intermediate_response_sender);
+
+  // Records the command received at the given time, a no-op without capture.
+  void CaptureCommand(std::chrono::steady_clock::time_point received);
+
+  std::unique_ptr<BufferedSocket> client_socket_;
   std::shared_ptr<torchserve::Backend> backend_;
+  std::shared_ptr<CaptureWriter> capture_writer_;
+  uint32_t capture_connection_id_ = 0;
+  std::shared_ptr<BatchAggregator> batch_aggregator_;
+  std::shared_ptr<SharedMemoryChannel> shared_memory_channel_;
+  // response batches, released once they are sent, so that the next
+  // commands reuse their buffers
+  ObjectPool<torchserve::InferenceResponseBatch> response_pool_{
+      kResponsePoolCapacity};
 };
 }  // namespace torchserve
@@ -18,6 +18,35 @@ DEFINE_string(device_type, "cpu", "cpu, or gpu");
 DEFINE_string(model_dir, "", "model path");
 DEFINE_string(logger_config_path, "", "Logging config file path");
 DEFINE_string(metrics_config_path, "", "Metrics config file path");
+DEFINE_uint32(pipeline_depth, 0,
+              "0 to handle commands serially, otherwise the queue depth "
+              "between the read, inference and write threads");
+DEFINE_uint32(max_connections, 1,
+              "Number of frontend connections served concurrently by this "
+              "process. Connections share the loaded model instances.");
+DEFINE_bool(use_io_uring, false,
+            "Use io_uring for socket I/O, falls back to posix sockets if "
+            "io_uring is not available");
+DEFINE_string(capture_file, "",
+              "Record every command received to this file for replay with "
+              "ts_replay, empty to disable");
+DEFINE_uint32(batch_size, 0,
+              "Merge the inference requests of concurrent connections into "
+              "batches of up to this many requests, 0 to disable");
+DEFINE_uint32(max_batch_delay_msec, 100,
+              "Longest time a request waits for a merged batch to fill up");
+DEFINE_uint64(shm_ring_bytes, 0,
+              "Size of the shared memory ring responses are returned through, "
+              "0 to disable shared memory payloads. If set, parameters sent "
+              "as shared memory references are accepted as well");
+DEFINE_uint64(shm_min_response_bytes, 64 * 1024,
+              "Responses of at least this size go through the shared memory "
+              "ring, smaller ones are sent inline");
+DEFINE_uint32(worker_index, 0,
+              "Index of this worker among the workers of the model on the "
+              "host, e.g. its port minus the base port. Workers with "
+              "different indexes pin their CPU instances to different cpu "
+              "sets of cpuAffinity");
 
 int main(int argc, char* argv[]) {
   try {
@@ -40,7 +69,12 @@ int main(int argc, char* argv[]) {
 
     torchserve::SocketServer server = torchserve::SocketServer::GetInstance();
     server.Initialize(FLAGS_sock_type, FLAGS_sock_name, FLAGS_host, FLAGS_port,
-                      FLAGS_runtime_type, FLAGS_device_type, FLAGS_model_dir);
+                      FLAGS_runtime_type, FLAGS_device_type, FLAGS_model_dir,
+                      FLAGS_pipeline_depth, FLAGS_max_connections,
+                      FLAGS_use_io_uring, FLAGS_capture_file,
+                      FLAGS_batch_size, FLAGS_max_batch_delay_msec,
+                      FLAGS_shm_ring_bytes, FLAGS_shm_min_response_bytes,
+                      FLAGS_worker_index);
 
     server.Run();
 
@@ -0,0 +1,58 @@
+#include "buffered_socket.hh"
+
+#include <algorithm>
+#include <cstring>
+
+namespace torchserve {
+BufferedSocket::BufferedSocket(int client_socket, size_t buffer_size)
+    : Socket(client_socket), buffer_(std::max<size_t>(buffer_size, 1)) {}
+
+void BufferedSocket::RetrieveBuffer(size_t length, char* data) const {
+  char* pkt = data;
+  size_t total_length = length;
+  while (length > 0) {
+    if (read_pos_ == write_pos_) {
+      if (length >= buffer_.size()) {
+        // large payloads are received in place to avoid an extra copy
+        size_t pkt_size = Receive(pkt, length);
+        pkt += pkt_size;
+        length -= pkt_size;
+        continue;
+      }
+      read_pos_ = 0;
+      write_pos_ = Receive(buffer_.data(), buffer_.size());
+    }
+    size_t pkt_size = std::min(length, write_pos_ - read_pos_);
+    std::memcpy(pkt, buffer_.data() + read_pos_, pkt_size);
+    read_pos_ += pkt_size;
+    pkt += pkt_size;
+    length -= pkt_size;
+  }
+  if (capture_enabled_) {
+    captured_frame_.insert(captured_frame_.end(), data, data + total_length);
+  }
+}
+
+std::vector<char> BufferedSocket::TakeCapturedFrame() const {
+  std::vector<char> frame;
+  frame.swap(captured_frame_);
+  return frame;
+}
+
+size_t BufferedSocket::Receive(char* dest, size_t capacity) const {
+  while (true) {
+    ssize_t pkt_size = recv(client_socket_, dest, capacity, 0);
+    if (pkt_size == 0) {
+      throw SocketError("Frontend disconnected.");
+    }
+    if (pkt_size < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+      TS_LOGF(ERROR, "Error recieving data from socket. errno: {}", errno);
+      throw SocketError("Error recieving data from socket.");
+    }
+    return static_cast<size_t>(pkt_size);
+  }
+}
+}  // namespace torchserve
@@ -0,0 +1,56 @@
+#ifndef TS_CPP_BACKENDS_PROTOCOL_BUFFERED_SOCKET_HH_
+#define TS_CPP_BACKENDS_PROTOCOL_BUFFERED_SOCKET_HH_
+
+#include <cstddef>
+#include <vector>
+
+#include "socket.hh"
+
+namespace torchserve {
+/**
+ * @brief
+ * Socket with a read-ahead buffer on the receive path.
+ *
+ * Socket issues one recv() per OTF field (length prefix, header name, header
+ * value, parameter, ...). BufferedSocket instead drains as many bytes as are
+ * available into a local buffer with a single recv() and serves the field
+ * reads from there, so decoding a batch costs O(1) syscalls instead of
+ * O(fields). Reads larger than the buffer bypass it and go straight into the
+ * destination.
+ *
+ * RetrieveInt and RetrieveBool are inherited from Socket and go through the
+ * buffered RetrieveBuffer.
+ *
+ * With capture enabled, every byte handed out by RetrieveBuffer is also
+ * appended to a captured frame, so the worker can record commands exactly as
+ * they were received, see TakeCapturedFrame.
+ */
+class BufferedSocket : public Socket {
+ public:
+  static constexpr size_t kDefaultBufferSize = 256 * 1024;
+
+  BufferedSocket(int client_socket,
+                 size_t buffer_size = kDefaultBufferSize);
+  BufferedSocket(const BufferedSocket &) = delete;
+  ~BufferedSocket() override = default;
+  void RetrieveBuffer(size_t length, char *data) const override;
+
+  void SetCaptureEnabled(bool enabled) { capture_enabled_ = enabled; }
+  // Returns the bytes retrieved since the last call and starts a new frame.
+  std::vector<char> TakeCapturedFrame() const;
+
+ protected:
+  // Receives at least one byte into dest and returns the number of bytes
+  // received. Throws SocketError like Socket::RetrieveBuffer.
+  // dest is either the read-ahead buffer or the caller's destination.
+  virtual size_t Receive(char *dest, size_t capacity) const;
+
+  // the receive path is logically const for callers of ISocket
+  mutable std::vector<char> buffer_;
+  mutable size_t read_pos_ = 0;
+  mutable size_t write_pos_ = 0;
+  bool capture_enabled_ = false;
+  mutable std::vector<char> captured_frame_;
+};
+}  // namespace torchserve
+#endif  // TS_CPP_BACKENDS_PROTOCOL_BUFFERED_SOCKET_HH_
@@ -0,0 +1,102 @@
+#include "capture.hh"
+
+#include <arpa/inet.h>
+
+#include <cstring>
+#include <set>
+#include <stdexcept>
+
+namespace torchserve {
+namespace {
+void AppendUint32(std::vector<char>& dest, uint32_t value) {
+  uint32_t network_value = htonl(value);
+  const auto* bytes = reinterpret_cast<const char*>(&network_value);
+  dest.insert(dest.end(), bytes, bytes + sizeof(network_value));
+}
+
+uint32_t ReadUint32(const char* data) {
+  uint32_t network_value = 0;
+  std::memcpy(&network_value, data, sizeof(network_value));
+  return ntohl(network_value);
+}
+}  // namespace
+
+CaptureWriter::CaptureWriter(const std::string& path)
+    : output_(path, std::ios::out | std::ios::binary | std::ios::trunc),
+      start_(std::chrono::steady_clock::now()) {
+  if (!output_.good()) {
+    throw std::runtime_error("Failed to create capture file " + path);
+  }
+  output_.write(kMagic, sizeof(kMagic));
+  output_.flush();
+}
+
+void CaptureWriter::Write(uint32_t connection_id,
+                          std::chrono::steady_clock::time_point received,
+                          const std::vector<char>& frame) {
+  auto timestamp_ns = static_cast<uint64_t>(
+      std::chrono::duration_cast<std::chrono::nanoseconds>(received - start_)
+          .count());
+  std::vector<char> record_header;
+  record_header.reserve(4 * sizeof(uint32_t));
+  AppendUint32(record_header, static_cast<uint32_t>(timestamp_ns >> 32));
+  AppendUint32(record_header, static_cast<uint32_t>(timestamp_ns));
+  AppendUint32(record_header, connection_id);
+  AppendUint32(record_header, static_cast<uint32_t>(frame.size()));
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  output_.write(record_header.data(), record_header.size());
+  output_.write(frame.data(), frame.size());
+  output_.flush();
+}
+
+CaptureReader::CaptureReader(const std::string& path,
+                             std::optional<uint32_t> connection_id)
+    : input_(path, std::ios::in | std::ios::binary),
+      connection_id_(connection_id) {
+  char magic[sizeof(CaptureWriter::kMagic)] = {};
+  if (!input_.read(magic, sizeof(magic)) ||
+      std::memcmp(magic, CaptureWriter::kMagic, sizeof(magic)) != 0) {
+    throw std::runtime_error("Not a capture file " + path);
+  }
+}
+
+std::optional<CaptureRecord> CaptureReader::Next() {
+  char record_header[4 * sizeof(uint32_t)];
+  while (input_.read(record_header, sizeof(record_header))) {
+    uint32_t connection_id = ReadUint32(record_header + 8);
+    uint32_t frame_length = ReadUint32(record_header + 12);
+    if (connection_id_ && *connection_id_ != connection_id) {
+      input_.seekg(frame_length, std::ios::cur);
+      continue;
+    }
+    CaptureRecord record;
+    record.timestamp_ns =
+        (static_cast<uint64_t>(ReadUint32(record_header)) << 32) |
+        ReadUint32(record_header + 4);
+    record.connection_id = connection_id;
+    record.frame.resize(frame_length);
+    if (!input_.read(record.frame.data(), record.frame.size())) {
+      return std::nullopt;
+    }
+    return record;
+  }
+  return std::nullopt;
+}
+
+std::vector<uint32_t> CaptureReader::ReadConnectionIds(
+    const std::string& path) {
+  CaptureReader reader(path);
+  std::vector<uint32_t> connection_ids;
+  std::set<uint32_t> seen;
+  char record_header[4 * sizeof(uint32_t)];
+  while (reader.input_.read(record_header, sizeof(record_header))) {
+    uint32_t connection_id = ReadUint32(record_header + 8);
+    if (seen.insert(connection_id).second) {
+      connection_ids.push_back(connection_id);
+    }
+    reader.input_.seekg(ReadUint32(record_header + 12), std::ios::cur);
+  }
+  return connection_ids;
+}
+}  // namespace torchserve
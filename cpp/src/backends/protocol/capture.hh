@@ -0,0 +1,77 @@
+#ifndef TS_CPP_BACKENDS_PROTOCOL_CAPTURE_HH_
+#define TS_CPP_BACKENDS_PROTOCOL_CAPTURE_HH_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <vector>
+
+namespace torchserve {
+/**
+ * @brief
+ * Capture of the OTF frames received by a worker, for offline replay.
+ *
+ * File layout, integers big-endian like OTF:
+ *   magic "TSCAPTR1"
+ *   records: | uint64 timestamp_ns | uint32 connection id |
+ *            | uint32 frame length | frame bytes |
+ * timestamp_ns is the time the frame's cmd byte was received, relative to
+ * the start of the capture. A frame is the command exactly as it was
+ * received, cmd byte included.
+ */
+struct CaptureRecord {
+  uint64_t timestamp_ns = 0;
+  uint32_t connection_id = 0;
+  std::vector<char> frame;
+};
+
+// Appends records to a capture file. Thread safe.
+class CaptureWriter {
+ public:
+  static constexpr char kMagic[8] = {'T', 'S', 'C', 'A', 'P', 'T', 'R', '1'};
+
+  // Throws std::runtime_error if the file cannot be created.
+  explicit CaptureWriter(const std::string& path);
+
+  // Each connection recorded to the capture needs its own id.
+  uint32_t NextConnectionId() { return next_connection_id_++; }
+
+  // Records are flushed as they are written, so a capture stays readable up
+  // to its last record if the worker is killed.
+  void Write(uint32_t connection_id,
+             std::chrono::steady_clock::time_point received,
+             const std::vector<char>& frame);
+
+ private:
+  std::mutex mutex_;
+  std::ofstream output_;
+  std::chrono::steady_clock::time_point start_;
+  std::atomic<uint32_t> next_connection_id_{0};
+};
+
+class CaptureReader {
+ public:
+  // Throws std::runtime_error if the file is not a capture. With
+  // connection_id set, only the records of that connection are returned and
+  // the frames of the others are skipped without being read.
+  explicit CaptureReader(const std::string& path,
+                         std::optional<uint32_t> connection_id = std::nullopt);
+
+  // Returns std::nullopt at the end of the capture, a truncated last record
+  // is dropped.
+  std::optional<CaptureRecord> Next();
+
+  // Ids of the connections in the capture at path, in the order they first
+  // appear. Throws std::runtime_error if the file is not a capture.
+  static std::vector<uint32_t> ReadConnectionIds(const std::string& path);
+
+ private:
+  std::ifstream input_;
+  std::optional<uint32_t> connection_id_;
+};
+}  // namespace torchserve
+#endif  // TS_CPP_BACKENDS_PROTOCOL_CAPTURE_HH_
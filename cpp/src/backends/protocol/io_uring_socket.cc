@@ -0,0 +1,304 @@
+#include "io_uring_socket.hh"
+
+#include <limits.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+
+namespace torchserve {
+namespace {
+int IoUringSetup(unsigned entries, io_uring_params* params) {
+  return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+}
+
+int IoUringEnter(int ring_fd, unsigned to_submit, unsigned min_complete,
+                 unsigned flags) {
+  return static_cast<int>(syscall(__NR_io_uring_enter, ring_fd, to_submit,
+                                  min_complete, flags, nullptr, 0));
+}
+
+int IoUringRegister(int ring_fd, unsigned opcode, const void* arg,
+                    unsigned nr_args) {
+  return static_cast<int>(
+      syscall(__NR_io_uring_register, ring_fd, opcode, arg, nr_args));
+}
+
+template <typename T>
+T* RingField(void* ring, unsigned offset) {
+  return reinterpret_cast<T*>(static_cast<char*>(ring) + offset);
+}
+
+// the opcodes of IoUringSocket::Receive and IoUringSocket::SendAllV
+bool SupportsSocketOpcodes(const IoUring& ring) {
+  return ring.SupportsOpcodes(
+      {IORING_OP_READ_FIXED, IORING_OP_RECV, IORING_OP_SENDMSG});
+}
+}  // namespace
+
+IoUring::IoUring(unsigned entries) {
+  io_uring_params params{};
+  ring_fd_ = IoUringSetup(entries, &params);
+  if (ring_fd_ < 0) {
+    TS_LOGF(ERROR, "io_uring_setup failed. errno: {}", errno);
+    throw SocketError("io_uring is not available");
+  }
+  sq_entries_ = params.sq_entries;
+
+  sq_ring_size_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+  cq_ring_size_ =
+      params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+  if (params.features & IORING_FEAT_SINGLE_MMAP) {
+    sq_ring_size_ = cq_ring_size_ = std::max(sq_ring_size_, cq_ring_size_);
+  }
+  sq_ring_ = mmap(nullptr, sq_ring_size_, PROT_READ | PROT_WRITE,
+                  MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQ_RING);
+  if (sq_ring_ == MAP_FAILED) {
+    sq_ring_ = nullptr;
+    close(ring_fd_);
+    throw SocketError("Failed to map io_uring submission queue");
+  }
+  if (params.features & IORING_FEAT_SINGLE_MMAP) {
+    cq_ring_ = sq_ring_;
+  } else {
+    cq_ring_ = mmap(nullptr, cq_ring_size_, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_CQ_RING);
+    if (cq_ring_ == MAP_FAILED) {
+      cq_ring_ = nullptr;
+      munmap(sq_ring_, sq_ring_size_);
+      close(ring_fd_);
+      throw SocketError("Failed to map io_uring completion queue");
+    }
+  }
+  sqes_size_ = params.sq_entries * sizeof(io_uring_sqe);
+  void* sqes = mmap(nullptr, sqes_size_, PROT_READ | PROT_WRITE,
+                    MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQES);
+  if (sqes == MAP_FAILED) {
+    if (cq_ring_ != sq_ring_) {
+      munmap(cq_ring_, cq_ring_size_);
+    }
+    munmap(sq_ring_, sq_ring_size_);
+    close(ring_fd_);
+    throw SocketError("Failed to map io_uring submission entries");
+  }
+  sqes_ = static_cast<io_uring_sqe*>(sqes);
+
+  sq_head_ = RingField<unsigned>(sq_ring_, params.sq_off.head);
+  sq_tail_ = RingField<unsigned>(sq_ring_, params.sq_off.tail);
+  sq_mask_ = RingField<unsigned>(sq_ring_, params.sq_off.ring_mask);
+  sq_array_ = RingField<unsigned>(sq_ring_, params.sq_off.array);
+  cq_head_ = RingField<unsigned>(cq_ring_, params.cq_off.head);
+  cq_tail_ = RingField<unsigned>(cq_ring_, params.cq_off.tail);
+  cq_mask_ = RingField<unsigned>(cq_ring_, params.cq_off.ring_mask);
+  cqes_ = RingField<io_uring_cqe>(cq_ring_, params.cq_off.cqes);
+}
+
+IoUring::~IoUring() {
+  munmap(sqes_, sqes_size_);
+  if (cq_ring_ != sq_ring_) {
+    munmap(cq_ring_, cq_ring_size_);
+  }
+  munmap(sq_ring_, sq_ring_size_);
+  close(ring_fd_);
+}
+
+void IoUring::RegisterBuffers(const std::vector<iovec>& buffers) {
+  if (IoUringRegister(ring_fd_, IORING_REGISTER_BUFFERS, buffers.data(),
+                      buffers.size()) < 0) {
+    TS_LOGF(ERROR, "Failed to register io_uring buffers. errno: {}", errno);
+    throw SocketError("Failed to register io_uring buffers");
+  }
+}
+
+bool IoUring::SupportsOpcodes(std::initializer_list<unsigned> opcodes) const {
+  // io_uring_probe ends in a flexible array of one entry per opcode
+  constexpr unsigned kProbeOps = 256;
+  size_t probe_size =
+      sizeof(io_uring_probe) + kProbeOps * sizeof(io_uring_probe_op);
+  std::unique_ptr<io_uring_probe, decltype(&std::free)> probe(
+      static_cast<io_uring_probe*>(std::calloc(1, probe_size)), &std::free);
+  if (!probe || IoUringRegister(ring_fd_, IORING_REGISTER_PROBE,
+                                probe.get(), kProbeOps) < 0) {
+    TS_LOGF(WARN, "io_uring opcodes can not be probed. errno: {}", errno);
+    return false;
+  }
+  for (auto opcode : opcodes) {
+    if (opcode > probe->last_op ||
+        !(probe->ops[opcode].flags & IO_URING_OP_SUPPORTED)) {
+      TS_LOGF(WARN, "io_uring opcode {} is not supported", opcode);
+      return false;
+    }
+  }
+  return true;
+}
+
+int IoUring::SubmitAndWait(const io_uring_sqe& sqe) {
+  io_uring_sqe submission = sqe;
+  int result;
+  SubmitAndWait(&submission, 1, &result);
+  return result;
+}
+
+void IoUring::SubmitAndWait(io_uring_sqe* sqes, unsigned count,
+                            int* results) {
+  if (count > sq_entries_) {
+    throw SocketError("More io_uring submissions than ring entries");
+  }
+  // single producer: only this thread moves the tail
+  unsigned tail = *sq_tail_;
+  for (unsigned i = 0; i < count; ++i) {
+    unsigned index = (tail + i) & *sq_mask_;
+    sqes[i].user_data = i;
+    sqes_[index] = sqes[i];
+    sq_array_[index] = index;
+  }
+  tail += count;
+  __atomic_store_n(sq_tail_, tail, __ATOMIC_RELEASE);
+
+  unsigned completed = 0;
+  unsigned cq_head = *cq_head_;
+  while (completed < count) {
+    if (cq_head == __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE)) {
+      // the submissions the kernel has not consumed yet, if any
+      unsigned to_submit = tail - __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+      if (IoUringEnter(ring_fd_, to_submit, count - completed,
+                       IORING_ENTER_GETEVENTS) < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+        TS_LOGF(ERROR, "io_uring_enter failed. errno: {}", errno);
+        throw SocketError("io_uring_enter failed");
+      }
+      continue;
+    }
+    const auto& cqe = cqes_[cq_head & *cq_mask_];
+    results[cqe.user_data] = cqe.res;
+    ++cq_head;
+    ++completed;
+    __atomic_store_n(cq_head_, cq_head, __ATOMIC_RELEASE);
+  }
+}
+
+bool IoUringSocket::IsSupported() {
+  try {
+    IoUring probe_ring(1);
+    return SupportsSocketOpcodes(probe_ring);
+  } catch (const SocketError& e) {
+    TS_LOG(WARN, e.what());
+    return false;
+  }
+}
+
+IoUringSocket::IoUringSocket(int client_socket, size_t buffer_size)
+    : BufferedSocket(client_socket, buffer_size) {
+  try {
+    recv_ring_ = std::make_unique<IoUring>(kQueueDepth);
+    send_ring_ = std::make_unique<IoUring>(kQueueDepth);
+    // the probe is per kernel, one ring is enough
+    if (!SupportsSocketOpcodes(*recv_ring_)) {
+      throw SocketError("io_uring does not support the socket opcodes");
+    }
+    recv_ring_->RegisterBuffers({{buffer_.data(), buffer_.size()}});
+  } catch (const SocketError&) {
+    // the caller falls back to another socket on client_socket
+    client_socket_ = -1;
+    throw;
+  }
+}
+
+size_t IoUringSocket::Receive(char* dest, size_t capacity) const {
+  while (true) {
+    io_uring_sqe sqe{};
+    sqe.fd = client_socket_;
+    sqe.addr = reinterpret_cast<uint64_t>(dest);
+    sqe.len = static_cast<unsigned>(std::min<size_t>(capacity, INT_MAX));
+    if (dest == buffer_.data()) {
+      // refill of the registered read-ahead buffer
+      sqe.opcode = IORING_OP_READ_FIXED;
+      sqe.buf_index = 0;
+    } else {
+      // the rest of a large field, so all of it is on its way
+      sqe.opcode = IORING_OP_RECV;
+      sqe.msg_flags = MSG_WAITALL;
+    }
+
+    int pkt_size = recv_ring_->SubmitAndWait(sqe);
+    if (pkt_size == 0) {
+      throw SocketError("Frontend disconnected.");
+    }
+    if (pkt_size < 0) {
+      if (pkt_size == -EINTR || pkt_size == -EAGAIN) {
+        continue;
+      }
+      TS_LOGF(ERROR, "Error recieving data from socket. errno: {}", -pkt_size);
+      throw SocketError("Error recieving data from socket.");
+    }
+    return static_cast<size_t>(pkt_size);
+  }
+}
+
+bool IoUringSocket::SendAll(size_t length, char* data) const {
+  std::vector<iovec> buffers = {{data, length}};
+  return SendAllV(buffers);
+}
+
+bool IoUringSocket::SendAllV(std::vector<iovec>& buffers) const {
+  std::array<msghdr, kQueueDepth> msgs{};
+  std::array<io_uring_sqe, kQueueDepth> sqes{};
+  std::array<size_t, kQueueDepth> lengths{};
+  std::array<int, kQueueDepth> results{};
+  auto iov_it = buffers.begin();
+  while (iov_it != buffers.end()) {
+    unsigned count = 0;
+    for (auto chunk_it = iov_it;
+         chunk_it != buffers.end() && count < kQueueDepth; ++count) {
+      auto& msg = msgs[count];
+      msg = msghdr{};
+      msg.msg_iov = &*chunk_it;
+      msg.msg_iovlen = std::min<size_t>(buffers.end() - chunk_it, IOV_MAX);
+      lengths[count] = 0;
+      for (size_t i = 0; i < msg.msg_iovlen; ++i, ++chunk_it) {
+        lengths[count] += chunk_it->iov_len;
+      }
+
+      auto& sqe = sqes[count];
+      sqe = io_uring_sqe{};
+      sqe.opcode = IORING_OP_SENDMSG;
+      sqe.fd = client_socket_;
+      sqe.addr = reinterpret_cast<uint64_t>(&msg);
+      sqe.len = 1;
+      // a short send fails the link, so the following messages are
+      // cancelled rather than sent out of order
+      sqe.msg_flags = MSG_WAITALL;
+      sqe.flags = IOSQE_IO_LINK;
+    }
+    sqes[count - 1].flags = 0;
+
+    send_ring_->SubmitAndWait(sqes.data(), count, results.data());
+    // the messages completed in order up to the first short or failed one,
+    // the rest are resent
+    for (unsigned i = 0; i < count; ++i) {
+      if (results[i] < 0) {
+        if (results[i] == -EINTR || results[i] == -EAGAIN ||
+            results[i] == -ECANCELED) {
+          break;
+        }
+        TS_LOGF(INFO, "Error sending data to socket. errno: {}", -results[i]);
+        return false;
+      }
+      AdvanceIovecs(iov_it, buffers.end(), static_cast<size_t>(results[i]));
+      if (static_cast<size_t>(results[i]) < lengths[i]) {
+        break;
+      }
+    }
+  }
+  return true;
+}
+}  // namespace torchserve
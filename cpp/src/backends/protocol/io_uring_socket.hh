@@ -0,0 +1,107 @@
+#ifndef TS_CPP_BACKENDS_PROTOCOL_IO_URING_SOCKET_HH_
+#define TS_CPP_BACKENDS_PROTOCOL_IO_URING_SOCKET_HH_
+
+#include <linux/io_uring.h>
+
+#include <cstddef>
+#include <initializer_list>
+#include <memory>
+#include <vector>
+
+#include "buffered_socket.hh"
+
+namespace torchserve {
+/**
+ * @brief
+ * Minimal io_uring instance driven through the raw syscalls: a batch of
+ * submissions is submitted and waited for with one io_uring_enter. Not
+ * thread safe; each thread that does I/O needs its own IoUring.
+ */
+class IoUring {
+ public:
+  // Throws SocketError if io_uring is not available.
+  explicit IoUring(unsigned entries);
+  IoUring(const IoUring &) = delete;
+  ~IoUring();
+
+  // Registers buffers for IORING_OP_READ_FIXED / IORING_OP_WRITE_FIXED,
+  // buf_index in the sqe refers to the position in buffers.
+  void RegisterBuffers(const std::vector<iovec> &buffers);
+
+  // Whether the kernel supports all of opcodes. False on kernels without
+  // IORING_REGISTER_PROBE (< 5.6), which lack IORING_OP_RECV anyway.
+  bool SupportsOpcodes(std::initializer_list<unsigned> opcodes) const;
+
+  // Submits sqe and waits for its completion. Returns the cqe result, i.e.
+  // the syscall result or -errno.
+  int SubmitAndWait(const io_uring_sqe &sqe);
+
+  // Submits the count sqes at once and waits for all of their completions,
+  // results[i] is the cqe result of sqes[i]. count is at most the number of
+  // entries of the ring. Overwrites the user_data of the sqes.
+  void SubmitAndWait(io_uring_sqe *sqes, unsigned count, int *results);
+
+ private:
+  int ring_fd_ = -1;
+  unsigned sq_entries_ = 0;
+  void *sq_ring_ = nullptr;
+  size_t sq_ring_size_ = 0;
+  void *cq_ring_ = nullptr;
+  size_t cq_ring_size_ = 0;
+  io_uring_sqe *sqes_ = nullptr;
+  size_t sqes_size_ = 0;
+
+  unsigned *sq_head_ = nullptr;
+  unsigned *sq_tail_ = nullptr;
+  unsigned *sq_mask_ = nullptr;
+  unsigned *sq_array_ = nullptr;
+  unsigned *cq_head_ = nullptr;
+  unsigned *cq_tail_ = nullptr;
+  unsigned *cq_mask_ = nullptr;
+  io_uring_cqe *cqes_ = nullptr;
+};
+
+/**
+ * @brief
+ * BufferedSocket that does its socket I/O through io_uring.
+ * - the read-ahead buffer is registered with the ring and refilled with
+ * IORING_OP_READ_FIXED.
+ * - reads larger than it, e.g. tensor payloads, are received into their
+ * destination in the arena by one IORING_OP_RECV with MSG_WAITALL, i.e. one
+ * io_uring_enter per payload rather than one per segment that arrives.
+ * - SendAllV splits the gather list into IORING_OP_SENDMSGs of up to IOV_MAX
+ * buffers each and submits up to kQueueDepth of them, linked so that they
+ * go out in order, with one io_uring_enter.
+ *
+ * Payloads are not registered: a fixed buffer can only be read into with
+ * IORING_OP_READ_FIXED, which returns as soon as any bytes arrive, so it
+ * would cost one io_uring_enter per segment again.
+ *
+ * Receiving and sending use separate rings so that the reader and writer
+ * threads of a pipelined worker can use the socket concurrently.
+ */
+class IoUringSocket : public BufferedSocket {
+ public:
+  static constexpr unsigned kQueueDepth = 4;
+
+  // Whether io_uring and the opcodes used by IoUringSocket are available.
+  static bool IsSupported();
+
+  // Throws SocketError if io_uring or one of its opcodes is not available,
+  // client_socket is left open then.
+  IoUringSocket(int client_socket,
+                size_t buffer_size = kDefaultBufferSize);
+  IoUringSocket(const IoUringSocket &) = delete;
+  ~IoUringSocket() override = default;
+  bool SendAll(size_t length, char *data) const override;
+  bool SendAllV(std::vector<iovec> &buffers) const override;
+
+ protected:
+  size_t Receive(char *dest, size_t capacity) const override;
+
+ private:
+  std::unique_ptr<IoUring> recv_ring_;
+  std::unique_ptr<IoUring> send_ring_;
+};
+}  // namespace torchserve
+#endif  // TS_CPP_BACKENDS_PROTOCOL_IO_URING_SOCKET_HH_
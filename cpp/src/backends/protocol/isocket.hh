@@ -1,13 +1,19 @@
 #ifndef TS_CPP_BACKENDS_PROTOCOL_ISOCKET_HH_
 #define TS_CPP_BACKENDS_PROTOCOL_ISOCKET_HH_
 
+#include <sys/uio.h>
+
 #include <cstddef>
+#include <vector>
 
 namespace torchserve {
 class ISocket {
  public:
   virtual ~ISocket() {}
   virtual bool SendAll(size_t length, char *data) const = 0;
+  // Gather-writes all buffers in order. The iovecs are consumed: their
+  // base/length are advanced past any data already sent.
+  virtual bool SendAllV(std::vector<iovec> &buffers) const = 0;
   virtual void RetrieveBuffer(size_t length, char *data) const = 0;
   virtual int RetrieveInt() const = 0;
   virtual bool RetrieveBool() const = 0;
@@ -0,0 +1,45 @@
+#include "memory_socket.hh"
+
+#include <arpa/inet.h>
+
+#include <cstring>
+
+#include "socket.hh"
+
+namespace torchserve {
+bool MemorySocket::SendAll(size_t length, char* data) const {
+  output_.insert(output_.end(), data, data + length);
+  return true;
+}
+
+bool MemorySocket::SendAllV(std::vector<iovec>& buffers) const {
+  for (auto& buffer : buffers) {
+    auto* base = static_cast<char*>(buffer.iov_base);
+    output_.insert(output_.end(), base, base + buffer.iov_len);
+    buffer.iov_base = base + buffer.iov_len;
+    buffer.iov_len = 0;
+  }
+  return true;
+}
+
+void MemorySocket::RetrieveBuffer(size_t length, char* data) const {
+  if (length > input_.size() - read_pos_) {
+    read_pos_ = input_.size();
+    throw SocketError("End of input.");
+  }
+  std::memcpy(data, input_.data() + read_pos_, length);
+  read_pos_ += length;
+}
+
+int MemorySocket::RetrieveInt() const {
+  int value = 0;
+  RetrieveBuffer(INT_STD_SIZE, reinterpret_cast<char*>(&value));
+  return ntohl(value);
+}
+
+bool MemorySocket::RetrieveBool() const {
+  bool value = false;
+  RetrieveBuffer(BOOL_STD_SIZE, reinterpret_cast<char*>(&value));
+  return value;
+}
+}  // namespace torchserve
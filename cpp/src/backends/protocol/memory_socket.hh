@@ -0,0 +1,40 @@
+#ifndef TS_CPP_BACKENDS_PROTOCOL_MEMORY_SOCKET_HH_
+#define TS_CPP_BACKENDS_PROTOCOL_MEMORY_SOCKET_HH_
+
+#include <cstddef>
+#include <utility>
+#include <vector>
+
+#include "isocket.hh"
+
+namespace torchserve {
+/**
+ * @brief
+ * ISocket over in-memory bytes: reads replay input, sends append to an
+ * output buffer. Used to drive OTFMessage without a peer process, e.g. in
+ * benchmarks. Like Socket, reading past the end of the input throws
+ * SocketError. Not thread safe.
+ */
+class MemorySocket : public ISocket {
+ public:
+  explicit MemorySocket(std::vector<char> input = {})
+      : input_(std::move(input)){};
+  bool SendAll(size_t length, char *data) const override;
+  bool SendAllV(std::vector<iovec> &buffers) const override;
+  void RetrieveBuffer(size_t length, char *data) const override;
+  int RetrieveInt() const override;
+  bool RetrieveBool() const override;
+
+  // Reads start again from the beginning of the input.
+  void Rewind() { read_pos_ = 0; }
+  bool AtEnd() const { return read_pos_ == input_.size(); }
+  const std::vector<char> &GetOutput() const { return output_; }
+  void ClearOutput() { output_.clear(); }
+
+ private:
+  std::vector<char> input_;
+  mutable size_t read_pos_ = 0;
+  mutable std::vector<char> output_;
+};
+}  // namespace torchserve
+#endif  // TS_CPP_BACKENDS_PROTOCOL_MEMORY_SOCKET_HH_
@@ -78,6 +78,136 @@ OTFMessage::RetrieveInferenceMsg(const ISocket& client_socket_) {
   return inference_requests;
 }
 
+std::shared_ptr<torchserve::InferenceRequestViewBatch>
+OTFMessage::RetrieveInferenceMsgView(const ISocket& client_socket_) {
+  /**
+   * @brief
+   * Same frame format as RetrieveInferenceMsg, but every field is received
+   * straight into the arena of the batch instead of being allocated on its
+   * own. Arena blocks never move, so the views are taken as the fields come
+   * in. Parameter values are aligned for RawTensor payloads.
+   */
+  auto view_batch = std::make_shared<InferenceRequestViewBatch>();
+  auto& arena = view_batch->arena;
+
+  while (true) {
+    int length = client_socket_.RetrieveInt();
+    if (length == -1) {
+      break;
+    }
+    auto& request = view_batch->requests.emplace_back();
+    request.index = view_batch->requests.size() - 1;
+    request.request_id = RetrieveBufferToArena(client_socket_, arena, length);
+
+    while ((length = client_socket_.RetrieveInt()) != -1) {
+      auto header_name = RetrieveBufferToArena(client_socket_, arena, length);
+      auto header_value = RetrieveBufferToArena(client_socket_, arena,
+                                                client_socket_.RetrieveInt());
+      request.headers.emplace_back(header_name, header_value);
+    }
+    // see RetrieveInferenceRequest
+    request.headers.emplace_back(
+        torchserve::PayloadType::kHEADER_NAME_BODY_TYPE,
+        torchserve::PayloadType::kDATA_TYPE_BYTES);
+
+    while ((length = client_socket_.RetrieveInt()) != -1) {
+      auto parameter_name =
+          RetrieveBufferToArena(client_socket_, arena, length);
+      auto content_type = RetrieveBufferToArena(client_socket_, arena,
+                                                client_socket_.RetrieveInt());
+      auto value =
+          RetrieveBufferToArena(client_socket_, arena,
+                                client_socket_.RetrieveInt(),
+                                Arena::kBlockAlignment);
+
+      size_t content_type_name_size =
+          parameter_name.size() + CONTENT_TYPE_SUFFIX.size();
+      char* content_type_name = arena.Allocate(content_type_name_size);
+      std::memcpy(content_type_name, parameter_name.data(),
+                  parameter_name.size());
+      std::memcpy(content_type_name + parameter_name.size(),
+                  CONTENT_TYPE_SUFFIX.data(), CONTENT_TYPE_SUFFIX.size());
+
+      request.parameters.emplace_back(parameter_name, value);
+      request.headers.emplace_back(
+          std::string_view(content_type_name, content_type_name_size),
+          content_type);
+    }
+  }
+
+  return view_batch;
+}
+
+bool OTFMessage::ResolveSharedMemoryReferences(
+    torchserve::InferenceRequestViewBatch& view_batch,
+    SharedMemoryRegistry& registry) {
+  const auto& prefix =
+      torchserve::PayloadType::kCONTENT_TYPE_SHM_REFERENCE_PREFIX;
+  bool all_resolved = true;
+  for (auto& request : view_batch.requests) {
+    for (auto& [header_name, header_value] : request.headers) {
+      if (header_name.size() <= CONTENT_TYPE_SUFFIX.size() ||
+          header_name.substr(header_name.size() -
+                             CONTENT_TYPE_SUFFIX.size()) !=
+              CONTENT_TYPE_SUFFIX ||
+          header_value.substr(0, prefix.size()) != prefix) {
+        continue;
+      }
+      auto parameter_name = header_name.substr(
+          0, header_name.size() - CONTENT_TYPE_SUFFIX.size());
+      header_value.remove_prefix(prefix.size());
+
+      for (auto& [name, value] : request.parameters) {
+        if (name != parameter_name) {
+          continue;
+        }
+        auto reference = SharedMemoryReference::Parse(value);
+        std::shared_ptr<SharedMemoryRegion> region;
+        std::optional<std::string_view> payload;
+        if (reference) {
+          region = registry.Get(reference->name);
+        }
+        if (region) {
+          payload = region->View(*reference);
+        }
+        if (!payload) {
+          TS_LOGF(ERROR,
+                  "Invalid shared memory reference for request id: {}, "
+                  "parameter: {}",
+                  request.request_id, parameter_name);
+          value = std::string_view();
+          all_resolved = false;
+          continue;
+        }
+        value = *payload;
+        // released to the producer's ring along with the batch
+        view_batch.external_buffers.emplace_back(
+            SharedMemoryRing::Hold(region, *reference));
+      }
+    }
+  }
+  return all_resolved;
+}
+
+void OTFMessage::WriteResponsesToSharedMemory(
+    std::shared_ptr<InferenceResponseBatch>& inference_response_batch,
+    SharedMemoryRing& ring, size_t min_size) {
+  for (auto& inference_response : *inference_response_batch) {
+    if (inference_response.msg.size() < min_size) {
+      continue;
+    }
+    auto reference = ring.Write(std::string_view(
+        inference_response.msg.data(), inference_response.msg.size()));
+    if (!reference) {
+      continue;
+    }
+    inference_response
+        .headers[torchserve::PayloadType::kHEADER_NAME_SHM_REFERENCE] =
+        reference->ToString();
+    inference_response.msg.clear();
+  }
+}
+
 std::shared_ptr<InferenceRequest> OTFMessage::RetrieveInferenceRequest(
     const ISocket& client_socket_) {
   // fetch request id
@@ -164,72 +294,235 @@ bool OTFMessage::SendInferenceResponse(
     const ISocket& client_socket_,
     std::shared_ptr<InferenceResponseBatch>& inference_response_batch) {
   std::vector<char> data_buffer = {};
-  OTFMessage::EncodeInferenceResponse(inference_response_batch, data_buffer);
-  return client_socket_.SendAll(data_buffer.size(), data_buffer.data());
+  std::vector<iovec> iovecs = {};
+  OTFMessage::EncodeInferenceResponse(inference_response_batch, data_buffer,
+                                      iovecs);
+  return client_socket_.SendAllV(iovecs);
 }
 
 void OTFMessage::EncodeInferenceResponse(
     std::shared_ptr<InferenceResponseBatch>& inference_response_batch,
     std::vector<char>& data_buffer) {
+  std::vector<char> framing_buffer = {};
+  std::vector<iovec> iovecs = {};
+  EncodeInferenceResponse(inference_response_batch, framing_buffer, iovecs);
+
+  size_t total_size = data_buffer.size();
+  for (const auto& iov : iovecs) {
+    total_size += iov.iov_len;
+  }
+  data_buffer.reserve(total_size);
+  for (const auto& iov : iovecs) {
+    auto* base = static_cast<const char*>(iov.iov_base);
+    data_buffer.insert(data_buffer.end(), base, base + iov.iov_len);
+  }
+}
+
+void OTFMessage::EncodeInferenceResponse(
+    std::shared_ptr<InferenceResponseBatch>& inference_response_batch,
+    std::vector<char>& framing_buffer, std::vector<iovec>& iovecs) {
   // frontend decoder -
   // https://github.com/pytorch/serve/blob/a4a553a1d77668310e74141f4efabdc7713d77f4/frontend/server/src/main/java/org/pytorch/serve/util/codec/ModelResponseDecoder.java#L20
 
   auto batch_response_status =
       std::make_pair(200, std::string("Prediction success"));
-  for (auto const& [request_id, inference_response] :
-       *inference_response_batch) {
-    if (inference_response->code != 200) {
+  for (const auto& inference_response : *inference_response_batch) {
+    if (inference_response.code != 200) {
       batch_response_status = std::make_pair(
-          inference_response->code,
-          torchserve::Converter::VectorToStr(inference_response->msg));
+          inference_response.code,
+          torchserve::Converter::VectorToStr(inference_response.msg));
       break;
     }
   }
 
+  // size the framing up front so that appending never reallocates
+  size_t framing_size =
+      3 * sizeof(int32_t) + batch_response_status.second.size();
+  for (const auto& inference_response : *inference_response_batch) {
+    framing_size +=
+        6 * sizeof(int32_t) + inference_response.request_id.size();
+    for (auto const& [header_name, header_value] :
+         inference_response.headers) {
+      framing_size +=
+          2 * sizeof(int32_t) + header_name.size() + header_value.size();
+    }
+  }
+  framing_buffer.reserve(framing_buffer.size() + framing_size);
+
+  // framing is written into framing_buffer, response messages are referenced
+  // in place. Offsets are kept until the end in case framing_buffer grows.
+  std::vector<std::pair<size_t, const std::vector<char>*>> message_offsets;
+  message_offsets.reserve(inference_response_batch->Size());
+  size_t framing_start = framing_buffer.size();
+
   // status code
   int32_t code = htonl(batch_response_status.first);
-  AppendIntegerToCharVector(data_buffer, code);
+  AppendIntegerToCharVector(framing_buffer, code);
 
   // message
-  AppendOTFStringToCharVector(data_buffer, batch_response_status.second);
+  AppendOTFStringToCharVector(framing_buffer, batch_response_status.second);
 
   // for each response in the batch
-  for (auto const& [request_id, inference_response] :
-       *inference_response_batch) {
+  for (const auto& inference_response : *inference_response_batch) {
     // request id
-    AppendOTFStringToCharVector(data_buffer, request_id);
+    AppendOTFStringToCharVector(framing_buffer, inference_response.request_id);
 
     // content type - leaving it empty to be backward compatible. It will be
     // passed in headers if added there.
     int32_t message_size = htonl(0);
-    AppendIntegerToCharVector(data_buffer, message_size);
+    AppendIntegerToCharVector(framing_buffer, message_size);
 
     // status code
-    int32_t status_code = htonl(inference_response->code);
-    AppendIntegerToCharVector(data_buffer, status_code);
+    int32_t status_code = htonl(inference_response.code);
+    AppendIntegerToCharVector(framing_buffer, status_code);
 
     // reason phrase - leaving it empty to be backward compatible. It will be
     // passed in headers if added there.
     int32_t reason_phrase_size = htonl(0);
-    AppendIntegerToCharVector(data_buffer, reason_phrase_size);
+    AppendIntegerToCharVector(framing_buffer, reason_phrase_size);
 
     // headers
-    int32_t headers_count = htonl(inference_response->headers.size());
-    AppendIntegerToCharVector(data_buffer, headers_count);
+    int32_t headers_count = htonl(inference_response.headers.size());
+    AppendIntegerToCharVector(framing_buffer, headers_count);
     for (auto const& [header_name, header_value] :
-         inference_response->headers) {
-      AppendOTFStringToCharVector(data_buffer, header_name);
-      AppendOTFStringToCharVector(data_buffer, header_value);
+         inference_response.headers) {
+      AppendOTFStringToCharVector(framing_buffer, header_name);
+      AppendOTFStringToCharVector(framing_buffer, header_value);
     }
 
     // response message
-    int32_t msg_size = htonl(inference_response->msg.size());
-    AppendIntegerToCharVector(data_buffer, msg_size);
-    data_buffer.insert(data_buffer.end(), inference_response->msg.begin(),
-                       inference_response->msg.end());
+    int32_t msg_size = htonl(inference_response.msg.size());
+    AppendIntegerToCharVector(framing_buffer, msg_size);
+    message_offsets.emplace_back(framing_buffer.size(),
+                                 &inference_response.msg);
   }
   int32_t end_of_response_code = htonl(-1);
-  AppendIntegerToCharVector(data_buffer, end_of_response_code);
+  AppendIntegerToCharVector(framing_buffer, end_of_response_code);
+
+  iovecs.reserve(iovecs.size() + 2 * message_offsets.size() + 1);
+  auto append_iovec = [&iovecs](const char* base, size_t length) {
+    if (length > 0) {
+      iovecs.push_back({const_cast<char*>(base), length});
+    }
+  };
+  for (const auto& [offset, msg] : message_offsets) {
+    append_iovec(framing_buffer.data() + framing_start, offset - framing_start);
+    append_iovec(msg->data(), msg->size());
+    framing_start = offset;
+  }
+  append_iovec(framing_buffer.data() + framing_start,
+               framing_buffer.size() - framing_start);
+}
+
+void OTFMessage::EncodeLoadModelRequest(const LoadModelRequest& request,
+                                        std::vector<char>& data_buffer) {
+  // frame format: see RetrieveLoadMsg
+  data_buffer.push_back(LOAD_MSG);
+  AppendOTFStringToCharVector(data_buffer, request.model_name);
+  AppendOTFStringToCharVector(data_buffer, request.model_dir);
+  AppendIntegerToCharVector(data_buffer, htonl(request.batch_size));
+  AppendOTFStringToCharVector(data_buffer, request.handler);
+  AppendIntegerToCharVector(data_buffer, htonl(request.gpu_id));
+  AppendOTFStringToCharVector(data_buffer, request.envelope);
+  data_buffer.push_back(static_cast<char>(request.limit_max_image_pixels));
+}
+
+void OTFMessage::EncodeInferenceRequest(
+    const InferenceRequestBatch& inference_request_batch,
+    std::vector<char>& data_buffer) {
+  // frame format: see RetrieveInferenceRequest
+  const int32_t end_of_list = htonl(-1);
+  auto is_content_type = [](const std::string& header_name) {
+    return header_name.size() >= CONTENT_TYPE_SUFFIX.size() &&
+           header_name.compare(header_name.size() - CONTENT_TYPE_SUFFIX.size(),
+                               CONTENT_TYPE_SUFFIX.size(),
+                               CONTENT_TYPE_SUFFIX) == 0;
+  };
+
+  data_buffer.push_back(PREDICT_MSG);
+  for (const auto& inference_request : inference_request_batch) {
+    AppendOTFStringToCharVector(data_buffer, inference_request.request_id);
+
+    for (const auto& [header_name, header_value] : inference_request.headers) {
+      if (!is_content_type(header_name)) {
+        AppendOTFStringToCharVector(data_buffer, header_name);
+        AppendOTFStringToCharVector(data_buffer, header_value);
+      }
+    }
+    AppendIntegerToCharVector(data_buffer, end_of_list);
+
+    for (const auto& [parameter_name, parameter_value] :
+         inference_request.parameters) {
+      AppendOTFStringToCharVector(data_buffer, parameter_name);
+      auto content_type_it =
+          inference_request.headers.find(parameter_name + CONTENT_TYPE_SUFFIX);
+      AppendOTFStringToCharVector(
+          data_buffer, content_type_it != inference_request.headers.end()
+                           ? content_type_it->second
+                           : std::string());
+      AppendIntegerToCharVector(data_buffer, htonl(parameter_value.size()));
+      data_buffer.insert(data_buffer.end(), parameter_value.begin(),
+                         parameter_value.end());
+    }
+    AppendIntegerToCharVector(data_buffer, end_of_list);
+  }
+  AppendIntegerToCharVector(data_buffer, end_of_list);
+}
+
+std::unique_ptr<LoadModelResponse> OTFMessage::RetrieveLoadModelResponse(
+    const ISocket& client_socket_) {
+  // frame format: see EncodeLoadModelResponse
+  auto code = client_socket_.RetrieveInt();
+  auto message = RetrieveStringBuffer(client_socket_, std::nullopt);
+  client_socket_.RetrieveInt();
+  return std::make_unique<LoadModelResponse>(code, *message);
+}
+
+std::shared_ptr<InferenceResponseBatch> OTFMessage::RetrieveInferenceResponse(
+    const ISocket& client_socket_) {
+  // frame format: see EncodeInferenceResponse
+  auto inference_response_batch = std::make_shared<InferenceResponseBatch>();
+  // batch status code and message
+  client_socket_.RetrieveInt();
+  RetrieveStringBuffer(client_socket_, std::nullopt);
+
+  while (true) {
+    int length = client_socket_.RetrieveInt();
+    if (length == -1) {
+      break;
+    }
+    auto request_id =
+        RetrieveStringBuffer(client_socket_, std::make_optional(length));
+    auto& inference_response = inference_response_batch->Add(*request_id);
+    // content type
+    RetrieveStringBuffer(client_socket_, std::nullopt);
+    inference_response.code = client_socket_.RetrieveInt();
+    // reason phrase
+    RetrieveStringBuffer(client_socket_, std::nullopt);
+    int headers_count = client_socket_.RetrieveInt();
+    for (int i = 0; i < headers_count; ++i) {
+      auto header_name = RetrieveStringBuffer(client_socket_, std::nullopt);
+      auto header_value = RetrieveStringBuffer(client_socket_, std::nullopt);
+      inference_response.headers[*header_name] = *header_value;
+    }
+    length = client_socket_.RetrieveInt();
+    inference_response.msg.resize(length);
+    client_socket_.RetrieveBuffer(length, inference_response.msg.data());
+  }
+  return inference_response_batch;
+}
+
+std::string_view OTFMessage::RetrieveBufferToArena(
+    const ISocket& client_socket_, Arena& arena, int length,
+    size_t alignment) {
+  if (length < 0) {
+    // the rest of the stream can not be framed anymore
+    throw SocketError("Invalid field length in inference request: " +
+                      std::to_string(length));
+  }
+  char* data = arena.Allocate(length, alignment);
+  client_socket_.RetrieveBuffer(length, data);
+  return std::string_view(data, length);
 }
 
 std::shared_ptr<std::string> OTFMessage::RetrieveStringBuffer(
@@ -242,9 +535,9 @@ std::shared_ptr<std::string> OTFMessage::RetrieveStringBuffer(
 
 void OTFMessage::AppendIntegerToCharVector(std::vector<char>& dest_vector,
                                            const int32_t& source_integer) {
-  dest_vector.resize(dest_vector.size() + sizeof(source_integer));
-  memcpy(&dest_vector.back() + 1 - sizeof(source_integer), &source_integer,
-         sizeof(source_integer));
+  const auto* source_bytes = reinterpret_cast<const char*>(&source_integer);
+  dest_vector.insert(dest_vector.end(), source_bytes,
+                     source_bytes + sizeof(source_integer));
 }
 
 void OTFMessage::AppendOTFStringToCharVector(std::vector<char>& dest_vector,
@@ -5,8 +5,10 @@
 #include <ctime>
 #include <optional>
 #include <string>
+#include <string_view>
 #include <variant>
 
+#include "src/backends/protocol/shared_memory.hh"
 #include "src/backends/protocol/socket.hh"
 #include "src/utils/logging.hh"
 #include "src/utils/message.hh"
@@ -35,12 +37,58 @@ class OTFMessage {
       const ISocket& client_socket_);
   static std::shared_ptr<torchserve::InferenceRequestBatch>
   RetrieveInferenceMsg(const ISocket& client_socket_);
+  // Decodes a batch into the arena of an InferenceRequestViewBatch, which
+  // handlers read in place. The worker decodes with this, RetrieveInferenceMsg
+  // is kept for tools. Throws SocketError on a negative field length.
+  static std::shared_ptr<torchserve::InferenceRequestViewBatch>
+  RetrieveInferenceMsgView(const ISocket& client_socket_);
+  // Points parameters sent as shared memory references at the shared memory
+  // itself, see PayloadType::kCONTENT_TYPE_SHM_REFERENCE_PREFIX. The payloads
+  // are released to the producer once view_batch is destroyed. Returns false
+  // if a reference could not be resolved; its parameter is left empty.
+  static bool ResolveSharedMemoryReferences(
+      torchserve::InferenceRequestViewBatch& view_batch,
+      SharedMemoryRegistry& registry);
+  // Moves each response msg of at least min_size bytes into ring and replaces
+  // it with a PayloadType::kHEADER_NAME_SHM_REFERENCE header.
+  static void WriteResponsesToSharedMemory(
+      std::shared_ptr<InferenceResponseBatch>& inference_response_batch,
+      SharedMemoryRing& ring, size_t min_size);
   static bool SendInferenceResponse(
       const ISocket& client_socket_,
       std::shared_ptr<InferenceResponseBatch>& inference_response_batch);
   static void EncodeInferenceResponse(
       std::shared_ptr<InferenceResponseBatch>& inference_response_batch,
       std::vector<char>& data_buffer);
+  /**
+   * @brief
+   * Scatter-gather variant of EncodeInferenceResponse: the small framing
+   * fields are written into framing_buffer and iovecs is filled with the
+   * frame in order, referencing each response msg in place instead of copying
+   * it. iovecs is only valid while framing_buffer and the batch are alive.
+   */
+  static void EncodeInferenceResponse(
+      std::shared_ptr<InferenceResponseBatch>& inference_response_batch,
+      std::vector<char>& framing_buffer, std::vector<iovec>& iovecs);
+
+  /**
+   * @brief
+   * Frontend side of the protocol, for tools that stand in for the frontend.
+   * Each call appends one command, including its cmd byte, to data_buffer.
+   * Parameter content types are taken from the "<name>:contentType" headers
+   * that RetrieveInferenceMsg produces, those headers are not sent as
+   * headers.
+   */
+  static void EncodeLoadModelRequest(const LoadModelRequest& request,
+                                     std::vector<char>& data_buffer);
+  static void EncodeInferenceRequest(
+      const InferenceRequestBatch& inference_request_batch,
+      std::vector<char>& data_buffer);
+  // Decode what SendLoadModelResponse and SendInferenceResponse send.
+  static std::unique_ptr<LoadModelResponse> RetrieveLoadModelResponse(
+      const ISocket& client_socket_);
+  static std::shared_ptr<InferenceResponseBatch> RetrieveInferenceResponse(
+      const ISocket& client_socket_);
 
  private:
   static std::shared_ptr<InferenceRequest> RetrieveInferenceRequest(
@@ -53,6 +101,9 @@ class OTFMessage {
       InferenceRequest::Headers& inference_request_headers,
       InferenceRequest::Parameters& inference_request_parameters,
       bool& is_valid);
+  static std::string_view RetrieveBufferToArena(const ISocket& client_socket_,
+                                                Arena& arena, int length,
+                                                size_t alignment = 1);
   static std::shared_ptr<std::string> RetrieveStringBuffer(
       const ISocket& client_socket_, std::optional<int> length);
   static void AppendIntegerToCharVector(std::vector<char>& dest_vector,
@@ -0,0 +1,242 @@
+#include "shared_memory.hh"
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <limits>
+
+#include "src/utils/logging.hh"
+
+namespace torchserve {
+namespace {
+bool ParseSize(std::string_view text, std::size_t& value) {
+  auto result = std::from_chars(text.data(), text.data() + text.size(), value);
+  return result.ec == std::errc() && result.ptr == text.data() + text.size();
+}
+
+// slot header fields, see SharedMemoryRing
+uint32_t* SlotReleased(char* slot) { return reinterpret_cast<uint32_t*>(slot); }
+
+uint32_t* SlotSize(char* slot) {
+  return reinterpret_cast<uint32_t*>(slot + sizeof(uint32_t));
+}
+
+std::size_t AlignSlot(std::size_t size) {
+  constexpr std::size_t kAlignment = SharedMemoryRing::kSlotHeaderSize;
+  return (size + kAlignment - 1) / kAlignment * kAlignment;
+}
+}  // namespace
+
+std::optional<SharedMemoryReference> SharedMemoryReference::Parse(
+    std::string_view text) {
+  auto length_pos = text.rfind(':');
+  if (length_pos == std::string_view::npos || length_pos == 0) {
+    return std::nullopt;
+  }
+  auto offset_pos = text.rfind(':', length_pos - 1);
+  if (offset_pos == std::string_view::npos || offset_pos == 0) {
+    return std::nullopt;
+  }
+
+  SharedMemoryReference reference;
+  reference.name = std::string(text.substr(0, offset_pos));
+  if (!ParseSize(text.substr(offset_pos + 1, length_pos - offset_pos - 1),
+                 reference.offset) ||
+      !ParseSize(text.substr(length_pos + 1), reference.length)) {
+    return std::nullopt;
+  }
+  return reference;
+}
+
+std::string SharedMemoryReference::ToString() const {
+  return name + ":" + std::to_string(offset) + ":" + std::to_string(length);
+}
+
+std::shared_ptr<SharedMemoryRegion> SharedMemoryRegion::Open(
+    const std::string& name, bool writable) {
+  int fd = shm_open(name.c_str(), writable ? O_RDWR : O_RDONLY, 0);
+  if (fd < 0) {
+    TS_LOGF(ERROR, "Failed to open shared memory {}. errno: {}", name, errno);
+    return nullptr;
+  }
+  auto region = Map(name, fd, writable);
+  close(fd);
+  return region;
+}
+
+std::shared_ptr<SharedMemoryRegion> SharedMemoryRegion::Map(
+    const std::string& name, int fd, bool writable) {
+  struct stat shm_stat {};
+  if (fstat(fd, &shm_stat) != 0 || shm_stat.st_size <= 0) {
+    TS_LOGF(ERROR, "Failed to get size of shared memory {}. errno: {}", name,
+            errno);
+    return nullptr;
+  }
+  auto size = static_cast<std::size_t>(shm_stat.st_size);
+  int protection = writable ? PROT_READ | PROT_WRITE : PROT_READ;
+  void* data = mmap(nullptr, size, protection, MAP_SHARED, fd, 0);
+  if (data == MAP_FAILED) {
+    TS_LOGF(ERROR, "Failed to map shared memory {}. errno: {}", name, errno);
+    return nullptr;
+  }
+  return std::shared_ptr<SharedMemoryRegion>(new SharedMemoryRegion(
+      name, static_cast<char*>(data), size, shm_stat.st_ino));
+}
+
+std::shared_ptr<SharedMemoryRegion> SharedMemoryRegion::Create(
+    const std::string& name, std::size_t size) {
+  int fd = shm_open(name.c_str(), O_RDWR | O_CREAT | O_TRUNC, 0600);
+  if (fd < 0) {
+    TS_LOGF(ERROR, "Failed to create shared memory {}. errno: {}", name,
+            errno);
+    return nullptr;
+  }
+  if (ftruncate(fd, static_cast<off_t>(size)) != 0) {
+    TS_LOGF(ERROR, "Failed to resize shared memory {}. errno: {}", name,
+            errno);
+    close(fd);
+    return nullptr;
+  }
+  close(fd);
+  return Open(name, true);
+}
+
+SharedMemoryRegion::~SharedMemoryRegion() { munmap(data_, size_); }
+
+std::optional<std::string_view> SharedMemoryRegion::View(
+    const SharedMemoryReference& reference) const {
+  if (reference.offset > size_ || reference.length > size_ - reference.offset) {
+    return std::nullopt;
+  }
+  return std::string_view(data_ + reference.offset, reference.length);
+}
+
+std::shared_ptr<SharedMemoryRegion> SharedMemoryRegistry::Get(
+    const std::string& name) {
+  // the object is checked on every lookup, a peer may have recreated it
+  int fd = shm_open(name.c_str(), O_RDWR, 0);
+  if (fd < 0) {
+    TS_LOGF(ERROR, "Failed to open shared memory {}. errno: {}", name, errno);
+    std::lock_guard<std::mutex> lock(mutex_);
+    regions_.erase(name);
+    return nullptr;
+  }
+  struct stat shm_stat {};
+  if (fstat(fd, &shm_stat) != 0) {
+    TS_LOGF(ERROR, "Failed to get size of shared memory {}. errno: {}", name,
+            errno);
+    close(fd);
+    return nullptr;
+  }
+
+  std::lock_guard<std::mutex> lock(mutex_);
+  auto region_it = regions_.find(name);
+  if (region_it != regions_.end() &&
+      region_it->second->GetInode() == shm_stat.st_ino &&
+      region_it->second->GetSize() ==
+          static_cast<std::size_t>(shm_stat.st_size)) {
+    close(fd);
+    return region_it->second;
+  }
+  auto region = SharedMemoryRegion::Map(name, fd, true);
+  close(fd);
+  if (region) {
+    regions_[name] = region;
+  } else {
+    regions_.erase(name);
+  }
+  return region;
+}
+
+SharedMemoryRing::SharedMemoryRing(std::shared_ptr<SharedMemoryRegion> region)
+    : region_(std::move(region)),
+      capacity_(region_ ? region_->GetSize() / kSlotHeaderSize *
+                              kSlotHeaderSize
+                        : 0) {}
+
+std::optional<SharedMemoryReference> SharedMemoryRing::Write(
+    std::string_view data) {
+  std::size_t slot_size = AlignSlot(kSlotHeaderSize + data.size());
+  if (slot_size > capacity_ ||
+      slot_size > std::numeric_limits<uint32_t>::max()) {
+    return std::nullopt;
+  }
+  SharedMemoryReference reference;
+  reference.name = region_->GetName();
+  reference.length = data.size();
+  char* slot = nullptr;
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    Reclaim();
+    // a slot does not wrap, the end of the region is skipped instead
+    std::size_t padding = capacity_ - head_ < slot_size ? capacity_ - head_ : 0;
+    if (bytes_in_use_ + padding + slot_size > capacity_) {
+      return std::nullopt;
+    }
+    if (padding > 0) {
+      char* padding_slot = region_->GetData() + head_;
+      *SlotSize(padding_slot) = static_cast<uint32_t>(padding);
+      __atomic_store_n(SlotReleased(padding_slot), 1, __ATOMIC_RELEASE);
+      bytes_in_use_ += padding;
+      head_ = 0;
+    }
+    slot = region_->GetData() + head_;
+    *SlotSize(slot) = static_cast<uint32_t>(slot_size);
+    __atomic_store_n(SlotReleased(slot), 0, __ATOMIC_RELEASE);
+    reference.offset = head_ + kSlotHeaderSize;
+    head_ = (head_ + slot_size) % capacity_;
+    bytes_in_use_ += slot_size;
+  }
+  // the slot is not reclaimed before the peer got and released reference
+  std::memcpy(slot + kSlotHeaderSize, data.data(), data.size());
+  return reference;
+}
+
+std::size_t SharedMemoryRing::GetBytesInUse() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  Reclaim();
+  return bytes_in_use_;
+}
+
+void SharedMemoryRing::Reclaim() {
+  while (bytes_in_use_ > 0) {
+    char* slot = region_->GetData() + tail_;
+    if (__atomic_load_n(SlotReleased(slot), __ATOMIC_ACQUIRE) == 0) {
+      return;
+    }
+    std::size_t slot_size = *SlotSize(slot);
+    bytes_in_use_ -= slot_size;
+    tail_ = (tail_ + slot_size) % capacity_;
+  }
+  // start over at the beginning of the empty ring, which saves padding
+  head_ = tail_ = 0;
+}
+
+void SharedMemoryRing::Release(const SharedMemoryRegion& region,
+                               const SharedMemoryReference& reference) {
+  if (reference.offset < kSlotHeaderSize ||
+      reference.offset % kSlotHeaderSize != 0 ||
+      reference.offset > region.GetSize()) {
+    TS_LOGF(ERROR, "Can not release shared memory reference {}",
+            reference.ToString());
+    return;
+  }
+  char* slot = region.GetData() + reference.offset - kSlotHeaderSize;
+  __atomic_store_n(SlotReleased(slot), 1, __ATOMIC_RELEASE);
+}
+
+std::shared_ptr<void> SharedMemoryRing::Hold(
+    std::shared_ptr<SharedMemoryRegion> region,
+    const SharedMemoryReference& reference) {
+  auto* raw_region = region.get();
+  return std::shared_ptr<void>(
+      raw_region, [region = std::move(region), reference](void*) {
+        Release(*region, reference);
+      });
+}
+}  // namespace torchserve
@@ -0,0 +1,152 @@
+#ifndef TS_CPP_BACKENDS_PROTOCOL_SHARED_MEMORY_HH_
+#define TS_CPP_BACKENDS_PROTOCOL_SHARED_MEMORY_HH_
+
+#include <sys/types.h>
+
+#include <cstddef>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+
+namespace torchserve {
+/**
+ * @brief
+ * Location of a payload in a POSIX shared memory object, sent over OTF in
+ * place of the payload bytes. Payloads are written by a SharedMemoryRing, and
+ * the receiver releases them once consumed, see SharedMemoryRing::Release.
+ * Text format: <shm name>:<offset>:<length>, e.g. /ts_ring_0:4096:1048576
+ */
+struct SharedMemoryReference {
+  std::string name;
+  std::size_t offset = 0;
+  std::size_t length = 0;
+
+  static std::optional<SharedMemoryReference> Parse(std::string_view text);
+  std::string ToString() const;
+};
+
+/**
+ * @brief
+ * A mapped POSIX shared memory object (shm_open + mmap), unmapped on
+ * destruction.
+ */
+class SharedMemoryRegion {
+ public:
+  // Opens an existing object and maps all of it.
+  static std::shared_ptr<SharedMemoryRegion> Open(const std::string& name,
+                                                  bool writable);
+  // Maps all of the object open as fd, which stays owned by the caller.
+  static std::shared_ptr<SharedMemoryRegion> Map(const std::string& name,
+                                                 int fd, bool writable);
+  // Creates (or truncates) an object of the given size, mapped read-write.
+  static std::shared_ptr<SharedMemoryRegion> Create(const std::string& name,
+                                                    std::size_t size);
+
+  SharedMemoryRegion(const SharedMemoryRegion&) = delete;
+  ~SharedMemoryRegion();
+
+  const std::string& GetName() const { return name_; }
+  char* GetData() const { return data_; }
+  std::size_t GetSize() const { return size_; }
+  // identifies the object mapped, a recreated object gets a new inode
+  ino_t GetInode() const { return inode_; }
+  // Returns the bytes of reference, or std::nullopt if out of bounds.
+  std::optional<std::string_view> View(
+      const SharedMemoryReference& reference) const;
+
+ private:
+  SharedMemoryRegion(const std::string& name, char* data, std::size_t size,
+                     ino_t inode)
+      : name_(name), data_(data), size_(size), inode_(inode){};
+
+  std::string name_;
+  char* data_;
+  std::size_t size_;
+  ino_t inode_;
+};
+
+/**
+ * @brief
+ * Caches the regions referenced by incoming requests so that each shared
+ * memory object is mapped once per worker. A cached mapping is replaced when
+ * the object was recreated or resized, and dropped when it was removed;
+ * requests still using the old mapping keep it until they are done. Regions
+ * are mapped writable so that payloads can be released. Thread safe.
+ */
+class SharedMemoryRegistry {
+ public:
+  // Returns nullptr if the object cannot be opened.
+  std::shared_ptr<SharedMemoryRegion> Get(const std::string& name);
+
+ private:
+  std::mutex mutex_;
+  std::map<std::string, std::shared_ptr<SharedMemoryRegion>> regions_;
+};
+
+/**
+ * @brief
+ * Ring allocator over a writable region, used to hand payloads to the peer
+ * process.
+ *
+ * Each payload is preceded by a slot header in the region:
+ * | uint32 released | uint32 slot size |
+ * The peer stores 1 to released once it consumed the payload, see Release.
+ * Slots are reclaimed in the order they were written, as soon as they are
+ * released, so a slot released early waits for the ones before it. Write
+ * fails instead of overwriting a payload the peer did not release yet, and
+ * the caller sends that payload inline. Thread safe.
+ */
+class SharedMemoryRing {
+ public:
+  static constexpr std::size_t kSlotHeaderSize = 8;
+
+  explicit SharedMemoryRing(std::shared_ptr<SharedMemoryRegion> region);
+
+  // Copies data into the ring and returns its reference, or std::nullopt if
+  // the ring has no room for it.
+  std::optional<SharedMemoryReference> Write(std::string_view data);
+  const std::shared_ptr<SharedMemoryRegion>& GetRegion() const {
+    return region_;
+  }
+  // bytes of the slots that are not reclaimed yet
+  std::size_t GetBytesInUse();
+
+  // Marks the payload of reference, written by a SharedMemoryRing into
+  // region, as consumed.
+  static void Release(const SharedMemoryRegion& region,
+                      const SharedMemoryReference& reference);
+  // Keeps region mapped and releases reference once the returned handle is
+  // destroyed.
+  static std::shared_ptr<void> Hold(std::shared_ptr<SharedMemoryRegion> region,
+                                    const SharedMemoryReference& reference);
+
+ private:
+  // Frees the released slots at the tail. Requires mutex_.
+  void Reclaim();
+
+  std::shared_ptr<SharedMemoryRegion> region_;
+  // region size rounded down to the slot alignment
+  std::size_t capacity_;
+  std::mutex mutex_;
+  // next slot is written at head_, the oldest live slot is at tail_
+  std::size_t head_ = 0;
+  std::size_t tail_ = 0;
+  std::size_t bytes_in_use_ = 0;
+};
+
+/**
+ * @brief
+ * Shared memory side channel of a worker: parameters sent as references are
+ * resolved through registry, and responses of at least min_response_size
+ * bytes are returned through ring.
+ */
+struct SharedMemoryChannel {
+  SharedMemoryRegistry registry;
+  std::unique_ptr<SharedMemoryRing> ring;
+  std::size_t min_response_size = 0;
+};
+}  // namespace torchserve
+#endif  // TS_CPP_BACKENDS_PROTOCOL_SHARED_MEMORY_HH_
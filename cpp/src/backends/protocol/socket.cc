@@ -1,6 +1,9 @@
 #include "socket.hh"
 
+#include <limits.h>
 #include <unistd.h>
+
+#include <algorithm>
 #include <cstring>
 
 namespace torchserve {
@@ -24,17 +27,48 @@ bool Socket::SendAll(size_t length, char* data) const {
   return true;
 };
 
+bool Socket::SendAllV(std::vector<iovec>& buffers) const {
+  auto iov_it = buffers.begin();
+  while (iov_it != buffers.end()) {
+    msghdr msg{};
+    msg.msg_iov = &*iov_it;
+    msg.msg_iovlen = std::min<size_t>(buffers.end() - iov_it, IOV_MAX);
+    ssize_t pkt_size = sendmsg(client_socket_, &msg, 0);
+    if (pkt_size < 0) {
+      TS_LOGF(INFO, "Error sending data to socket. errno: {}", errno);
+      return false;
+    }
+    AdvanceIovecs(iov_it, buffers.end(), static_cast<size_t>(pkt_size));
+  }
+  return true;
+}
+
+void Socket::AdvanceIovecs(std::vector<iovec>::iterator& iov_it,
+                           std::vector<iovec>::iterator iov_end, size_t sent) {
+  // skip fully sent buffers and advance into a partially sent one
+  while (iov_it != iov_end && sent >= iov_it->iov_len) {
+    sent -= iov_it->iov_len;
+    ++iov_it;
+  }
+  if (sent > 0) {
+    iov_it->iov_base = static_cast<char*>(iov_it->iov_base) + sent;
+    iov_it->iov_len -= sent;
+  }
+}
+
 void Socket::RetrieveBuffer(size_t length, char* data) const {
   char* pkt = data;
   while (length > 0) {
     ssize_t pkt_size = recv(client_socket_, pkt, length, 0);
     if (pkt_size == 0) {
-      TS_LOG(INFO, "Frontend disconnected.");
-      close(client_socket_);
-      exit(0);
+      throw SocketError("Frontend disconnected.");
     }
     if (pkt_size < 0) {
-      TS_LOGF(FATAL, "Error recieving data from socket. errno: ", errno);
+      if (errno == EINTR) {
+        continue;
+      }
+      TS_LOGF(ERROR, "Error recieving data from socket. errno: {}", errno);
+      throw SocketError("Error recieving data from socket.");
     }
     pkt += pkt_size;
     length -= pkt_size;
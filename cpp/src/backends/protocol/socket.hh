@@ -4,6 +4,7 @@
 #include <arpa/inet.h>
 #include <sys/socket.h>
 
+#include <stdexcept>
 #include <string>
 
 #include "isocket.hh"
@@ -16,17 +17,29 @@ namespace torchserve {
 #define LOAD_MSG 'L'
 #define PREDICT_MSG 'I'
 
+// Thrown when the frontend disconnects, the connection fails or a message can
+// not be framed.
+class SocketError : public std::runtime_error {
+ public:
+  using std::runtime_error::runtime_error;
+};
+
 class Socket : public ISocket {
  public:
   Socket(int client_socket) : client_socket_(client_socket) {}
   Socket(const Socket &) = delete;
   ~Socket() override;
   bool SendAll(size_t length, char *data) const override;
+  bool SendAllV(std::vector<iovec> &buffers) const override;
   void RetrieveBuffer(size_t length, char *data) const override;
   int RetrieveInt() const override;
   bool RetrieveBool() const override;
 
- private:
+ protected:
+  // Advances iov_it past the first sent bytes of a gather list.
+  static void AdvanceIovecs(std::vector<iovec>::iterator &iov_it,
+                            std::vector<iovec>::iterator iov_end, size_t sent);
+
   int client_socket_;
 };
 }  // namespace torchserve
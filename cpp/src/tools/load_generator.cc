@@ -0,0 +1,205 @@
+#include "src/tools/load_generator.hh"
+
+#include <fmt/format.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+#include <thread>
+
+#include "src/backends/protocol/buffered_socket.hh"
+#include "src/backends/protocol/otf_message.hh"
+#include "src/utils/logging.hh"
+
+namespace torchserve {
+void LoadReport::Merge(const LoadReport& other) {
+  batches += other.batches;
+  requests += other.requests;
+  errors += other.errors;
+  latencies_ms.insert(latencies_ms.end(), other.latencies_ms.begin(),
+                      other.latencies_ms.end());
+}
+
+double LoadReport::Percentile(double p) const {
+  if (latencies_ms.empty()) {
+    return 0;
+  }
+  // the epsilon keeps e.g. p999 of 1000 samples at rank 999
+  auto rank = static_cast<size_t>(std::ceil(
+      p / 100 * static_cast<double>(latencies_ms.size()) - 1e-9));
+  return latencies_ms[std::clamp<size_t>(rank, 1, latencies_ms.size()) - 1];
+}
+
+std::string LoadReport::ToString() const {
+  double seconds = elapsed_sec > 0 ? elapsed_sec : 1;
+  return fmt::format(
+      "batches: {}, requests: {}, errors: {}, elapsed: {:.3f} s\n"
+      "throughput: {:.1f} requests/s, {:.1f} batches/s\n"
+      "latency (ms): p50 {:.3f}, p90 {:.3f}, p99 {:.3f}, p999 {:.3f}, "
+      "max {:.3f}",
+      batches, requests, errors, elapsed_sec, requests / seconds,
+      batches / seconds, Percentile(50), Percentile(90), Percentile(99),
+      Percentile(99.9), latencies_ms.empty() ? 0 : latencies_ms.back());
+}
+
+LoadReport LoadGenerator::Run() {
+  LoadReport report;
+  batches_started_ = 0;
+  auto start = std::chrono::steady_clock::now();
+  std::vector<std::thread> connections;
+  for (unsigned int i = 0; i < std::max(config_.concurrency, 1U); ++i) {
+    connections.emplace_back([this, i, start, &report]() {
+      RunConnection(i, start, report);
+    });
+  }
+  for (auto& connection : connections) {
+    connection.join();
+  }
+  std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+  report.elapsed_sec = elapsed.count();
+  std::sort(report.latencies_ms.begin(), report.latencies_ms.end());
+  return report;
+}
+
+void LoadGenerator::RunConnection(unsigned int connection_index,
+                                  std::chrono::steady_clock::time_point start,
+                                  LoadReport& report) {
+  LoadReport connection_report;
+  try {
+    auto client_socket = connector_();
+    if (config_.load_model_request) {
+      std::vector<char> data_buffer;
+      OTFMessage::EncodeLoadModelRequest(*config_.load_model_request,
+                                         data_buffer);
+      client_socket->SendAll(data_buffer.size(), data_buffer.data());
+      auto response = OTFMessage::RetrieveLoadModelResponse(*client_socket);
+      if (response->code != 200) {
+        TS_LOGF(ERROR, "Failed to load model: {}", response->buf);
+        return;
+      }
+    }
+
+    // each connection keeps its share of the rate, connections are staggered
+    // evenly within an interval
+    unsigned int concurrency = std::max(config_.concurrency, 1U);
+    std::chrono::duration<double> interval(
+        config_.rate > 0 ? concurrency / config_.rate : 0);
+    double offset = static_cast<double>(connection_index) / concurrency;
+    auto end = start + config_.duration;
+    size_t payload_index = connection_index;
+    for (uint64_t sequence = 0;; ++sequence) {
+      auto scheduled = std::chrono::steady_clock::now();
+      if (config_.rate > 0) {
+        scheduled =
+            start + std::chrono::duration_cast<std::chrono::nanoseconds>(
+                        interval * (static_cast<double>(sequence) + offset));
+        std::this_thread::sleep_until(scheduled);
+      }
+      if (scheduled >= end ||
+          (config_.max_batches > 0 &&
+           batches_started_.fetch_add(1) >= config_.max_batches)) {
+        break;
+      }
+
+      InferenceRequestBatch batch;
+      std::set<std::string> pending_request_ids;
+      for (unsigned int i = 0; i < config_.batch_size; ++i) {
+        InferenceRequest request;
+        request.request_id =
+            fmt::format("{}-{}-{}", connection_index, sequence, i);
+        request.headers[PayloadType::kPARAMETER_NAME_BODY + ":contentType"] =
+            config_.content_type;
+        if (!config_.payloads.empty()) {
+          request.parameters[PayloadType::kPARAMETER_NAME_BODY] =
+              config_.payloads[payload_index++ % config_.payloads.size()];
+        }
+        pending_request_ids.insert(request.request_id);
+        batch.push_back(std::move(request));
+      }
+      std::vector<char> data_buffer;
+      OTFMessage::EncodeInferenceRequest(batch, data_buffer);
+      if (!client_socket->SendAll(data_buffer.size(), data_buffer.data())) {
+        throw SocketError("Failed to send inference request");
+      }
+
+      RetrieveFinalResponses(*client_socket, std::move(pending_request_ids),
+                             connection_report);
+      std::chrono::duration<double, std::milli> latency =
+          std::chrono::steady_clock::now() - scheduled;
+      connection_report.latencies_ms.push_back(latency.count());
+      connection_report.batches++;
+    }
+  } catch (const SocketError& e) {
+    TS_LOGF(ERROR, "Connection {} failed: {}", connection_index, e.what());
+  }
+
+  std::lock_guard<std::mutex> lock(report_mutex_);
+  report.Merge(connection_report);
+}
+
+void LoadGenerator::RetrieveFinalResponses(
+    const ISocket& client_socket, std::set<std::string> pending_request_ids,
+    LoadReport& report) {
+  while (!pending_request_ids.empty()) {
+    auto responses = OTFMessage::RetrieveInferenceResponse(client_socket);
+    for (const auto& response : *responses) {
+      auto stream_next_it =
+          response.headers.find(PayloadType::kHEADER_NAME_STREAM_NEXT);
+      if (stream_next_it != response.headers.end() &&
+          stream_next_it->second == "true") {
+        continue;
+      }
+      if (pending_request_ids.erase(response.request_id) == 0) {
+        continue;
+      }
+      report.requests++;
+      if (response.code != 200) {
+        report.errors++;
+      }
+    }
+  }
+}
+
+LoadGenerator::Connector LoadGenerator::ConnectTo(
+    const std::string& socket_type, const std::string& socket_name,
+    const std::string& host, const std::string& port) {
+  return [=]() -> std::unique_ptr<ISocket> {
+    sockaddr_un sock_addr_un{};
+    sockaddr_in sock_addr_in{};
+    sockaddr* sock_address = nullptr;
+    socklen_t name_len = 0;
+    int socket_family = AF_INET;
+    if (socket_type == "unix") {
+      socket_family = AF_UNIX;
+      sock_addr_un.sun_family = AF_UNIX;
+      std::strncpy(sock_addr_un.sun_path, socket_name.c_str(),
+                   sizeof(sock_addr_un.sun_path) - 1);
+      sock_address = reinterpret_cast<sockaddr*>(&sock_addr_un);
+      name_len = SUN_LEN(&sock_addr_un);
+    } else {
+      sock_addr_in.sin_family = AF_INET;
+      sock_addr_in.sin_port = htons(std::stoi(port));
+      sock_addr_in.sin_addr.s_addr = inet_addr(host.c_str());
+      sock_address = reinterpret_cast<sockaddr*>(&sock_addr_in);
+      name_len = sizeof(sock_addr_in);
+    }
+
+    int client_socket = socket(socket_family, SOCK_STREAM, 0);
+    if (client_socket < 0) {
+      throw SocketError(
+          fmt::format("Failed to create socket. errno: {}", errno));
+    }
+    if (connect(client_socket, sock_address, name_len) != 0) {
+      int connect_errno = errno;
+      close(client_socket);
+      throw SocketError(
+          fmt::format("Failed to connect to worker. errno: {}", connect_errno));
+    }
+    return std::make_unique<BufferedSocket>(client_socket);
+  };
+}
+}  // namespace torchserve
@@ -0,0 +1,95 @@
+#ifndef TS_CPP_TOOLS_LOAD_GENERATOR_HH_
+#define TS_CPP_TOOLS_LOAD_GENERATOR_HH_
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "src/backends/protocol/isocket.hh"
+#include "src/utils/message.hh"
+
+namespace torchserve {
+struct LoadGeneratorConfig {
+  // sent once per connection before the inference traffic, nullptr to skip
+  std::shared_ptr<LoadModelRequest> load_model_request;
+  // request bodies, used round robin
+  std::vector<std::vector<char>> payloads;
+  std::string content_type = "application/octet-stream";
+  unsigned int batch_size = 1;
+  // number of connections, each with one batch in flight
+  unsigned int concurrency = 1;
+  // batches per second over all connections, 0 to send as fast as responses
+  // come back
+  double rate = 0;
+  std::chrono::milliseconds duration{10000};
+  // stop after this many batches, 0 for no limit
+  uint64_t max_batches = 0;
+};
+
+struct LoadReport {
+  uint64_t batches = 0;
+  uint64_t requests = 0;
+  // requests answered with a status other than 200
+  uint64_t errors = 0;
+  double elapsed_sec = 0;
+  // batch latencies, sorted once the run is over
+  std::vector<double> latencies_ms;
+
+  // Adds the counts and latencies of other, e.g. of a single connection.
+  void Merge(const LoadReport& other);
+  // Nearest-rank percentile, p in [0, 100].
+  double Percentile(double p) const;
+  std::string ToString() const;
+};
+
+/**
+ * @brief
+ * Stands in for the frontend: sends L and I commands to a model worker over
+ * OTF and measures batch latency, i.e. the time from when a batch is due to
+ * be sent until the final responses of all of its requests have arrived.
+ * Intermediate (streamed) responses are read and skipped.
+ *
+ * With a rate, batches are sent on a fixed schedule and latency is measured
+ * from the scheduled time, so a slow worker shows up as latency instead of
+ * as a lower send rate.
+ */
+class LoadGenerator {
+ public:
+  // Opens a new connection to the worker.
+  using Connector = std::function<std::unique_ptr<ISocket>()>;
+
+  LoadGenerator(LoadGeneratorConfig config, Connector connector)
+      : config_(std::move(config)), connector_(std::move(connector)){};
+
+  LoadReport Run();
+
+  // Connector for a worker started with the given model_worker_socket flags.
+  // The returned connector throws SocketError if the worker is unreachable.
+  static Connector ConnectTo(const std::string& socket_type,
+                             const std::string& socket_name,
+                             const std::string& host, const std::string& port);
+
+  // Reads responses until every request in pending_request_ids got its final
+  // response and counts these in report. Throws SocketError.
+  static void RetrieveFinalResponses(const ISocket& client_socket,
+                                     std::set<std::string> pending_request_ids,
+                                     LoadReport& report);
+
+ private:
+  void RunConnection(unsigned int connection_index,
+                     std::chrono::steady_clock::time_point start,
+                     LoadReport& report);
+
+  LoadGeneratorConfig config_;
+  Connector connector_;
+  std::mutex report_mutex_;
+  std::atomic<uint64_t> batches_started_{0};
+};
+}  // namespace torchserve
+#endif  // TS_CPP_TOOLS_LOAD_GENERATOR_HH_
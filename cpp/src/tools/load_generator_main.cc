@@ -0,0 +1,70 @@
+#include <gflags/gflags.h>
+
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <sstream>
+
+#include "src/tools/load_generator.hh"
+#include "src/utils/logging.hh"
+
+DEFINE_string(sock_type, "tcp", "socket type of the worker, tcp or unix");
+DEFINE_string(sock_name, "", "socket name for uds");
+DEFINE_string(host, "127.0.0.1", "");
+DEFINE_string(port, "9000", "");
+DEFINE_string(logger_config_path, "", "Logging config file path");
+DEFINE_string(model_dir, "",
+              "model path sent with the load command, empty to skip loading");
+DEFINE_string(model_name, "model", "model name sent with the load command");
+DEFINE_string(handler, "", "handler sent with the load command");
+DEFINE_int32(gpu_id, -1, "-1 for CPU");
+DEFINE_string(payload_files, "",
+              "comma separated files used round robin as request bodies");
+DEFINE_string(content_type, "application/octet-stream",
+              "content type of the request bodies");
+DEFINE_uint32(batch_size, 1, "requests per inference command");
+DEFINE_uint32(concurrency, 1,
+              "number of connections, the worker needs max_connections of at "
+              "least this");
+DEFINE_double(rate, 0,
+              "batches per second over all connections, 0 for closed loop");
+DEFINE_uint32(duration_sec, 10, "length of the run");
+DEFINE_uint64(max_batches, 0, "stop after this many batches, 0 for no limit");
+
+int main(int argc, char* argv[]) {
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  torchserve::Logger::InitLogger(FLAGS_logger_config_path);
+
+  torchserve::LoadGeneratorConfig config;
+  if (!FLAGS_model_dir.empty()) {
+    config.load_model_request = std::make_shared<torchserve::LoadModelRequest>(
+        FLAGS_model_dir, FLAGS_model_name, FLAGS_gpu_id, FLAGS_handler, "",
+        FLAGS_batch_size, false);
+  }
+  std::istringstream payload_files(FLAGS_payload_files);
+  std::string payload_file;
+  while (std::getline(payload_files, payload_file, ',')) {
+    std::ifstream input(payload_file, std::ios::in | std::ios::binary);
+    if (!input.good()) {
+      std::cerr << "Failed to read payload file " << payload_file << "\n";
+      return 1;
+    }
+    config.payloads.emplace_back(std::istreambuf_iterator<char>(input),
+                                 std::istreambuf_iterator<char>());
+  }
+  config.content_type = FLAGS_content_type;
+  config.batch_size = FLAGS_batch_size;
+  config.concurrency = FLAGS_concurrency;
+  config.rate = FLAGS_rate;
+  config.duration = std::chrono::seconds(FLAGS_duration_sec);
+  config.max_batches = FLAGS_max_batches;
+
+  torchserve::LoadGenerator load_generator(
+      config, torchserve::LoadGenerator::ConnectTo(
+                  FLAGS_sock_type, FLAGS_sock_name, FLAGS_host, FLAGS_port));
+  std::cout << load_generator.Run().ToString() << std::endl;
+
+  gflags::ShutDownCommandLineFlags();
+  return 0;
+}
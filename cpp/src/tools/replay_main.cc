@@ -0,0 +1,39 @@
+#include <gflags/gflags.h>
+
+#include <iostream>
+#include <stdexcept>
+
+#include "src/tools/replayer.hh"
+#include "src/utils/logging.hh"
+
+DEFINE_string(sock_type, "tcp", "socket type of the worker, tcp or unix");
+DEFINE_string(sock_name, "", "socket name for uds");
+DEFINE_string(host, "127.0.0.1", "");
+DEFINE_string(port, "9000", "");
+DEFINE_string(logger_config_path, "", "Logging config file path");
+DEFINE_string(capture_file, "",
+              "capture written by model_worker_socket --capture_file");
+DEFINE_double(speed, 1,
+              "1 for the captured timing, 2 for twice as fast, 0 to send "
+              "commands as soon as the previous one is answered");
+
+int main(int argc, char* argv[]) {
+  gflags::ParseCommandLineFlags(&argc, &argv, true);
+  torchserve::Logger::InitLogger(FLAGS_logger_config_path);
+
+  torchserve::ReplayConfig config;
+  config.capture_file = FLAGS_capture_file;
+  config.speed = FLAGS_speed;
+  torchserve::Replayer replayer(
+      config, torchserve::LoadGenerator::ConnectTo(
+                  FLAGS_sock_type, FLAGS_sock_name, FLAGS_host, FLAGS_port));
+  try {
+    std::cout << replayer.Run().ToString() << std::endl;
+  } catch (const std::runtime_error& e) {
+    std::cerr << e.what() << "\n";
+    return 1;
+  }
+
+  gflags::ShutDownCommandLineFlags();
+  return 0;
+}
@@ -0,0 +1,100 @@
+#include "src/tools/replayer.hh"
+
+#include <algorithm>
+#include <memory>
+#include <set>
+#include <thread>
+#include <vector>
+
+#include "src/backends/protocol/memory_socket.hh"
+#include "src/backends/protocol/otf_message.hh"
+#include "src/utils/logging.hh"
+
+namespace torchserve {
+LoadReport Replayer::Run() {
+  std::vector<std::unique_ptr<CaptureReader>> readers;
+  auto connection_ids = CaptureReader::ReadConnectionIds(config_.capture_file);
+  for (auto connection_id : connection_ids) {
+    readers.push_back(
+        std::make_unique<CaptureReader>(config_.capture_file, connection_id));
+  }
+
+  LoadReport report;
+  auto start = std::chrono::steady_clock::now();
+  std::vector<std::thread> connections;
+  for (size_t i = 0; i < connection_ids.size(); ++i) {
+    connections.emplace_back([this, connection_id = connection_ids[i],
+                              records = readers[i].get(), start, &report]() {
+      RunConnection(connection_id, *records, start, report);
+    });
+  }
+  for (auto& connection : connections) {
+    connection.join();
+  }
+
+  std::chrono::duration<double> elapsed =
+      std::chrono::steady_clock::now() - start;
+  report.elapsed_sec = elapsed.count();
+  std::sort(report.latencies_ms.begin(), report.latencies_ms.end());
+  return report;
+}
+
+void Replayer::RunConnection(uint32_t connection_id, CaptureReader& records,
+                             std::chrono::steady_clock::time_point start,
+                             LoadReport& report) {
+  LoadReport connection_report;
+  try {
+    auto client_socket = connector_();
+    while (auto record = records.Next()) {
+      if (record->frame.empty()) {
+        continue;
+      }
+      char cmd = record->frame[0];
+      std::set<std::string> pending_request_ids;
+      if (cmd == PREDICT_MSG) {
+        // decoded ahead of the due time to know which responses to wait for
+        MemorySocket frame_socket(record->frame);
+        OTFMessage::RetrieveCmd(frame_socket);
+        auto requests = OTFMessage::RetrieveInferenceMsg(frame_socket);
+        for (const auto& request : *requests) {
+          pending_request_ids.insert(request.request_id);
+        }
+      } else if (cmd != LOAD_MSG) {
+        TS_LOGF(WARN, "Skipping unknown command: {}", cmd);
+        continue;
+      }
+
+      auto scheduled = std::chrono::steady_clock::now();
+      if (config_.speed > 0) {
+        scheduled = start + std::chrono::nanoseconds(static_cast<int64_t>(
+                                record->timestamp_ns / config_.speed));
+        std::this_thread::sleep_until(scheduled);
+      }
+      if (!client_socket->SendAll(record->frame.size(),
+                                  record->frame.data())) {
+        throw SocketError("Failed to send command");
+      }
+
+      if (cmd == LOAD_MSG) {
+        auto response = OTFMessage::RetrieveLoadModelResponse(*client_socket);
+        if (response->code != 200) {
+          TS_LOGF(ERROR, "Failed to load model: {}", response->buf);
+        }
+        continue;
+      }
+      LoadGenerator::RetrieveFinalResponses(
+          *client_socket, std::move(pending_request_ids), connection_report);
+      std::chrono::duration<double, std::milli> latency =
+          std::chrono::steady_clock::now() - scheduled;
+      connection_report.latencies_ms.push_back(latency.count());
+      connection_report.batches++;
+    }
+  } catch (const SocketError& e) {
+    // the rest of this connection is dropped
+    TS_LOGF(ERROR, "Connection {} failed: {}", connection_id, e.what());
+  }
+
+  std::lock_guard<std::mutex> lock(report_mutex_);
+  report.Merge(connection_report);
+}
+}  // namespace torchserve
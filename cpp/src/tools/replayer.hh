@@ -0,0 +1,50 @@
+#ifndef TS_CPP_TOOLS_REPLAYER_HH_
+#define TS_CPP_TOOLS_REPLAYER_HH_
+
+#include <chrono>
+#include <mutex>
+#include <string>
+
+#include "src/backends/protocol/capture.hh"
+#include "src/tools/load_generator.hh"
+
+namespace torchserve {
+struct ReplayConfig {
+  // written by model_worker_socket --capture_file
+  std::string capture_file;
+  // 1 keeps the captured timing, 2 replays twice as fast, 0 sends each
+  // command as soon as the previous one on its connection is answered
+  double speed = 1;
+};
+
+/**
+ * @brief
+ * Replays a capture against a model worker. Each captured connection is
+ * replayed on a connection and thread of its own, its commands are sent in
+ * the captured order at their captured time divided by speed. Responses are
+ * read as by LoadGenerator, and every inference command counts as a batch of
+ * the report, with latency measured from the time the command was due.
+ *
+ * Every connection streams its own records from the capture, so a
+ * connection waiting for its worker never holds back the commands of the
+ * others, and the capture size is not limited by memory.
+ */
+class Replayer {
+ public:
+  Replayer(ReplayConfig config, LoadGenerator::Connector connector)
+      : config_(std::move(config)), connector_(std::move(connector)){};
+
+  // Throws std::runtime_error if the capture cannot be read.
+  LoadReport Run();
+
+ private:
+  void RunConnection(uint32_t connection_id, CaptureReader& records,
+                     std::chrono::steady_clock::time_point start,
+                     LoadReport& report);
+
+  ReplayConfig config_;
+  LoadGenerator::Connector connector_;
+  std::mutex report_mutex_;
+};
+}  // namespace torchserve
+#endif  // TS_CPP_TOOLS_REPLAYER_HH_
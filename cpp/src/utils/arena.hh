@@ -0,0 +1,79 @@
+#ifndef TS_CPP_UTILS_ARENA_HH_
+#define TS_CPP_UTILS_ARENA_HH_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <string_view>
+#include <vector>
+
+namespace torchserve {
+/**
+ * @brief
+ * Bump allocator over blocks that never move, so memory handed out stays
+ * valid until the arena is destroyed, however much is allocated after it.
+ * - small allocations share blocks of kBlockSize bytes,
+ * - allocations of at least kLargeSize bytes, e.g. tensor payloads, get a
+ * block of their own, sized exactly.
+ * Memory is not zeroed. Not thread-safe.
+ */
+class Arena {
+ public:
+  static constexpr size_t kBlockSize = 64 * 1024;
+  static constexpr size_t kLargeSize = kBlockSize / 4;
+  // alignment of every block, enough for any tensor dtype
+  static constexpr size_t kBlockAlignment = alignof(std::max_align_t);
+
+  Arena() = default;
+  Arena(const Arena&) = delete;
+  Arena& operator=(const Arena&) = delete;
+
+  // Returns size bytes aligned to alignment, a power of two of at most
+  // kBlockAlignment.
+  char* Allocate(size_t size, size_t alignment = 1) {
+    if (size >= kLargeSize) {
+      return NewBlock(size);
+    }
+    auto padding = static_cast<size_t>(
+        -reinterpret_cast<uintptr_t>(current_) & (alignment - 1));
+    if (current_ == nullptr || padding + size > remaining_) {
+      current_ = NewBlock(kBlockSize);
+      remaining_ = kBlockSize;
+      padding = 0;
+    }
+    char* data = current_ + padding;
+    current_ += padding + size;
+    remaining_ -= padding + size;
+    return data;
+  }
+
+  // Copies data into the arena.
+  std::string_view Copy(std::string_view data) {
+    if (data.empty()) {
+      return std::string_view();
+    }
+    char* copy = Allocate(data.size());
+    std::memcpy(copy, data.data(), data.size());
+    return std::string_view(copy, data.size());
+  }
+
+  // bytes of all blocks
+  size_t Bytes() const { return bytes_; }
+
+ private:
+  char* NewBlock(size_t size) {
+    // new char[] leaves the block uninitialized
+    blocks_.emplace_back(new char[size]);
+    bytes_ += size;
+    return blocks_.back().get();
+  }
+
+  std::vector<std::unique_ptr<char[]>> blocks_;
+  // free part of the last small block
+  char* current_ = nullptr;
+  size_t remaining_ = 0;
+  size_t bytes_ = 0;
+};
+}  // namespace torchserve
+#endif  // TS_CPP_UTILS_ARENA_HH_
@@ -0,0 +1,72 @@
+#ifndef TS_CPP_UTILS_BOUNDED_QUEUE_HH_
+#define TS_CPP_UTILS_BOUNDED_QUEUE_HH_
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <mutex>
+#include <optional>
+#include <utility>
+
+namespace torchserve {
+/**
+ * @brief
+ * Blocking FIFO queue with a fixed capacity, used to connect pipeline stages
+ * running on different threads.
+ * - Push blocks while the queue is full, Pop blocks while it is empty.
+ * - After Close, Push fails and Pop drains the remaining items, then returns
+ * std::nullopt.
+ */
+template <typename T>
+class BoundedQueue {
+ public:
+  explicit BoundedQueue(std::size_t capacity)
+      : capacity_(capacity > 0 ? capacity : 1){};
+  BoundedQueue(const BoundedQueue&) = delete;
+  ~BoundedQueue() = default;
+
+  bool Push(T item) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    not_full_.wait(lock,
+                   [this]() { return closed_ || items_.size() < capacity_; });
+    if (closed_) {
+      return false;
+    }
+    items_.push_back(std::move(item));
+    lock.unlock();
+    not_empty_.notify_one();
+    return true;
+  };
+
+  std::optional<T> Pop() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    not_empty_.wait(lock, [this]() { return closed_ || !items_.empty(); });
+    if (items_.empty()) {
+      return std::nullopt;
+    }
+    std::optional<T> item(std::move(items_.front()));
+    items_.pop_front();
+    lock.unlock();
+    not_full_.notify_one();
+    return item;
+  };
+
+  void Close() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      closed_ = true;
+    }
+    not_full_.notify_all();
+    not_empty_.notify_all();
+  };
+
+ private:
+  const std::size_t capacity_;
+  bool closed_ = false;
+  std::deque<T> items_;
+  std::mutex mutex_;
+  std::condition_variable not_full_;
+  std::condition_variable not_empty_;
+};
+}  // namespace torchserve
+#endif  // TS_CPP_UTILS_BOUNDED_QUEUE_HH_
@@ -0,0 +1,291 @@
+#include "src/utils/cpu_affinity.hh"
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+#include <algorithm>
+#include <cctype>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <sstream>
+#include <stdexcept>
+#include <thread>
+#include <utility>
+
+#include "src/utils/logging.hh"
+
+namespace torchserve {
+namespace {
+// cpu list of a sysfs file, empty if it can not be read
+CpuAffinity::CpuSet ReadCpuList(const std::filesystem::path& path) {
+  std::ifstream file(path);
+  std::string cpu_list;
+  if (!file || !std::getline(file, cpu_list)) {
+    return {};
+  }
+  try {
+    return CpuAffinity::ParseCpuList(cpu_list);
+  } catch (const std::invalid_argument& e) {
+    TS_LOGF(WARN, "Invalid cpu list in {}: {}", path.string(), cpu_list);
+    return {};
+  }
+}
+}  // namespace
+
+CpuAffinity::CpuSet CpuAffinity::ParseCpuList(const std::string& cpu_list) {
+  CpuSet cpus;
+  std::istringstream ranges(cpu_list);
+  std::string range;
+  while (std::getline(ranges, range, ',')) {
+    if (range.empty()) {
+      continue;
+    }
+    size_t first_end = 0;
+    int first = 0;
+    int last = 0;
+    try {
+      first = std::stoi(range, &first_end);
+      last = first;
+      if (first_end < range.size() && range[first_end] == '-') {
+        last = std::stoi(range.substr(first_end + 1));
+      }
+    } catch (const std::logic_error& e) {
+      throw std::invalid_argument(
+          fmt::format("invalid cpu list: {}", cpu_list));
+    }
+    if (first < 0 || last < first) {
+      throw std::invalid_argument(
+          fmt::format("invalid cpu list: {}", cpu_list));
+    }
+    for (int cpu = first; cpu <= last; ++cpu) {
+      cpus.push_back(cpu);
+    }
+  }
+  std::sort(cpus.begin(), cpus.end());
+  cpus.erase(std::unique(cpus.begin(), cpus.end()), cpus.end());
+  return cpus;
+}
+
+std::string CpuAffinity::ToCpuList(const CpuSet& cpus) {
+  std::string cpu_list;
+  for (size_t i = 0; i < cpus.size();) {
+    size_t last = i;
+    while (last + 1 < cpus.size() && cpus[last + 1] == cpus[last] + 1) {
+      ++last;
+    }
+    cpu_list += cpu_list.empty() ? "" : ",";
+    cpu_list += last == i ? std::to_string(cpus[i])
+                          : fmt::format("{}-{}", cpus[i], cpus[last]);
+    i = last + 1;
+  }
+  return cpu_list;
+}
+
+std::vector<CpuAffinity::CpuSet> CpuAffinity::GetNumaNodes() {
+  // e.g. restricted by a container's cpuset
+  auto allowed = GetThreadAffinity();
+  auto is_allowed = [&allowed](int cpu) {
+    return allowed.empty() ||
+           std::binary_search(allowed.begin(), allowed.end(), cpu);
+  };
+
+  std::vector<CpuSet> nodes;
+  std::error_code error;
+  // by node id, directory order is arbitrary
+  std::map<int, CpuSet> node_cpus;
+  for (const auto& entry : std::filesystem::directory_iterator(
+           "/sys/devices/system/node", error)) {
+    auto name = entry.path().filename().string();
+    if (name.rfind("node", 0) != 0 || name.size() == 4 ||
+        !std::all_of(name.begin() + 4, name.end(), ::isdigit)) {
+      continue;
+    }
+    node_cpus[std::stoi(name.substr(4))] =
+        ReadCpuList(entry.path() / "cpulist");
+  }
+  for (auto& [node_id, cpus] : node_cpus) {
+    cpus.erase(
+        std::remove_if(cpus.begin(), cpus.end(),
+                       [&is_allowed](int cpu) { return !is_allowed(cpu); }),
+        cpus.end());
+    if (!cpus.empty()) {
+      nodes.push_back(std::move(cpus));
+    }
+  }
+  if (!nodes.empty()) {
+    return nodes;
+  }
+
+  // topology unknown, a single node
+  if (!allowed.empty()) {
+    return {allowed};
+  }
+  CpuSet cpus;
+  int cpu_count = static_cast<int>(std::thread::hardware_concurrency());
+  for (int cpu = 0; cpu < cpu_count; ++cpu) {
+    cpus.push_back(cpu);
+  }
+  return {cpus};
+}
+
+std::vector<CpuAffinity::CpuSet> CpuAffinity::Partition(
+    const std::vector<CpuSet>& nodes, size_t instance_count) {
+  std::vector<CpuSet> partition(instance_count);
+  if (instance_count == 0 || nodes.empty()) {
+    return partition;
+  }
+  if (instance_count < nodes.size()) {
+    for (size_t node = 0; node < nodes.size(); ++node) {
+      auto& cpus = partition[node % instance_count];
+      cpus.insert(cpus.end(), nodes[node].begin(), nodes[node].end());
+    }
+    for (auto& cpus : partition) {
+      std::sort(cpus.begin(), cpus.end());
+    }
+    return partition;
+  }
+
+  for (size_t node = 0; node < nodes.size(); ++node) {
+    // instances node, node + nodes.size(), ... share this node
+    size_t node_instances =
+        (instance_count - node + nodes.size() - 1) / nodes.size();
+    const auto& cpus = nodes[node];
+    for (size_t slot = 0; slot < node_instances; ++slot) {
+      // contiguous slices, so that hyperthread siblings listed next to each
+      // other stay together; every instance gets at least one cpu
+      size_t begin = slot * cpus.size() / node_instances;
+      size_t end =
+          std::max(begin + 1, (slot + 1) * cpus.size() / node_instances);
+      begin = std::min(begin, cpus.size() - 1);
+      end = std::min(end, cpus.size());
+      partition[node + slot * nodes.size()] =
+          CpuSet(cpus.begin() + begin, cpus.begin() + end);
+    }
+  }
+  return partition;
+}
+
+CpuAffinity::CpuSet CpuAffinity::GetThreadAffinity() {
+  CpuSet cpus;
+#ifdef __linux__
+  cpu_set_t cpu_set;
+  CPU_ZERO(&cpu_set);
+  if (pthread_getaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set) !=
+      0) {
+    return cpus;
+  }
+  for (int cpu = 0; cpu < CPU_SETSIZE; ++cpu) {
+    if (CPU_ISSET(cpu, &cpu_set)) {
+      cpus.push_back(cpu);
+    }
+  }
+#endif
+  return cpus;
+}
+
+bool CpuAffinity::SetThreadAffinity(const CpuSet& cpus) {
+#ifdef __linux__
+  cpu_set_t cpu_set;
+  CPU_ZERO(&cpu_set);
+  for (int cpu : cpus) {
+    if (cpu < CPU_SETSIZE) {
+      CPU_SET(cpu, &cpu_set);
+    }
+  }
+  return pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set) ==
+         0;
+#else
+  return false;
+#endif
+}
+
+ScopedCpuAffinity::ScopedCpuAffinity(const CpuAffinity::CpuSet& cpus) {
+  if (cpus.empty()) {
+    return;
+  }
+  previous_ = CpuAffinity::GetThreadAffinity();
+  if (!CpuAffinity::SetThreadAffinity(cpus)) {
+    TS_LOGF(DEBUG, "Could not pin thread to cpus {}",
+            CpuAffinity::ToCpuList(cpus));
+    previous_.clear();
+  }
+}
+
+ScopedCpuAffinity::~ScopedCpuAffinity() {
+  if (!previous_.empty()) {
+    CpuAffinity::SetThreadAffinity(previous_);
+  }
+}
+
+PinnedExecutor::PinnedExecutor(CpuAffinity::CpuSet cpus,
+                               std::function<void()> init)
+    : cpus_(std::move(cpus)), init_(std::move(init)) {}
+
+PinnedExecutor::~PinnedExecutor() {
+  {
+    std::lock_guard<std::mutex> lock(mutex_);
+    stopped_ = true;
+  }
+  task_cv_.notify_all();
+  for (auto& thread : threads_) {
+    thread.join();
+  }
+}
+
+void PinnedExecutor::Run(const std::function<void()>& task) {
+  Task pending{&task};
+  std::unique_lock<std::mutex> lock(mutex_);
+  tasks_.push_back(&pending);
+  // idle threads that were notified may not have taken theirs yet, threads
+  // being started count as idle
+  if (tasks_.size() > idle_) {
+    ++idle_;
+    threads_.emplace_back(&PinnedExecutor::Loop, this);
+  } else {
+    task_cv_.notify_one();
+  }
+  done_cv_.wait(lock, [&pending]() { return pending.done; });
+  lock.unlock();
+  if (pending.error) {
+    std::rethrow_exception(pending.error);
+  }
+}
+
+size_t PinnedExecutor::GetThreadCount() {
+  std::lock_guard<std::mutex> lock(mutex_);
+  return threads_.size();
+}
+
+void PinnedExecutor::Loop() {
+  if (!cpus_.empty() && !CpuAffinity::SetThreadAffinity(cpus_)) {
+    TS_LOGF(DEBUG, "Could not pin thread to cpus {}",
+            CpuAffinity::ToCpuList(cpus_));
+  }
+  if (init_) {
+    init_();
+  }
+  std::unique_lock<std::mutex> lock(mutex_);
+  while (true) {
+    task_cv_.wait(lock, [this]() { return stopped_ || !tasks_.empty(); });
+    --idle_;
+    if (tasks_.empty()) {
+      return;
+    }
+    auto* task = tasks_.front();
+    tasks_.pop_front();
+    lock.unlock();
+    try {
+      (*task->run)();
+    } catch (...) {
+      task->error = std::current_exception();
+    }
+    lock.lock();
+    task->done = true;
+    done_cv_.notify_all();
+    ++idle_;
+  }
+}
+}  // namespace torchserve
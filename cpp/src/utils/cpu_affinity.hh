@@ -0,0 +1,113 @@
+#ifndef TS_CPP_UTILS_CPU_AFFINITY_HH_
+#define TS_CPP_UTILS_CPU_AFFINITY_HH_
+
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace torchserve {
+/**
+ * @brief
+ * Host CPU topology and thread pinning, used to keep a model instance on the
+ * cores of one NUMA node. Pinning is Linux only and a no-op elsewhere.
+ */
+class CpuAffinity {
+ public:
+  // sorted CPU ids
+  using CpuSet = std::vector<int>;
+
+  // Parses a Linux cpu list, e.g. "0-3,8-11". Throws std::invalid_argument
+  // if it is malformed.
+  static CpuSet ParseCpuList(const std::string& cpu_list);
+
+  static std::string ToCpuList(const CpuSet& cpus);
+
+  // CPUs of each NUMA node the process may run on, a single node with all of
+  // them if the topology is unknown.
+  static std::vector<CpuSet> GetNumaNodes();
+
+  /**
+   * @brief
+   * Splits the CPUs of nodes into instance_count disjoint sets that do not
+   * cross a node, as long as there are at least as many instances as nodes:
+   * - instance i runs on node i % nodes.size(), the instances of a node
+   * share its CPUs evenly.
+   * - with fewer instances than nodes, instance i gets the nodes j with
+   * j % instance_count == i.
+   */
+  static std::vector<CpuSet> Partition(const std::vector<CpuSet>& nodes,
+                                       size_t instance_count);
+
+  // CPUs the calling thread may run on, empty if unknown.
+  static CpuSet GetThreadAffinity();
+
+  // Pins the calling thread to cpus. Returns false if it could not.
+  static bool SetThreadAffinity(const CpuSet& cpus);
+};
+
+/**
+ * @brief
+ * Pins the calling thread to cpus for the lifetime of the object, then
+ * restores its previous affinity. Does nothing if cpus is empty.
+ */
+class ScopedCpuAffinity {
+ public:
+  explicit ScopedCpuAffinity(const CpuAffinity::CpuSet& cpus);
+  ScopedCpuAffinity(const ScopedCpuAffinity&) = delete;
+  ~ScopedCpuAffinity();
+
+ private:
+  CpuAffinity::CpuSet previous_;
+};
+
+/**
+ * @brief
+ * Threads pinned to cpus once, when they start, that run the tasks of their
+ * callers, e.g. the batches of a model instance.
+ * - Run hands a task to an idle thread and blocks until it completes, so
+ * concurrent callers still run concurrently: a thread is started whenever
+ * all of them are busy, up to the number of concurrent callers, and kept.
+ * - init runs once on each thread after pinning it, e.g. to size the
+ * thread's intra-op pool.
+ */
+class PinnedExecutor {
+ public:
+  explicit PinnedExecutor(CpuAffinity::CpuSet cpus,
+                          std::function<void()> init = {});
+  PinnedExecutor(const PinnedExecutor&) = delete;
+  // Joins the threads. Requires that no call to Run is in progress.
+  ~PinnedExecutor();
+
+  // Runs task on one of the threads, rethrows what it throws.
+  void Run(const std::function<void()>& task);
+
+  size_t GetThreadCount();
+
+ private:
+  struct Task {
+    const std::function<void()>* run;
+    std::exception_ptr error;
+    bool done = false;
+  };
+
+  void Loop();
+
+  const CpuAffinity::CpuSet cpus_;
+  const std::function<void()> init_;
+  std::mutex mutex_;
+  std::condition_variable task_cv_;
+  std::condition_variable done_cv_;
+  std::deque<Task*> tasks_;
+  // threads waiting for a task or being started
+  size_t idle_ = 0;
+  bool stopped_ = false;
+  std::vector<std::thread> threads_;
+};
+}  // namespace torchserve
+#endif  // TS_CPP_UTILS_CPU_AFFINITY_HH_
@@ -0,0 +1,163 @@
+#ifndef TS_CPP_UTILS_HASH128_HH_
+#define TS_CPP_UTILS_HASH128_HH_
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+
+namespace torchserve {
+struct Digest128 {
+  uint64_t low = 0;
+  uint64_t high = 0;
+
+  bool operator==(const Digest128& other) const {
+    return low == other.low && high == other.high;
+  }
+  bool operator!=(const Digest128& other) const { return !(*this == other); }
+};
+
+/**
+ * @brief
+ * Streaming 128-bit non-cryptographic hash in the style of XXH64/XXH3-128,
+ * kept in tree since xxhash is not a dependency: four 64-bit lanes consume
+ * the input in 32-byte stripes as it is fed, and Digest folds them into two
+ * differently mixed halves. Input can be fed in pieces of any size without
+ * being copied, the digest only depends on the bytes fed. Words are read
+ * little-endian, as on every platform the backend is built for.
+ */
+class Hasher128 {
+ public:
+  explicit Hasher128(uint64_t seed = 0)
+      : seed_(seed),
+        lanes_{seed + kPrime1 + kPrime2, seed + kPrime2, seed, seed - kPrime1} {
+  }
+
+  void Update(const void* data, size_t size) {
+    const auto* input = static_cast<const char*>(data);
+    total_size_ += size;
+    if (buffered_ + size < kStripeSize) {
+      if (size > 0) {
+        std::memcpy(buffer_ + buffered_, input, size);
+      }
+      buffered_ += size;
+      return;
+    }
+    if (buffered_ > 0) {
+      size_t fill = kStripeSize - buffered_;
+      std::memcpy(buffer_ + buffered_, input, fill);
+      Consume(buffer_);
+      input += fill;
+      size -= fill;
+      buffered_ = 0;
+    }
+    for (; size >= kStripeSize; input += kStripeSize, size -= kStripeSize) {
+      Consume(input);
+    }
+    if (size > 0) {
+      std::memcpy(buffer_, input, size);
+    }
+    buffered_ = size;
+  }
+
+  void Update(std::string_view data) { Update(data.data(), data.size()); }
+
+  // The digest of everything fed so far, more can be fed afterwards.
+  Digest128 Digest() const {
+    uint64_t low;
+    uint64_t high;
+    if (total_size_ >= kStripeSize) {
+      low = Rotl(lanes_[0], 1) + Rotl(lanes_[1], 7) + Rotl(lanes_[2], 12) +
+            Rotl(lanes_[3], 18);
+      high = Rotl(lanes_[0], 18) + Rotl(lanes_[1], 12) + Rotl(lanes_[2], 7) +
+             Rotl(lanes_[3], 1);
+      for (int i = 0; i < 4; ++i) {
+        low = MergeRound(low, lanes_[i]);
+        high = MergeRound(high, lanes_[3 - i]);
+      }
+    } else {
+      low = seed_ + kPrime5;
+      high = seed_ + kPrime3;
+    }
+    low += total_size_;
+    high += total_size_ * kPrime5;
+    return Digest128{Avalanche(FoldTail(low)),
+                     Avalanche(FoldTail(high) ^ Rotl(low, 29))};
+  }
+
+ private:
+  static constexpr size_t kStripeSize = 32;
+  static constexpr uint64_t kPrime1 = 0x9E3779B185EBCA87ULL;
+  static constexpr uint64_t kPrime2 = 0xC2B2AE3D27D4EB4FULL;
+  static constexpr uint64_t kPrime3 = 0x165667B19E3779F9ULL;
+  static constexpr uint64_t kPrime4 = 0x85EBCA77C2B2AE63ULL;
+  static constexpr uint64_t kPrime5 = 0x27D4EB2F165667C5ULL;
+
+  static uint64_t Rotl(uint64_t value, int bits) {
+    return (value << bits) | (value >> (64 - bits));
+  }
+
+  static uint64_t Read64(const char* data) {
+    uint64_t value;
+    std::memcpy(&value, data, sizeof(value));
+    return value;
+  }
+
+  static uint64_t Round(uint64_t lane, uint64_t input) {
+    lane += input * kPrime2;
+    lane = Rotl(lane, 31);
+    return lane * kPrime1;
+  }
+
+  static uint64_t MergeRound(uint64_t hash, uint64_t lane) {
+    hash ^= Round(0, lane);
+    return hash * kPrime1 + kPrime4;
+  }
+
+  static uint64_t Avalanche(uint64_t hash) {
+    hash ^= hash >> 33;
+    hash *= kPrime2;
+    hash ^= hash >> 29;
+    hash *= kPrime3;
+    hash ^= hash >> 32;
+    return hash;
+  }
+
+  void Consume(const char* stripe) {
+    for (int i = 0; i < 4; ++i) {
+      lanes_[i] = Round(lanes_[i], Read64(stripe + 8 * i));
+    }
+  }
+
+  // mixes the bytes fed since the last full stripe into hash
+  uint64_t FoldTail(uint64_t hash) const {
+    const char* tail = buffer_;
+    size_t size = buffered_;
+    for (; size >= 8; tail += 8, size -= 8) {
+      hash ^= Round(0, Read64(tail));
+      hash = Rotl(hash, 27) * kPrime1 + kPrime4;
+    }
+    if (size >= 4) {
+      uint32_t word;
+      std::memcpy(&word, tail, sizeof(word));
+      hash ^= word * kPrime1;
+      hash = Rotl(hash, 23) * kPrime2 + kPrime3;
+      tail += 4;
+      size -= 4;
+    }
+    for (; size > 0; ++tail, --size) {
+      hash ^= static_cast<uint8_t>(*tail) * kPrime5;
+      hash = Rotl(hash, 11) * kPrime1;
+    }
+    return hash;
+  }
+
+  const uint64_t seed_;
+  uint64_t lanes_[4];
+  // the bytes of the stripe being fed
+  char buffer_[kStripeSize];
+  size_t buffered_ = 0;
+  uint64_t total_size_ = 0;
+};
+}  // namespace torchserve
+#endif  // TS_CPP_UTILS_HASH128_HH_
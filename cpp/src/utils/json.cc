@@ -39,6 +39,12 @@ namespace torchserve
         return data.template get<int>();
     }
 
+
+    bool Json::AsBool()
+    {
+        return data.template get<bool>();
+    }
+
     Json Json::GetValue(const std::string& key)
     {
         if(data.contains(key)){
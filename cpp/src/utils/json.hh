@@ -14,6 +14,7 @@ namespace torchserve
         bool HasKey(const std::string& key);
         std::string AsString();
         int AsInt();
+        bool AsBool();
     protected:
         Json(nlohmann::json _data);
         nlohmann::json data;
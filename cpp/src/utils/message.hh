@@ -1,12 +1,18 @@
 #ifndef TS_CPP_UTILS_MESSAGE_HH_
 #define TS_CPP_UTILS_MESSAGE_HH_
 
+#include <chrono>
 #include <cstddef>
 #include <map>
 #include <memory>
+#include <optional>
 #include <string>
+#include <string_view>
+#include <utility>
 #include <vector>
 
+#include "src/utils/arena.hh"
+
 namespace torchserve {
 class PayloadType {
  public:
@@ -20,6 +26,48 @@ class PayloadType {
   inline static const std::string kCONTENT_TYPE_TEXT = "text";
   inline static const std::string kDATA_TYPE_STRING = "string";
   inline static const std::string kDATA_TYPE_BYTES = "bytes";
+  // dtype/shape/strides header followed by the tensor bytes, see RawTensor in
+  // src/backends/handler/raw_tensor.hh. Also recognized by its magic when
+  // sent as kDATA_TYPE_BYTES.
+  inline static const std::string kDATA_TYPE_RAW_TENSOR = "raw_tensor";
+
+  // A parameter whose content type starts with this prefix carries a
+  // shared memory reference "<shm name>:<offset>:<length>" instead of the
+  // payload. The rest of the content type is the payload's own content type.
+  inline static const std::string kCONTENT_TYPE_SHM_REFERENCE_PREFIX =
+      "x-ts-shm-ref;";
+  // Set on a response whose msg was moved to shared memory, the value is the
+  // shared memory reference.
+  inline static const std::string kHEADER_NAME_SHM_REFERENCE = "x-ts-shm-ref";
+
+  // Response header of a streamed request: "true" on intermediate responses,
+  // "false" on the final one. Same as ts/protocol/otf_message_handler.py.
+  inline static const std::string kHEADER_NAME_STREAM_NEXT = "ts_stream_next";
+
+  // Request headers set by the frontend with sequence batching, the defaults
+  // of ts_header_key_sequence_id and ts_header_key_sequence_end.
+  inline static const std::string kHEADER_NAME_SEQUENCE_ID =
+      "ts_request_sequence_id";
+  inline static const std::string kHEADER_NAME_SEQUENCE_END =
+      "ts_request_sequence_end";
+
+  // Request headers that bound how long a request may take, see
+  // BaseHandler::GetDeadline. Expired requests are answered with
+  // kCODE_DEADLINE_EXCEEDED without being handled. The frontend should send
+  // ts_request_timeout_ms, the milliseconds the client still waits when the
+  // request is sent to the worker, which is measured on the worker's steady
+  // clock from the time it reads the request. The other two are in
+  // milliseconds since the Unix epoch and compared with the worker's wall
+  // clock: the time after which the client no longer waits, which relies on
+  // the client's clock, and the time the frontend enqueued the request,
+  // which expires after the manifest's responseTimeoutSec.
+  inline static const std::string kHEADER_NAME_TIMEOUT =
+      "ts_request_timeout_ms";
+  inline static const std::string kHEADER_NAME_DEADLINE =
+      "ts_request_deadline_ms";
+  inline static const std::string kHEADER_NAME_ENQUEUE_TIME =
+      "ts_request_enqueue_time_ms";
+  static constexpr int kCODE_DEADLINE_EXCEEDED = 408;
 };
 
 class Converter {
@@ -50,8 +98,8 @@ struct LoadModelRequest {
   const std::string model_dir;
   const std::string model_name;
   // Existing: -1 if CPU else gpu_id
+  // The CPU cores of a CPU instance are set by the manifest's cpuAffinity.
   // TODO:
-  // - support CPU core
   // - device type combine together
   int gpu_id;
   // Expected to be null for cpp backend
@@ -93,6 +141,8 @@ struct LoadModelResponse {
 // Due to https://github.com/llvm/llvm-project/issues/54668,
 // so ignore bugprone-exception-escape
 // NOLINTBEGIN(bugprone-exception-escape)
+// Owning inference request, built by the tools that stand in for the
+// frontend. The worker decodes requests into an InferenceRequestViewBatch.
 struct InferenceRequest {
   /**
    * @brief
@@ -118,6 +168,95 @@ struct InferenceRequest {
 // Ref: Ref: https://github.com/pytorch/serve/blob/master/ts/service.py#L36
 using InferenceRequestBatch = std::vector<InferenceRequest>;
 
+/**
+ * @brief
+ * Non-owning view of an inference request, the form handlers get requests
+ * in. All views point into the InferenceRequestViewBatch that holds this
+ * request, i.e. its arena or its external buffers, so the view is only
+ * valid as long as that batch is alive.
+ * - headers and parameters keep the wire order; when a name appears more than
+ * once, the last entry wins, which matches InferenceRequest.
+ */
+struct InferenceRequestView {
+  using Header = std::pair<std::string_view, std::string_view>;
+  using Parameter = std::pair<std::string_view, std::string_view>;
+
+  std::string_view request_id;
+  std::vector<Header> headers;
+  std::vector<Parameter> parameters;
+  // when the worker read the request from the frontend, the clock's epoch if
+  // it was not read from a connection
+  std::chrono::steady_clock::time_point received;
+  // position of the request in its batch, where its response goes in the
+  // batch's InferenceResponseBatch; kept when requests are removed from or
+  // moved between batches
+  size_t index = 0;
+
+  std::optional<std::string_view> GetHeader(std::string_view name) const {
+    return Find(headers, name);
+  }
+
+  std::optional<std::string_view> GetParameter(std::string_view name) const {
+    return Find(parameters, name);
+  }
+
+ private:
+  static std::optional<std::string_view> Find(
+      const std::vector<std::pair<std::string_view, std::string_view>>& fields,
+      std::string_view name) {
+    for (auto it = fields.rbegin(); it != fields.rend(); ++it) {
+      if (it->first == name) {
+        return it->second;
+      }
+    }
+    return std::nullopt;
+  }
+};
+
+/**
+ * @brief
+ * A batch of inference requests that handlers read in place.
+ * - arena: owns the bytes of the batch (ids, headers, parameters) that
+ * were read from the frontend
+ * - requests: views into the arena, in batch order
+ * - external_buffers: keeps alive memory outside the arena that parameters
+ * point to, e.g. shared memory payloads or the batches merged into this one
+ */
+struct InferenceRequestViewBatch {
+  Arena arena;
+  std::vector<InferenceRequestView> requests;
+  std::vector<std::shared_ptr<void>> external_buffers;
+
+  // Appends a copy of request, e.g. for tools and tests that build requests
+  // as InferenceRequest.
+  InferenceRequestView& Add(const InferenceRequest& request) {
+    auto& view = requests.emplace_back();
+    view.index = requests.size() - 1;
+    view.request_id = arena.Copy(request.request_id);
+    view.headers.reserve(request.headers.size());
+    for (const auto& [name, value] : request.headers) {
+      view.headers.emplace_back(arena.Copy(name), arena.Copy(value));
+    }
+    view.parameters.reserve(request.parameters.size());
+    for (const auto& [name, value] : request.parameters) {
+      view.parameters.emplace_back(
+          arena.Copy(name),
+          arena.Copy(std::string_view(value.data(), value.size())));
+    }
+    return view;
+  }
+
+  static std::shared_ptr<InferenceRequestViewBatch> FromRequests(
+      const InferenceRequestBatch& request_batch) {
+    auto view_batch = std::make_shared<InferenceRequestViewBatch>();
+    view_batch->requests.reserve(request_batch.size());
+    for (const auto& request : request_batch) {
+      view_batch->Add(request);
+    }
+    return view_batch;
+  }
+};
+
 struct InferenceResponse {
   using Headers = std::map<std::string, std::string>;
 
@@ -127,14 +266,24 @@ struct InferenceResponse {
   Headers headers;
   std::vector<char> msg;
 
+  InferenceResponse() = default;
   InferenceResponse(const std::string& request_id) : request_id(request_id){};
 
+  // Empties the response for request_id, keeping the capacity of msg.
+  void Reset(std::string_view new_request_id) {
+    code = 200;
+    request_id.assign(new_request_id);
+    headers.clear();
+    msg.clear();
+  }
+
   void SetResponse(int new_code, const std::string& new_header_key,
                    const std::string& new_header_val,
                    const std::string& new_msg) {
     code = new_code;
     headers[new_header_key] = new_header_val;
-    msg = torchserve::Converter::StrToVector(new_msg);
+    // keeps the capacity of a reused response
+    msg.assign(new_msg.begin(), new_msg.end());
   };
 
   void SetResponse(int new_code, const std::string& new_header_key,
@@ -144,9 +293,91 @@ struct InferenceResponse {
     headers[new_header_key] = new_header_val;
     msg = new_msg;
   };
+
+  // takes over new_msg, e.g. a payload encoded for this response
+  void SetResponse(int new_code, const std::string& new_header_key,
+                   const std::string& new_header_val,
+                   std::vector<char>&& new_msg) {
+    code = new_code;
+    headers[new_header_key] = new_header_val;
+    msg = std::move(new_msg);
+  };
 };
 // Ref: https://github.com/pytorch/serve/blob/master/ts/service.py#L105
-using InferenceResponseBatch =
-    std::map<std::string, std::shared_ptr<InferenceResponse>>;
+/**
+ * @brief
+ * Responses of a batch, stored by value in the order they are sent in.
+ * - the final responses of a request batch are sized by Reset: the response
+ * of a request is at its InferenceRequestView::index, i.e. in request order,
+ * whatever order the handler, the response cache or the batch aggregator
+ * answer the requests in,
+ * - intermediate responses and responses read from a connection are
+ * appended with Add.
+ * Clear and Reset keep the responses and their buffers, so that a batch
+ * that is reused, e.g. through an ObjectPool, does not allocate once warm.
+ * References into the batch are valid until the next Add, Reset or Clear.
+ */
+class InferenceResponseBatch {
+ public:
+  using iterator = std::vector<InferenceResponse>::iterator;
+  using const_iterator = std::vector<InferenceResponse>::const_iterator;
+
+  // One empty response per request of request_batch, at the request's
+  // index, which must be below the number of requests.
+  void Reset(const InferenceRequestViewBatch& request_batch) {
+    size_ = request_batch.requests.size();
+    if (responses_.size() < size_) {
+      responses_.resize(size_);
+    }
+    for (const auto& request : request_batch.requests) {
+      responses_[request.index].Reset(request.request_id);
+    }
+  }
+
+  // Appends an empty response for request_id.
+  InferenceResponse& Add(std::string_view request_id) {
+    if (size_ == responses_.size()) {
+      responses_.emplace_back();
+    }
+    auto& response = responses_[size_++];
+    response.Reset(request_id);
+    return response;
+  }
+
+  InferenceResponse& operator[](size_t index) { return responses_[index]; }
+  const InferenceResponse& operator[](size_t index) const {
+    return responses_[index];
+  }
+
+  // The first response of request_id, nullptr if there is none. Linear in
+  // the size of the batch, responses are found by index where it is known.
+  InferenceResponse* Find(std::string_view request_id) {
+    for (size_t i = 0; i < size_; ++i) {
+      if (responses_[i].request_id == request_id) {
+        return &responses_[i];
+      }
+    }
+    return nullptr;
+  }
+  const InferenceResponse* Find(std::string_view request_id) const {
+    return const_cast<InferenceResponseBatch*>(this)->Find(request_id);
+  }
+
+  // Removes all responses, keeping them for reuse.
+  void Clear() { size_ = 0; }
+
+  size_t Size() const { return size_; }
+  bool Empty() const { return size_ == 0; }
+
+  iterator begin() { return responses_.begin(); }
+  iterator end() { return responses_.begin() + size_; }
+  const_iterator begin() const { return responses_.begin(); }
+  const_iterator end() const { return responses_.begin() + size_; }
+
+ private:
+  // [0, size_) are the responses of the batch, the rest are kept for reuse
+  std::vector<InferenceResponse> responses_;
+  size_t size_ = 0;
+};
 }  // namespace torchserve
-#endif  // TS_CPP_UTILS_MESSAGE_HH_
\ No newline at end of file
+#endif  // TS_CPP_UTILS_MESSAGE_HH_
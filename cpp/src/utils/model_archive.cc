@@ -42,6 +42,30 @@ bool Manifest::Initialize(const std::string& manifest_json_file_path) {
              false);
     SetValue(model, torchserve::Manifest::kModel_Envelope, model_.envelope,
              false);
+    SetValue(model, torchserve::Manifest::kModel_InstanceSelection,
+             model_.instance_selection, false);
+    SetValue(model, torchserve::Manifest::kModel_SessionStateCacheMb,
+             model_.session_state_cache_mb, false);
+    SetValue(model, torchserve::Manifest::kModel_ResponseCacheMb,
+             model_.response_cache_mb, false);
+    SetValue(model, torchserve::Manifest::kModel_ResponseCacheTtlSec,
+             model_.response_cache_ttl_sec, false);
+    SetValue(model, torchserve::Manifest::kModel_WarmupSamples,
+             model_.warmup_samples, false);
+    SetValue(model, torchserve::Manifest::kModel_WarmupIterations,
+             model_.warmup_iterations, false);
+    SetValue(model, torchserve::Manifest::kModel_CpuAffinity,
+             model_.cpu_affinity, false);
+    SetValue(model, torchserve::Manifest::kModel_CpuInstances,
+             model_.cpu_instances, false);
+    SetValue(model, torchserve::Manifest::kModel_IntraOpThreads,
+             model_.intra_op_threads, false);
+    SetValue(model, torchserve::Manifest::kModel_InterOpThreads,
+             model_.inter_op_threads, false);
+    SetValue(model, torchserve::Manifest::kModel_AutotuneThreads,
+             model_.autotune_threads, false);
+    SetValue(model, torchserve::Manifest::kModel_ResponseTimeoutSec,
+             model_.response_timeout_sec, false);
 
     SetValue(val, torchserve::Manifest::kCreateOn, create_on_, false);
     SetValue(val, torchserve::Manifest::kArchiverVersion, archiver_version_,
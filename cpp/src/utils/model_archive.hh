@@ -29,6 +29,23 @@ class Manifest {
   inline static const std::string kModel_Extensions = "extensions";
   inline static const std::string kModel_ReqirementsFile = "requirementsFile";
   inline static const std::string kModel_SpecFile = "specFile";
+  inline static const std::string kModel_InstanceSelection =
+      "instanceSelection";
+  inline static const std::string kModel_SessionStateCacheMb =
+      "sessionStateCacheMb";
+  inline static const std::string kModel_ResponseCacheMb = "responseCacheMb";
+  inline static const std::string kModel_ResponseCacheTtlSec =
+      "responseCacheTtlSec";
+  inline static const std::string kModel_WarmupSamples = "warmupSamples";
+  inline static const std::string kModel_WarmupIterations =
+      "warmupIterations";
+  inline static const std::string kModel_CpuAffinity = "cpuAffinity";
+  inline static const std::string kModel_CpuInstances = "cpuInstances";
+  inline static const std::string kModel_IntraOpThreads = "intraOpThreads";
+  inline static const std::string kModel_InterOpThreads = "interOpThreads";
+  inline static const std::string kModel_AutotuneThreads = "autotuneThreads";
+  inline static const std::string kModel_ResponseTimeoutSec =
+      "responseTimeoutSec";
   inline static const std::string kCreateOn = "createdOn";
   inline static const std::string kArchiverVersion = "archiverVersion";
   inline static const std::string kRuntimeType = "runtime";
@@ -52,6 +69,50 @@ class Manifest {
     std::string extensions;
     std::string requirements_file;
     std::string spec_file;
+    // How the backend picks a model instance for a batch, see
+    // Backend::InstanceSelection. Optional, cpp backend only.
+    std::string instance_selection;
+    // Memory bound of the session states kept by the handler, see
+    // SessionStore. Optional, cpp backend only.
+    std::string session_state_cache_mb;
+    // Memory bound of the cached responses, see ResponseCache. Optional, cpp
+    // backend only, absent or 0 disables the cache.
+    std::string response_cache_mb;
+    // Seconds a cached response is served, absent or 0 for no expiry.
+    std::string response_cache_ttl_sec;
+    // Comma separated request payloads, relative to the model dir, that
+    // BaseHandler::Warmup runs before an instance is ready. Optional, cpp
+    // backend only.
+    std::string warmup_samples;
+    // Warmup batches per batch size, 1 by default.
+    std::string warmup_iterations;
+    // CPU cores of the CPU model instances: "auto" to partition the host by
+    // NUMA node, or one cpu list per instance separated by ";", e.g.
+    // "0-15;16-31". The sets are taken by the instances of all workers in
+    // turn, by worker index, see Backend::GetCpuSetIndex. Optional, cpp
+    // backend only.
+    std::string cpu_affinity;
+    // Number of CPU model instances a worker loads for equal load requests,
+    // e.g. one per frontend connection, 1 by default. Also the number of
+    // cpu sets "auto" partitions the host into, by default one per NUMA
+    // node.
+    std::string cpu_instances;
+    // Intra-op threads of each model instance. Optional, cpp backend only,
+    // by default the size of a pinned instance's cpu set, else the libtorch
+    // default.
+    std::string intra_op_threads;
+    // Inter-op threads of the worker process, shared by all instances.
+    std::string inter_op_threads;
+    // "true" to pick the fastest intra-op thread count on the warmupSamples
+    // while an instance loads, unless intraOpThreads is set. Per instance
+    // thread counts need libtorch built with OpenMP, otherwise intraOpThreads
+    // applies to the whole process and there is no tuning.
+    std::string autotune_threads;
+    // Seconds after its ts_request_enqueue_time_ms, or else after the worker
+    // received it, that a request is dropped unhandled, the frontend's
+    // response timeout of the model. Optional, cpp backend only, absent or 0
+    // to only honor ts_request_timeout_ms and ts_request_deadline_ms.
+    std::string response_timeout_sec;
   };
   // NOLINTEND(bugprone-exception-escape)
 
@@ -0,0 +1,60 @@
+#ifndef TS_CPP_UTILS_OBJECT_POOL_HH_
+#define TS_CPP_UTILS_OBJECT_POOL_HH_
+
+#include <cstddef>
+#include <memory>
+#include <mutex>
+#include <utility>
+#include <vector>
+
+namespace torchserve {
+/**
+ * @brief
+ * Objects kept for reuse, e.g. response batches whose buffers outlive the
+ * batch they were sent with. Acquire returns an object as Release left it,
+ * callers reset what they use. At most capacity objects are kept, the
+ * others are destroyed. Thread-safe.
+ */
+template <typename T>
+class ObjectPool {
+ public:
+  explicit ObjectPool(std::size_t capacity) : capacity_(capacity){};
+  ObjectPool(const ObjectPool&) = delete;
+  ~ObjectPool() = default;
+
+  // An object released earlier, or a new one if there is none.
+  std::shared_ptr<T> Acquire() {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (!objects_.empty()) {
+        auto object = std::move(objects_.back());
+        objects_.pop_back();
+        return object;
+      }
+    }
+    return std::make_shared<T>();
+  };
+
+  // Keeps object for a later Acquire unless someone else still holds it.
+  void Release(std::shared_ptr<T> object) {
+    if (!object || object.use_count() > 1) {
+      return;
+    }
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (objects_.size() < capacity_) {
+      objects_.push_back(std::move(object));
+    }
+  };
+
+  std::size_t Size() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return objects_.size();
+  };
+
+ private:
+  const std::size_t capacity_;
+  mutable std::mutex mutex_;
+  std::vector<std::shared_ptr<T>> objects_;
+};
+}  // namespace torchserve
+#endif  // TS_CPP_UTILS_OBJECT_POOL_HH_
@@ -0,0 +1,195 @@
+#include "src/backends/core/batch_aggregator.hh"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace torchserve {
+namespace {
+// Answers every request with its request id and records the batch sizes and
+// where the bodies were read from.
+class EchoHandler : public BaseHandler {
+ public:
+  std::pair<std::shared_ptr<void>, std::shared_ptr<torch::Device>> LoadModel(
+      std::shared_ptr<LoadModelRequest>& load_model_request) override {
+    return std::make_pair(nullptr, GetTorchDevice(load_model_request));
+  }
+
+  c10::IValue Preprocess(
+      std::shared_ptr<torch::Device>& device, BatchContext& batch_context,
+      std::shared_ptr<InferenceRequestViewBatch>& request_batch,
+      std::shared_ptr<InferenceResponseBatch>& response_batch) override {
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      batch_sizes_.push_back(request_batch->requests.size());
+      for (const auto& request : request_batch->requests) {
+        auto body = request.GetParameter(PayloadType::kPARAMETER_NAME_BODY);
+        if (body) {
+          body_data_.push_back(body->data());
+        }
+      }
+    }
+    for (auto& request : request_batch->requests) {
+      batch_context.Add(request.request_id,
+                        &(*response_batch)[request.index]);
+    }
+    return c10::IValue();
+  }
+
+  c10::IValue Inference(
+      std::shared_ptr<void> model, c10::IValue& inputs,
+      std::shared_ptr<torch::Device>& device, BatchContext& batch_context,
+      std::shared_ptr<InferenceResponseBatch>& response_batch) override {
+    return inputs;
+  }
+
+  void Postprocess(
+      c10::IValue& data, BatchContext& batch_context,
+      std::shared_ptr<InferenceResponseBatch>& response_batch) override {
+    for (auto& slot : batch_context) {
+      slot.response->SetResponse(200, "data_type",
+                                 PayloadType::kDATA_TYPE_STRING,
+                                 slot.request_id);
+    }
+  }
+
+  std::mutex mutex_;
+  std::vector<size_t> batch_sizes_;
+  std::vector<const char*> body_data_;
+};
+}  // namespace
+
+class BatchAggregatorTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    auto manifest = std::make_shared<Manifest>();
+    handler_->Initialize("", manifest);
+    std::shared_ptr<BaseHandler> handler = handler_;
+    model_instance_ = std::make_shared<ModelInstance>(
+        "cpu:-1:0", nullptr, handler,
+        std::make_shared<torch::Device>(torch::kCPU));
+  }
+
+  // Submits one request per thread and checks that every thread gets the
+  // response of its own request only.
+  void PredictConcurrently(BatchAggregator& batch_aggregator, int threads) {
+    std::vector<std::thread> connections;
+    for (int i = 0; i < threads; ++i) {
+      connections.emplace_back([&batch_aggregator, i]() {
+        InferenceRequest request;
+        request.request_id = "req" + std::to_string(i);
+        auto request_batch = InferenceRequestViewBatch::FromRequests({request});
+        std::shared_ptr<InferenceResponseBatch> response_batch;
+        ASSERT_TRUE(batch_aggregator.Predict(request_batch, response_batch));
+        ASSERT_EQ(response_batch->Size(), 1);
+        ASSERT_EQ((*response_batch)[0].request_id, request.request_id);
+        ASSERT_EQ(Converter::VectorToStr((*response_batch)[0].msg),
+                  request.request_id);
+      });
+    }
+    for (auto& connection : connections) {
+      connection.join();
+    }
+  }
+
+  std::shared_ptr<EchoHandler> handler_ = std::make_shared<EchoHandler>();
+  std::shared_ptr<ModelInstance> model_instance_;
+};
+
+TEST_F(BatchAggregatorTest, TestMergeFullBatch) {
+  // the delay is never reached, the batch runs once it is full
+  BatchAggregator batch_aggregator([this]() { return model_instance_; }, 4,
+                                   std::chrono::minutes(10));
+  PredictConcurrently(batch_aggregator, 4);
+  ASSERT_EQ(handler_->batch_sizes_, std::vector<size_t>({4}));
+}
+
+TEST_F(BatchAggregatorTest, TestMaxBatchDelay) {
+  BatchAggregator batch_aggregator([this]() { return model_instance_; }, 8,
+                                   std::chrono::milliseconds(20));
+  PredictConcurrently(batch_aggregator, 3);
+  size_t requests = 0;
+  for (auto batch_size : handler_->batch_sizes_) {
+    requests += batch_size;
+  }
+  ASSERT_EQ(requests, 3);
+}
+
+TEST_F(BatchAggregatorTest, TestMergedResponsesInRequestOrder) {
+  BatchAggregator batch_aggregator([this]() { return model_instance_; }, 4,
+                                   std::chrono::minutes(10));
+  std::vector<std::thread> connections;
+  for (const auto& prefix : {"a", "b"}) {
+    connections.emplace_back([&batch_aggregator, prefix]() {
+      // not in the order of their ids
+      InferenceRequestBatch requests(2);
+      requests[0].request_id = std::string(prefix) + "1";
+      requests[1].request_id = std::string(prefix) + "0";
+      // reused from a previous command, buffers and all
+      auto response_batch = std::make_shared<InferenceResponseBatch>();
+      response_batch->Add("stale");
+      ASSERT_TRUE(batch_aggregator.Predict(
+          InferenceRequestViewBatch::FromRequests(requests), response_batch));
+      ASSERT_EQ(response_batch->Size(), 2);
+      for (size_t i = 0; i < requests.size(); ++i) {
+        ASSERT_EQ((*response_batch)[i].request_id, requests[i].request_id);
+        ASSERT_EQ(Converter::VectorToStr((*response_batch)[i].msg),
+                  requests[i].request_id);
+      }
+    });
+  }
+  for (auto& connection : connections) {
+    connection.join();
+  }
+  ASSERT_EQ(handler_->batch_sizes_, std::vector<size_t>({4}));
+}
+
+TEST_F(BatchAggregatorTest, TestExternalPayloadsReadInPlace) {
+  BatchAggregator batch_aggregator([this]() { return model_instance_; }, 2,
+                                   std::chrono::minutes(10));
+  std::vector<const char*> payload_data(2);
+  std::vector<std::weak_ptr<std::string>> payloads(2);
+  std::vector<std::thread> connections;
+  for (int i = 0; i < 2; ++i) {
+    connections.emplace_back([&, i]() {
+      // e.g. a shared memory segment the request body points to
+      auto payload = std::make_shared<std::string>(1024, 'a' + i);
+      payload_data[i] = payload->data();
+      payloads[i] = payload;
+      auto request_batch = std::make_shared<InferenceRequestViewBatch>();
+      auto& request = request_batch->requests.emplace_back();
+      request.request_id = request_batch->arena.Copy("req" + std::to_string(i));
+      request.parameters.emplace_back(PayloadType::kPARAMETER_NAME_BODY,
+                                      *payload);
+      request_batch->external_buffers.push_back(std::move(payload));
+      std::shared_ptr<InferenceResponseBatch> response_batch;
+      ASSERT_TRUE(
+          batch_aggregator.Predict(std::move(request_batch), response_batch));
+      ASSERT_EQ(response_batch->Size(), 1);
+      // released by the merged batch before Predict returns
+      ASSERT_TRUE(payloads[i].expired());
+    });
+  }
+  for (auto& connection : connections) {
+    connection.join();
+  }
+  ASSERT_EQ(handler_->batch_sizes_, std::vector<size_t>({2}));
+  std::sort(payload_data.begin(), payload_data.end());
+  std::sort(handler_->body_data_.begin(), handler_->body_data_.end());
+  ASSERT_EQ(handler_->body_data_, payload_data);
+}
+
+TEST_F(BatchAggregatorTest, TestNoModelInstance) {
+  BatchAggregator batch_aggregator([]() { return nullptr; }, 4,
+                                   std::chrono::milliseconds(1));
+  auto request_batch =
+      InferenceRequestViewBatch::FromRequests(InferenceRequestBatch(1));
+  std::shared_ptr<InferenceResponseBatch> response_batch;
+  ASSERT_FALSE(batch_aggregator.Predict(request_batch, response_batch));
+}
+}  // namespace torchserve
@@ -0,0 +1,190 @@
+#include "src/backends/core/response_cache.hh"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace torchserve {
+namespace {
+InferenceRequest CreateRequest(const std::string& request_id,
+                               const std::string& body) {
+  InferenceRequest request;
+  request.request_id = request_id;
+  request.headers[PayloadType::kHEADER_NAME_BODY_TYPE] =
+      PayloadType::kDATA_TYPE_BYTES;
+  request.parameters[PayloadType::kPARAMETER_NAME_BODY] =
+      Converter::StrToVector(body);
+  return request;
+}
+
+std::shared_ptr<InferenceRequestViewBatch> CreateRequestBatch(
+    const InferenceRequestBatch& request_batch) {
+  return InferenceRequestViewBatch::FromRequests(request_batch);
+}
+
+// views a single request, kept alive by the returned batch
+std::shared_ptr<InferenceRequestViewBatch> CreateView(
+    const InferenceRequest& request) {
+  return CreateRequestBatch({request});
+}
+
+// answers every request of request_batch with "<body> out"
+void Handle(InferenceRequestViewBatch& request_batch,
+            InferenceResponseBatch& response_batch) {
+  for (const auto& request : request_batch.requests) {
+    auto body = request.GetParameter(PayloadType::kPARAMETER_NAME_BODY);
+    response_batch[request.index].SetResponse(
+        200, PayloadType::kHEADER_NAME_DATA_TYPE,
+        PayloadType::kDATA_TYPE_STRING, std::string(*body) + " out");
+  }
+}
+}  // namespace
+
+TEST(ResponseCacheTest, TestHitSkipsRequest) {
+  ResponseCache cache("mnist", "mnist:1.0", 1 << 20, std::chrono::seconds(0));
+  auto request_batch = CreateRequestBatch(
+      {CreateRequest("req0", "a"), CreateRequest("req1", "b")});
+  InferenceResponseBatch response_batch;
+  response_batch.Reset(*request_batch);
+  auto misses = cache.Lookup(*request_batch, response_batch);
+  ASSERT_EQ(misses.size(), 2);
+  ASSERT_EQ(request_batch->requests.size(), 2);
+  Handle(*request_batch, response_batch);
+  cache.Store(misses, response_batch);
+  ASSERT_EQ(cache.Size(), 2);
+
+  request_batch = CreateRequestBatch(
+      {CreateRequest("req2", "c"), CreateRequest("req3", "b")});
+  response_batch.Reset(*request_batch);
+  misses = cache.Lookup(*request_batch, response_batch);
+  ASSERT_EQ(request_batch->requests.size(), 1);
+  ASSERT_EQ(request_batch->requests[0].request_id, "req2");
+  ASSERT_EQ(misses.size(), 1);
+  ASSERT_EQ(misses[0].index, 0);
+  ASSERT_EQ(response_batch[1].request_id, "req3");
+  ASSERT_EQ(Converter::VectorToStr(response_batch[1].msg), "b out");
+}
+
+TEST(ResponseCacheTest, TestHitsAndMissesKeepRequestOrder) {
+  ResponseCache cache("mnist", "mnist:1.0", 1 << 20, std::chrono::seconds(0));
+  auto request_batch = CreateRequestBatch({CreateRequest("req0", "b")});
+  InferenceResponseBatch response_batch;
+  response_batch.Reset(*request_batch);
+  auto misses = cache.Lookup(*request_batch, response_batch);
+  Handle(*request_batch, response_batch);
+  cache.Store(misses, response_batch);
+
+  // the hit is in the middle of the misses
+  request_batch = CreateRequestBatch({CreateRequest("req1", "a"),
+                                      CreateRequest("req2", "b"),
+                                      CreateRequest("req3", "c")});
+  response_batch.Reset(*request_batch);
+  misses = cache.Lookup(*request_batch, response_batch);
+  ASSERT_EQ(misses.size(), 2);
+  Handle(*request_batch, response_batch);
+  cache.Store(misses, response_batch);
+  ASSERT_EQ(response_batch.Size(), 3);
+  std::vector<std::pair<std::string, std::string>> expected = {
+      {"req1", "a out"}, {"req2", "b out"}, {"req3", "c out"}};
+  for (size_t i = 0; i < expected.size(); ++i) {
+    ASSERT_EQ(response_batch[i].request_id, expected[i].first);
+    ASSERT_EQ(Converter::VectorToStr(response_batch[i].msg),
+              expected[i].second);
+  }
+  ASSERT_EQ(cache.Size(), 3);
+}
+
+TEST(ResponseCacheTest, TestKey) {
+  ResponseCache cache("mnist", "mnist:1.0", 1 << 20, std::chrono::seconds(0));
+  auto request = CreateView(CreateRequest("req0", "a"));
+  auto key = cache.MakeKey(request->requests[0]);
+  ASSERT_TRUE(key.has_value());
+
+  // the request id and other headers do not count
+  auto same = CreateRequest("req1", "a");
+  same.headers["x-trace"] = "1";
+  ASSERT_EQ(cache.MakeKey(CreateView(same)->requests[0]), key);
+
+  auto other_type = CreateRequest("req0", "a");
+  other_type.headers[PayloadType::kHEADER_NAME_BODY_TYPE] =
+      PayloadType::kDATA_TYPE_STRING;
+  ASSERT_NE(cache.MakeKey(CreateView(other_type)->requests[0]), key);
+
+  ResponseCache other_model("mnist", "mnist:2.0", 1 << 20,
+                            std::chrono::seconds(0));
+  ASSERT_NE(other_model.MakeKey(request->requests[0]), key);
+
+  ASSERT_NE(cache.MakeKey(CreateView(CreateRequest("req0", "b"))->requests[0]),
+            key);
+  // a digest collision is told apart by the content types
+  auto colliding = cache.MakeKey(CreateView(other_type)->requests[0]);
+  colliding->digest = key->digest;
+  ASSERT_NE(colliding, key);
+
+  auto sequence = CreateRequest("req0", "a");
+  sequence.headers[PayloadType::kHEADER_NAME_SEQUENCE_ID] = "seq0";
+  ASSERT_FALSE(cache.MakeKey(CreateView(sequence)->requests[0]).has_value());
+}
+
+TEST(ResponseCacheTest, TestKeyWithoutPayload) {
+  ResponseCache cache("mnist", "mnist:1.0", 1 << 20, std::chrono::seconds(0));
+  std::string body(1 << 20, 'x');
+  auto request = CreateView(CreateRequest("req0", body));
+  auto key = cache.MakeKey(request->requests[0]);
+  ASSERT_TRUE(key.has_value());
+  ASSERT_LT(key->parts.size(), 128);
+
+  // a single byte anywhere in the payload counts
+  body[body.size() / 2] = 'y';
+  ASSERT_NE(cache.MakeKey(CreateView(CreateRequest("req0", body))->requests[0]),
+            key);
+}
+
+TEST(ResponseCacheTest, TestStoreOnlySuccess) {
+  ResponseCache cache("mnist", "mnist:1.0", 1 << 20, std::chrono::seconds(0));
+  auto request_batch = CreateRequestBatch(
+      {CreateRequest("req0", "a"), CreateRequest("req1", "b")});
+  InferenceResponseBatch response_batch;
+  response_batch.Reset(*request_batch);
+  auto misses = cache.Lookup(*request_batch, response_batch);
+  Handle(*request_batch, response_batch);
+  response_batch[0].code = 500;
+  response_batch[1].headers[PayloadType::kHEADER_NAME_STREAM_NEXT] = "false";
+  cache.Store(misses, response_batch);
+  ASSERT_EQ(cache.Size(), 0);
+}
+
+TEST(ResponseCacheTest, TestEvictLeastRecentlyUsed) {
+  // fits two of the responses below
+  ResponseCache cache("mnist", "mnist:1.0", 1000, std::chrono::seconds(0));
+  auto store = [&cache](const std::string& body) {
+    auto request_batch = CreateView(CreateRequest("req", body));
+    InferenceResponseBatch response_batch;
+    response_batch.Reset(*request_batch);
+    auto misses = cache.Lookup(*request_batch, response_batch);
+    Handle(*request_batch, response_batch);
+    cache.Store(misses, response_batch);
+  };
+  auto cached = [&cache](const std::string& body) {
+    auto request_batch = CreateView(CreateRequest("req", body));
+    InferenceResponseBatch response_batch;
+    response_batch.Reset(*request_batch);
+    cache.Lookup(*request_batch, response_batch);
+    return request_batch->requests.empty();
+  };
+  std::string body(200, 'x');
+  store(body + "0");
+  store(body + "1");
+  ASSERT_TRUE(cached(body + "0"));
+  store(body + "2");
+  ASSERT_EQ(cache.Size(), 2);
+  ASSERT_FALSE(cached(body + "1"));
+  ASSERT_TRUE(cached(body + "0"));
+  ASSERT_TRUE(cached(body + "2"));
+  ASSERT_LE(cache.Bytes(), 1000);
+}
+}  // namespace torchserve
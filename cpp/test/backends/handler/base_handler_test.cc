@@ -0,0 +1,169 @@
+#include "src/backends/handler/base_handler.hh"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <memory>
+#include <string>
+#include <vector>
+
+namespace torchserve {
+namespace {
+// Streams "a", "b" for every request and sends "c" as the final response.
+class StreamingHandler : public BaseHandler {
+ public:
+  std::pair<std::shared_ptr<void>, std::shared_ptr<torch::Device>> LoadModel(
+      std::shared_ptr<LoadModelRequest>& load_model_request) override {
+    return std::make_pair(nullptr, GetTorchDevice(load_model_request));
+  }
+
+  c10::IValue Preprocess(
+      std::shared_ptr<torch::Device>& device, BatchContext& batch_context,
+      std::shared_ptr<InferenceRequestViewBatch>& request_batch,
+      std::shared_ptr<InferenceResponseBatch>& response_batch) override {
+    for (auto& request : request_batch->requests) {
+      batch_context.Add(request.request_id,
+                        &(*response_batch)[request.index]);
+    }
+    return c10::IValue();
+  }
+
+  c10::IValue Inference(
+      std::shared_ptr<void> model, c10::IValue& inputs,
+      std::shared_ptr<torch::Device>& device, BatchContext& batch_context,
+      std::shared_ptr<InferenceResponseBatch>& response_batch) override {
+    for (const auto& piece : {"a", "b"}) {
+      auto intermediate_batch = std::make_shared<InferenceResponseBatch>();
+      for (const auto& slot : batch_context) {
+        intermediate_batch->Add(slot.request_id)
+            .SetResponse(200, "data_type", PayloadType::kDATA_TYPE_STRING,
+                         piece);
+      }
+      streamed_ = SendIntermediateResponse(intermediate_batch, response_batch);
+    }
+    return inputs;
+  }
+
+  void Postprocess(
+      c10::IValue& data, BatchContext& batch_context,
+      std::shared_ptr<InferenceResponseBatch>& response_batch) override {
+    for (auto& slot : batch_context) {
+      slot.response->SetResponse(200, "data_type",
+                                 PayloadType::kDATA_TYPE_STRING, "c");
+    }
+  }
+
+  bool streamed_ = false;
+};
+
+// req0 and req1 with the given headers
+std::shared_ptr<InferenceRequestViewBatch> CreateRequestBatch(
+    const std::vector<InferenceRequest::Headers>& headers = {{}, {}}) {
+  InferenceRequestBatch request_batch;
+  for (const auto& request_id : {"req0", "req1"}) {
+    InferenceRequest request;
+    request.request_id = request_id;
+    request.headers = headers[request_batch.size()];
+    request_batch.emplace_back(request);
+  }
+  return InferenceRequestViewBatch::FromRequests(request_batch);
+}
+
+// a response per request, as ModelInstance::Predict hands it to Handle
+std::shared_ptr<InferenceResponseBatch> CreateResponseBatch(
+    const InferenceRequestViewBatch& request_batch) {
+  auto response_batch = std::make_shared<InferenceResponseBatch>();
+  response_batch->Reset(request_batch);
+  return response_batch;
+}
+}  // namespace
+
+class BaseHandlerTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    auto manifest = std::make_shared<Manifest>();
+    handler_.Initialize("", manifest);
+  }
+
+  StreamingHandler handler_;
+  std::shared_ptr<torch::Device> device_ =
+      std::make_shared<torch::Device>(torch::kCPU);
+};
+
+TEST_F(BaseHandlerTest, TestSendIntermediateResponse) {
+  std::vector<std::pair<std::string, std::string>> sent;
+  IntermediateResponseSender sender =
+      [&sent](std::shared_ptr<InferenceResponseBatch>& batch) {
+        for (auto& response : *batch) {
+          EXPECT_EQ(response.headers[PayloadType::kHEADER_NAME_STREAM_NEXT],
+                    "true");
+          sent.emplace_back(response.request_id,
+                            Converter::VectorToStr(response.msg));
+        }
+        return true;
+      };
+
+  auto request_batch = CreateRequestBatch();
+  auto response_batch = CreateResponseBatch(*request_batch);
+  handler_.Handle(nullptr, device_, request_batch, response_batch, sender);
+
+  ASSERT_TRUE(handler_.streamed_);
+  std::vector<std::pair<std::string, std::string>> expected = {
+      {"req0", "a"}, {"req1", "a"}, {"req0", "b"}, {"req1", "b"}};
+  ASSERT_EQ(sent, expected);
+  ASSERT_EQ(response_batch->Size(), 2);
+  for (auto& response : *response_batch) {
+    ASSERT_EQ(Converter::VectorToStr(response.msg), "c");
+    ASSERT_EQ(response.headers[PayloadType::kHEADER_NAME_STREAM_NEXT],
+              "false");
+  }
+}
+
+TEST_F(BaseHandlerTest, TestSendIntermediateResponseWithoutSender) {
+  auto request_batch = CreateRequestBatch();
+  auto response_batch = CreateResponseBatch(*request_batch);
+  handler_.Handle(nullptr, device_, request_batch, response_batch);
+
+  ASSERT_FALSE(handler_.streamed_);
+  for (const auto& response : *response_batch) {
+    ASSERT_EQ(Converter::VectorToStr(response.msg), "c");
+    ASSERT_EQ(response.headers.count(PayloadType::kHEADER_NAME_STREAM_NEXT),
+              0);
+  }
+}
+
+TEST_F(BaseHandlerTest, TestDropExpiredRequests) {
+  auto now_ms = std::chrono::duration_cast<std::chrono::milliseconds>(
+                    std::chrono::system_clock::now().time_since_epoch())
+                    .count();
+  auto request_batch = CreateRequestBatch(
+      {{{PayloadType::kHEADER_NAME_DEADLINE, std::to_string(now_ms - 1000)}},
+       {{PayloadType::kHEADER_NAME_DEADLINE, std::to_string(now_ms + 60000)}}});
+  auto response_batch = CreateResponseBatch(*request_batch);
+  handler_.Handle(nullptr, device_, request_batch, response_batch);
+
+  // only the live request reaches the handler
+  ASSERT_EQ(request_batch->requests.size(), 1);
+  ASSERT_EQ(request_batch->requests.front().request_id, "req1");
+  ASSERT_EQ((*response_batch)[0].code, PayloadType::kCODE_DEADLINE_EXCEEDED);
+  ASSERT_EQ((*response_batch)[1].code, 200);
+  ASSERT_EQ(Converter::VectorToStr((*response_batch)[1].msg), "c");
+}
+
+TEST_F(BaseHandlerTest, TestDropRequestsByTimeoutSinceReceived) {
+  auto now = std::chrono::steady_clock::now();
+  auto request_batch =
+      CreateRequestBatch({{{PayloadType::kHEADER_NAME_TIMEOUT, "1000"}},
+                          {{PayloadType::kHEADER_NAME_TIMEOUT, "60000"}}});
+  // waited in the worker for longer than the client waits
+  request_batch->requests[0].received = now - std::chrono::seconds(2);
+  request_batch->requests[1].received = now;
+  auto response_batch = CreateResponseBatch(*request_batch);
+  handler_.Handle(nullptr, device_, request_batch, response_batch);
+
+  ASSERT_EQ(request_batch->requests.size(), 1);
+  ASSERT_EQ(request_batch->requests.front().request_id, "req1");
+  ASSERT_EQ((*response_batch)[0].code, PayloadType::kCODE_DEADLINE_EXCEEDED);
+  ASSERT_EQ((*response_batch)[1].code, 200);
+}
+}  // namespace torchserve
@@ -0,0 +1,46 @@
+#include "src/backends/handler/batch_context.hh"
+
+#include <gtest/gtest.h>
+
+#include <string>
+
+namespace torchserve {
+TEST(BatchContextTest, TestFailAndFinish) {
+  BatchContext batch_context;
+  InferenceResponseBatch response_batch;
+  // more requests than a uint8_t index could address
+  for (size_t i = 0; i < 300; ++i) {
+    response_batch.Add("req" + std::to_string(i));
+  }
+  for (size_t i = 0; i < 300; ++i) {
+    ASSERT_EQ(batch_context.Add(response_batch[i].request_id,
+                                &response_batch[i]),
+              i);
+  }
+  ASSERT_EQ(batch_context[299].request_id, "req299");
+
+  batch_context.Fail(1, "failed");
+  batch_context.Finish();
+  ASSERT_EQ(batch_context[0].status, BatchContext::Status::DONE);
+  ASSERT_EQ(batch_context[1].status, BatchContext::Status::FAILED);
+  ASSERT_EQ(batch_context[1].response->code, 500);
+  ASSERT_EQ(Converter::VectorToStr(batch_context[1].response->msg), "failed");
+
+  // done slots keep their response
+  batch_context.FailPending("failed batch");
+  ASSERT_EQ(batch_context[0].response->code, 200);
+}
+
+TEST(BatchContextTest, TestRequestIds) {
+  BatchContext batch_context;
+  ASSERT_EQ(batch_context.RequestIds(), "");
+  InferenceResponseBatch response_batch;
+  for (const auto& request_id : {"req0", "req1"}) {
+    response_batch.Add(request_id);
+  }
+  for (auto& response : response_batch) {
+    batch_context.Add(response.request_id, &response);
+  }
+  ASSERT_EQ(batch_context.RequestIds(), "req0,req1");
+}
+}  // namespace torchserve
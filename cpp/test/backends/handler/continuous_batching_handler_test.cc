@@ -0,0 +1,256 @@
+#include "src/backends/handler/continuous_batching_handler.hh"
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <utility>
+#include <vector>
+
+namespace torchserve {
+namespace {
+// The prompt is a number n, the sequence generates n-1, ..., 0 and finishes.
+class CountdownHandler : public ContinuousBatchingHandler {
+ public:
+  explicit CountdownHandler(bool continuous_batching) {
+    continuous_batching_ = continuous_batching;
+  }
+
+  std::pair<std::shared_ptr<void>, std::shared_ptr<torch::Device>> LoadModel(
+      std::shared_ptr<LoadModelRequest>& load_model_request) override {
+    return std::make_pair(nullptr, GetTorchDevice(load_model_request));
+  }
+
+  // Steps of different models run concurrently
+  std::mutex step_mutex_;
+  std::vector<size_t> step_sizes_;
+  // slows down each Step, so that other calls can join the generation
+  std::chrono::milliseconds step_delay_{0};
+  std::atomic<size_t> step_count_ = 0;
+  // turns of the sequences started so far, counting from 0
+  std::vector<int> turns_;
+
+ protected:
+  struct Countdown : public Sequence {
+    int remaining = 0;
+    int turn = 0;
+  };
+
+  std::shared_ptr<Sequence> StartSequence(
+      const std::string& prompt, std::shared_ptr<Sequence> previous) override {
+    auto sequence = std::make_shared<Countdown>();
+    sequence->remaining = std::stoi(prompt);
+    if (previous) {
+      sequence->turn = std::static_pointer_cast<Countdown>(previous)->turn + 1;
+    }
+    turns_.push_back(sequence->turn);
+    return sequence;
+  }
+
+  void Step(std::shared_ptr<void>& model,
+            std::vector<std::shared_ptr<Sequence>>& sequences) override {
+    {
+      std::lock_guard<std::mutex> lock(step_mutex_);
+      step_sizes_.push_back(sequences.size());
+    }
+    ++step_count_;
+    std::this_thread::sleep_for(step_delay_);
+    for (auto& sequence : sequences) {
+      auto countdown = std::static_pointer_cast<Countdown>(sequence);
+      countdown->piece = std::to_string(--countdown->remaining);
+      countdown->finished = countdown->remaining == 0;
+    }
+  }
+};
+
+// requests without a prompt continue their sequence
+std::shared_ptr<InferenceRequestViewBatch> CreateRequestBatch(
+    const std::vector<std::pair<std::string, std::string>>& prompts,
+    const std::map<std::string, std::string>& headers) {
+  InferenceRequestBatch request_batch;
+  for (const auto& [request_id, prompt] : prompts) {
+    InferenceRequest request;
+    request.request_id = request_id;
+    request.headers = headers;
+    if (!prompt.empty()) {
+      request.parameters[PayloadType::kPARAMETER_NAME_BODY] =
+          std::vector<char>(prompt.begin(), prompt.end());
+    }
+    request_batch.emplace_back(request);
+  }
+  return InferenceRequestViewBatch::FromRequests(request_batch);
+}
+}  // namespace
+
+class ContinuousBatchingHandlerTest : public ::testing::Test {
+ protected:
+  std::shared_ptr<InferenceResponseBatch> Handle(
+      CountdownHandler& handler,
+      const std::vector<std::pair<std::string, std::string>>& prompts,
+      const IntermediateResponseSender& sender = {},
+      const std::map<std::string, std::string>& headers = {}) {
+    auto manifest = std::make_shared<Manifest>();
+    handler.Initialize("", manifest);
+    auto request_batch = CreateRequestBatch(prompts, headers);
+    auto response_batch = std::make_shared<InferenceResponseBatch>();
+    response_batch->Reset(*request_batch);
+    handler.Handle(nullptr, device_, request_batch, response_batch, sender);
+    return response_batch;
+  }
+
+  static std::string StreamNext(const InferenceResponse& response) {
+    auto it = response.headers.find(PayloadType::kHEADER_NAME_STREAM_NEXT);
+    return it == response.headers.end() ? "" : it->second;
+  }
+
+  std::shared_ptr<torch::Device> device_ =
+      std::make_shared<torch::Device>(torch::kCPU);
+};
+
+TEST_F(ContinuousBatchingHandlerTest, TestIterationPerHandle) {
+  CountdownHandler handler(true);
+
+  auto responses = Handle(handler, {{"req0", "2"}});
+  ASSERT_EQ(Converter::VectorToStr(responses->Find("req0")->msg), "1");
+  ASSERT_EQ(StreamNext(*responses->Find("req0")), "true");
+
+  // req1 joins the decode set at the next token
+  responses = Handle(handler, {{"req0", ""}, {"req1", "1"}});
+  ASSERT_EQ(Converter::VectorToStr(responses->Find("req0")->msg), "0");
+  ASSERT_EQ(StreamNext(*responses->Find("req0")), "false");
+  ASSERT_EQ(Converter::VectorToStr(responses->Find("req1")->msg), "0");
+  ASSERT_EQ(StreamNext(*responses->Find("req1")), "false");
+  std::vector<size_t> expected_step_sizes = {1, 2};
+  ASSERT_EQ(handler.step_sizes_, expected_step_sizes);
+
+  // finished sequences left the decode set
+  responses = Handle(handler, {{"req0", ""}});
+  ASSERT_EQ(responses->Find("req0")->code, 500);
+  ASSERT_EQ(handler.step_sizes_, expected_step_sizes);
+}
+
+TEST_F(ContinuousBatchingHandlerTest, TestGenerateWholeBatch) {
+  CountdownHandler handler(false);
+  std::vector<std::pair<std::string, std::string>> sent;
+  IntermediateResponseSender sender =
+      [&sent](std::shared_ptr<InferenceResponseBatch>& batch) {
+        for (const auto& response : *batch) {
+          sent.emplace_back(response.request_id,
+                            Converter::VectorToStr(response.msg));
+        }
+        return true;
+      };
+
+  auto responses = Handle(handler, {{"req0", "1"}, {"req1", "3"}}, sender);
+
+  // req0 finished at the first step and left the decode set
+  std::vector<size_t> expected_step_sizes = {2, 1, 1};
+  ASSERT_EQ(handler.step_sizes_, expected_step_sizes);
+  std::vector<std::pair<std::string, std::string>> expected_sent = {
+      {"req1", "2"}, {"req1", "1"}};
+  ASSERT_EQ(sent, expected_sent);
+  ASSERT_EQ(Converter::VectorToStr(responses->Find("req0")->msg), "0");
+  ASSERT_EQ(StreamNext(*responses->Find("req0")), "");
+  ASSERT_EQ(Converter::VectorToStr(responses->Find("req1")->msg), "0");
+  ASSERT_EQ(StreamNext(*responses->Find("req1")), "false");
+}
+
+TEST_F(ContinuousBatchingHandlerTest, TestGenerateWithoutSender) {
+  CountdownHandler handler(false);
+
+  auto responses = Handle(handler, {{"req0", "3"}});
+  ASSERT_EQ(Converter::VectorToStr(responses->Find("req0")->msg), "210");
+  ASSERT_EQ(StreamNext(*responses->Find("req0")), "");
+}
+
+TEST_F(ContinuousBatchingHandlerTest, TestContinueSession) {
+  CountdownHandler handler(false);
+  std::map<std::string, std::string> headers = {
+      {PayloadType::kHEADER_NAME_SEQUENCE_ID, "seq0"}};
+
+  Handle(handler, {{"req0", "1"}}, {}, headers);
+  Handle(handler, {{"req1", "1"}}, {}, headers);
+  // the last request of the sequence drops its state
+  headers[PayloadType::kHEADER_NAME_SEQUENCE_END] = "true";
+  Handle(handler, {{"req2", "1"}}, {}, headers);
+  headers.erase(PayloadType::kHEADER_NAME_SEQUENCE_END);
+  Handle(handler, {{"req3", "1"}}, {}, headers);
+  Handle(handler, {{"req4", "1"}});
+
+  std::vector<int> expected_turns = {0, 1, 2, 0, 0};
+  ASSERT_EQ(handler.turns_, expected_turns);
+}
+
+TEST_F(ContinuousBatchingHandlerTest, TestConcurrentHandleJoinsGeneration) {
+  CountdownHandler handler(false);
+  handler.step_delay_ = std::chrono::milliseconds(1);
+  auto manifest = std::make_shared<Manifest>();
+  handler.Initialize("", manifest);
+  auto handle = [&](const std::string& request_id, const std::string& prompt) {
+    auto request_batch = CreateRequestBatch({{request_id, prompt}}, {});
+    auto response_batch = std::make_shared<InferenceResponseBatch>();
+    response_batch->Reset(*request_batch);
+    handler.Handle(nullptr, device_, request_batch, response_batch);
+    return response_batch;
+  };
+
+  // e.g. the batches of two connections
+  std::shared_ptr<InferenceResponseBatch> long_responses;
+  std::thread long_connection(
+      [&]() { long_responses = handle("req0", "1000"); });
+  while (handler.step_count_ == 0) {
+    std::this_thread::yield();
+  }
+  auto short_responses = handle("req1", "2");
+  long_connection.join();
+
+  // req1 joined the steps of req0 instead of waiting for it to finish
+  ASSERT_EQ(Converter::VectorToStr(short_responses->Find("req1")->msg), "10");
+  ASSERT_EQ(std::count(handler.step_sizes_.begin(), handler.step_sizes_.end(),
+                       2),
+            2);
+  ASSERT_EQ(handler.step_sizes_.size(), 1000);
+  auto text = Converter::VectorToStr(long_responses->Find("req0")->msg);
+  ASSERT_EQ(text.substr(0, 4), "9999");
+  ASSERT_EQ(text.substr(text.size() - 3), "210");
+}
+
+TEST_F(ContinuousBatchingHandlerTest, TestModelsDecodeSeparately) {
+  CountdownHandler handler(false);
+  handler.step_delay_ = std::chrono::milliseconds(1);
+  auto manifest = std::make_shared<Manifest>();
+  handler.Initialize("", manifest);
+  // e.g. the models of two ModelInstances sharing the handler
+  std::vector<std::shared_ptr<void>> models = {std::make_shared<int>(0),
+                                               std::make_shared<int>(1)};
+  std::vector<std::shared_ptr<InferenceResponseBatch>> responses(2);
+  std::vector<std::thread> instances;
+  for (size_t i = 0; i < models.size(); ++i) {
+    instances.emplace_back([&, i]() {
+      auto request_id = "req" + std::to_string(i);
+      auto request_batch = CreateRequestBatch({{request_id, "100"}}, {});
+      responses[i] = std::make_shared<InferenceResponseBatch>();
+      responses[i]->Reset(*request_batch);
+      handler.Handle(models[i], device_, request_batch, responses[i]);
+    });
+  }
+  for (auto& instance : instances) {
+    instance.join();
+  }
+
+  // neither joined the Steps of the other model
+  ASSERT_EQ(handler.step_sizes_.size(), 200);
+  ASSERT_EQ(std::count(handler.step_sizes_.begin(), handler.step_sizes_.end(),
+                       1),
+            200);
+  for (const auto& response_batch : responses) {
+    auto text = Converter::VectorToStr((*response_batch)[0].msg);
+    ASSERT_EQ(text.substr(text.size() - 3), "210");
+  }
+}
+}  // namespace torchserve
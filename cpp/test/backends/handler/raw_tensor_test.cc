@@ -0,0 +1,97 @@
+#include "src/backends/handler/raw_tensor.hh"
+
+#include <gtest/gtest.h>
+#include <torch/torch.h>
+
+#include <stdexcept>
+#include <string_view>
+#include <vector>
+
+namespace torchserve {
+namespace {
+std::string_view View(const std::vector<char>& payload) {
+  return std::string_view(payload.data(), payload.size());
+}
+}  // namespace
+
+TEST(RawTensorTest, TestEncodeDecode) {
+  auto tensor = torch::rand({2, 3, 4});
+  auto payload = RawTensor::Encode(tensor);
+
+  ASSERT_TRUE(RawTensor::IsRawTensor(View(payload)));
+  ASSERT_EQ(payload.size(),
+            RawTensor::kFixedHeaderSize + 6 * sizeof(int64_t) +
+                tensor.nbytes());
+  auto decoded = RawTensor::Decode(View(payload));
+  ASSERT_EQ(decoded.scalar_type(), torch::kFloat);
+  ASSERT_TRUE(torch::equal(decoded, tensor));
+}
+
+TEST(RawTensorTest, TestEncodeIntoBuffer) {
+  auto tensor = torch::rand({2, 3});
+  std::vector<char> payload(4096, 'x');
+  const auto* data = payload.data();
+  RawTensor::Encode(tensor, payload);
+
+  // the buffer is reused and only holds the encoded tensor
+  ASSERT_EQ(payload.data(), data);
+  ASSERT_EQ(payload, RawTensor::Encode(tensor));
+  ASSERT_TRUE(torch::equal(RawTensor::Decode(View(payload)), tensor));
+}
+
+TEST(RawTensorTest, TestEncodeNonContiguous) {
+  auto tensor = torch::arange(12, torch::kLong).reshape({3, 4}).t();
+  auto payload = RawTensor::Encode(tensor);
+
+  auto decoded = RawTensor::Decode(View(payload));
+  ASSERT_EQ(decoded.scalar_type(), torch::kLong);
+  ASSERT_TRUE(torch::equal(decoded, tensor));
+}
+
+TEST(RawTensorTest, TestDecodeWithoutCopy) {
+  auto payload = RawTensor::Encode(torch::zeros({4}, torch::kInt));
+  auto decoded = RawTensor::Decode(View(payload));
+
+  ASSERT_EQ(static_cast<char*>(decoded.data_ptr()),
+            payload.data() + RawTensor::kFixedHeaderSize +
+                2 * sizeof(int64_t));
+}
+
+TEST(RawTensorTest, TestDecodeStrided) {
+  // 2x2 view over the first column pair of a 2x3 buffer
+  auto payload = RawTensor::Encode(torch::arange(6, torch::kInt));
+  size_t dims_offset = RawTensor::kFixedHeaderSize;
+  std::vector<char> strided(payload.begin(), payload.begin() + dims_offset);
+  strided[6] = 2;
+  auto append_int64 = [&strided](int64_t value) {
+    for (size_t i = 0; i < sizeof(value); ++i) {
+      strided.push_back(static_cast<char>((value >> (8 * i)) & 0xff));
+    }
+  };
+  append_int64(2);
+  append_int64(2);
+  append_int64(3);
+  append_int64(1);
+  strided.insert(strided.end(), payload.begin() + dims_offset + 16,
+                 payload.end());
+
+  auto decoded = RawTensor::Decode(View(strided));
+  auto expected = torch::arange(6, torch::kInt).reshape({2, 3}).slice(1, 0, 2);
+  ASSERT_TRUE(torch::equal(decoded, expected));
+}
+
+TEST(RawTensorTest, TestDecodeMalformed) {
+  auto payload = RawTensor::Encode(torch::ones({8}));
+  std::vector<char> pickled = torch::pickle_save(torch::ones({8}));
+  ASSERT_FALSE(RawTensor::IsRawTensor(View(pickled)));
+  ASSERT_THROW(RawTensor::Decode(View(pickled)), std::runtime_error);
+
+  auto truncated = payload;
+  truncated.resize(truncated.size() - 1);
+  ASSERT_THROW(RawTensor::Decode(View(truncated)), std::runtime_error);
+
+  auto bad_dtype = payload;
+  bad_dtype[5] = 42;
+  ASSERT_THROW(RawTensor::Decode(View(bad_dtype)), std::runtime_error);
+}
+}  // namespace torchserve
@@ -0,0 +1,56 @@
+#include "src/backends/handler/session_store.hh"
+
+#include <gtest/gtest.h>
+
+#include <memory>
+
+namespace torchserve {
+namespace {
+struct FixedState : public SessionStore::State {
+  explicit FixedState(size_t bytes) : bytes(bytes) {}
+  size_t Bytes() const override { return bytes; }
+  size_t bytes;
+};
+}  // namespace
+
+TEST(SessionStoreTest, TestEvictLeastRecentlyUsed) {
+  SessionStore store(100);
+  store.Put("seq0", std::make_shared<FixedState>(40));
+  store.Put("seq1", std::make_shared<FixedState>(40));
+  ASSERT_NE(store.Get("seq0"), nullptr);
+
+  // seq1 was used least recently
+  store.Put("seq2", std::make_shared<FixedState>(40));
+  ASSERT_EQ(store.Get("seq1"), nullptr);
+  ASSERT_NE(store.Get("seq0"), nullptr);
+  ASSERT_NE(store.Get("seq2"), nullptr);
+  ASSERT_EQ(store.Size(), 2);
+  ASSERT_EQ(store.Bytes(), 80);
+}
+
+TEST(SessionStoreTest, TestReplaceAndErase) {
+  SessionStore store(100);
+  auto state = std::make_shared<FixedState>(30);
+  store.Put("seq0", std::make_shared<FixedState>(60));
+  store.Put("seq0", state);
+  ASSERT_EQ(store.Get("seq0"), state);
+  ASSERT_EQ(store.Bytes(), 30);
+
+  store.Erase("seq0");
+  ASSERT_EQ(store.Get("seq0"), nullptr);
+  ASSERT_EQ(store.Bytes(), 0);
+}
+
+TEST(SessionStoreTest, TestCapacity) {
+  SessionStore store(100);
+  store.Put("seq0", std::make_shared<FixedState>(101));
+  ASSERT_EQ(store.Get("seq0"), nullptr);
+
+  store.Put("seq1", std::make_shared<FixedState>(50));
+  store.Put("seq2", std::make_shared<FixedState>(50));
+  store.SetCapacityBytes(60);
+  ASSERT_EQ(store.Get("seq1"), nullptr);
+  ASSERT_NE(store.Get("seq2"), nullptr);
+  ASSERT_EQ(store.Bytes(), 50);
+}
+}  // namespace torchserve
@@ -133,7 +133,7 @@ TEST(BackendIntegTest, TestOTFProtocolAndHandler) {
         input.close();
       }));
 
-  EXPECT_CALL(*client_socket, SendAll(testing::_, testing::_)).Times(1);
+  EXPECT_CALL(*client_socket, SendAllV(testing::_)).Times(1);
   auto batch_inference_request =
       OTFMessage::RetrieveInferenceMsg(*client_socket);
   auto inference_request = batch_inference_request->at(0);
@@ -146,10 +146,13 @@ TEST(BackendIntegTest, TestOTFProtocolAndHandler) {
   ASSERT_EQ(inference_request.parameters["body"].size(), 3883);
 
   // call handler to run inference
-  auto inference_response_batch =
-      backend->GetModelInstance()->Predict(batch_inference_request);
+  auto request_batch =
+      InferenceRequestViewBatch::FromRequests(*batch_inference_request);
+  std::shared_ptr<InferenceResponseBatch> inference_response_batch;
+  backend->GetModelInstance()->Predict(request_batch,
+                                       inference_response_batch);
   auto prediction =
-      torch::pickle_load((*inference_response_batch)["reqi"]->msg).toTensor();
+      torch::pickle_load((*inference_response_batch)[0].msg).toTensor();
   std::vector<float> expected_result = {0.0000,   -28.5285, -22.8017, -32.5117,
                                         -33.5584, -29.8429, -25.7716, -25.9097,
                                         -27.6592, -24.5729};
@@ -159,8 +162,9 @@ TEST(BackendIntegTest, TestOTFProtocolAndHandler) {
                        {static_cast<long long>(expected_result.size())},
                        tensor_options)
           .clone();
-  ASSERT_EQ(inference_response_batch->size(), 1);
-  ASSERT_EQ((*inference_response_batch)["reqi"]->code, 200);
+  ASSERT_EQ(inference_response_batch->Size(), 1);
+  ASSERT_EQ((*inference_response_batch)[0].request_id, "reqi");
+  ASSERT_EQ((*inference_response_batch)[0].code, 200);
   ASSERT_EQ(torch::allclose(prediction, expected_tensor), true);
 
   // send inference response to socket
@@ -0,0 +1,212 @@
+#include "src/backends/protocol/buffered_socket.hh"
+
+#include <gtest/gtest.h>
+#include <limits.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+#include "src/backends/protocol/otf_message.hh"
+#ifdef TS_IO_URING_SUPPORTED
+#include "src/backends/protocol/io_uring_socket.hh"
+#endif
+
+namespace torchserve {
+namespace {
+void AppendInt(std::vector<char>& frame, int32_t value) {
+  int32_t network_value = htonl(value);
+  const char* bytes = reinterpret_cast<const char*>(&network_value);
+  frame.insert(frame.end(), bytes, bytes + sizeof(network_value));
+}
+
+void AppendString(std::vector<char>& frame, const std::string& value) {
+  AppendInt(frame, value.size());
+  frame.insert(frame.end(), value.begin(), value.end());
+}
+
+std::vector<char> BuildInferenceFrame(const std::string& payload) {
+  std::vector<char> frame{};
+  frame.push_back(PREDICT_MSG);
+  for (const auto& request_id : {"req0", "req1"}) {
+    AppendString(frame, request_id);
+    // headers
+    AppendString(frame, "heak");
+    AppendString(frame, "heav");
+    AppendInt(frame, -1);
+    // parameters
+    AppendString(frame, "body");
+    AppendString(frame, "cont");
+    AppendString(frame, payload);
+    AppendInt(frame, -1);
+  }
+  // end of batch
+  AppendInt(frame, -1);
+  return frame;
+}
+}  // namespace
+
+// <buffer size, use io_uring>
+class BufferedSocketTest
+    : public ::testing::TestWithParam<std::tuple<size_t, bool>> {
+ protected:
+  void SetUp() override {
+#ifdef TS_IO_URING_SUPPORTED
+    if (std::get<1>(GetParam()) && !IoUringSocket::IsSupported()) {
+      GTEST_SKIP() << "io_uring is not supported by this kernel";
+    }
+#endif
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds_), 0);
+  }
+
+  std::unique_ptr<BufferedSocket> CreateSocket() {
+    auto [buffer_size, use_io_uring] = GetParam();
+#ifdef TS_IO_URING_SUPPORTED
+    if (use_io_uring) {
+      return std::make_unique<IoUringSocket>(fds_[0], buffer_size);
+    }
+#endif
+    return std::make_unique<BufferedSocket>(fds_[0], buffer_size);
+  }
+  void TearDown() override {
+    if (fds_[1] >= 0) {
+      close(fds_[1]);
+    }
+  }
+
+  int fds_[2] = {-1, -1};
+};
+
+TEST_P(BufferedSocketTest, TestRetrieveInferenceMsg) {
+  std::string payload(3000, 'x');
+  auto frame = BuildInferenceFrame(payload);
+  ASSERT_EQ(write(fds_[1], frame.data(), frame.size()),
+            static_cast<ssize_t>(frame.size()));
+
+  auto client_socket = CreateSocket();
+  ASSERT_EQ(OTFMessage::RetrieveCmd(*client_socket), PREDICT_MSG);
+  auto batch = OTFMessage::RetrieveInferenceMsg(*client_socket);
+
+  ASSERT_EQ(batch->size(), 2);
+  ASSERT_EQ(batch->at(0).request_id, "req0");
+  ASSERT_EQ(batch->at(1).request_id, "req1");
+  for (auto& request : *batch) {
+    ASSERT_EQ(request.headers["heak"], "heav");
+    ASSERT_EQ(request.headers["body:contentType"], "cont");
+    ASSERT_EQ(Converter::VectorToStr(request.parameters["body"]), payload);
+  }
+}
+
+TEST_P(BufferedSocketTest, TestCaptureFrame) {
+  auto frame = BuildInferenceFrame(std::string(3000, 'x'));
+  std::vector<char> frames = frame;
+  frames.insert(frames.end(), frame.begin(), frame.end());
+  ASSERT_EQ(write(fds_[1], frames.data(), frames.size()),
+            static_cast<ssize_t>(frames.size()));
+
+  auto client_socket = CreateSocket();
+  client_socket->SetCaptureEnabled(true);
+  for (int i = 0; i < 2; ++i) {
+    OTFMessage::RetrieveCmd(*client_socket);
+    OTFMessage::RetrieveInferenceMsg(*client_socket);
+    ASSERT_EQ(client_socket->TakeCapturedFrame(), frame);
+  }
+  ASSERT_TRUE(client_socket->TakeCapturedFrame().empty());
+}
+
+TEST_P(BufferedSocketTest, TestRetrieveIntAndBool) {
+  std::vector<char> frame{};
+  AppendInt(frame, 42);
+  frame.push_back(1);
+  AppendInt(frame, -1);
+  ASSERT_EQ(write(fds_[1], frame.data(), frame.size()),
+            static_cast<ssize_t>(frame.size()));
+
+  auto client_socket = CreateSocket();
+  ASSERT_EQ(client_socket->RetrieveInt(), 42);
+  ASSERT_TRUE(client_socket->RetrieveBool());
+  ASSERT_EQ(client_socket->RetrieveInt(), -1);
+}
+
+TEST_P(BufferedSocketTest, TestSendAllV) {
+  // larger than the socket buffer so that sendmsg returns partial writes
+  std::string large(4 * 1024 * 1024, 'l');
+  std::string small = "small";
+  std::vector<iovec> buffers = {{large.data(), large.size()},
+                                {small.data(), small.size()},
+                                {large.data(), large.size()}};
+  size_t total_size = 2 * large.size() + small.size();
+
+  auto client_socket = CreateSocket();
+  std::vector<char> received(total_size);
+  std::thread reader([&]() {
+    // the peer socket takes ownership of fds_[1]
+    Socket peer_socket(fds_[1]);
+    peer_socket.RetrieveBuffer(received.size(), received.data());
+  });
+  ASSERT_TRUE(client_socket->SendAllV(buffers));
+  reader.join();
+  fds_[1] = -1;
+
+  ASSERT_EQ(std::string(received.begin(), received.begin() + large.size()),
+            large);
+  ASSERT_EQ(std::string(received.begin() + large.size(),
+                        received.begin() + large.size() + small.size()),
+            small);
+  ASSERT_EQ(std::string(received.end() - large.size(), received.end()), large);
+}
+
+TEST_P(BufferedSocketTest, TestSendAllVManyBuffers) {
+  // more buffers than fit into one message, so several messages are sent
+  std::string data(3 * IOV_MAX + 1, ' ');
+  for (size_t i = 0; i < data.size(); ++i) {
+    data[i] = static_cast<char>('a' + i % 26);
+  }
+  std::vector<iovec> buffers;
+  for (auto& byte : data) {
+    buffers.push_back({&byte, 1});
+  }
+
+  auto client_socket = CreateSocket();
+  std::vector<char> received(data.size());
+  std::thread reader([&]() {
+    Socket peer_socket(fds_[1]);
+    peer_socket.RetrieveBuffer(received.size(), received.data());
+  });
+  ASSERT_TRUE(client_socket->SendAllV(buffers));
+  reader.join();
+  fds_[1] = -1;
+
+  ASSERT_EQ(std::string(received.begin(), received.end()), data);
+}
+
+TEST_P(BufferedSocketTest, TestDisconnect) {
+  std::vector<char> frame{};
+  AppendInt(frame, 42);
+  ASSERT_EQ(write(fds_[1], frame.data(), frame.size()),
+            static_cast<ssize_t>(frame.size()));
+  close(fds_[1]);
+  fds_[1] = -1;
+
+  auto client_socket = CreateSocket();
+  ASSERT_EQ(client_socket->RetrieveInt(), 42);
+  ASSERT_THROW(client_socket->RetrieveInt(), SocketError);
+}
+
+// buffer sizes smaller than a field, smaller than the payload and larger than
+// the whole frame
+INSTANTIATE_TEST_SUITE_P(
+    BufferSizes, BufferedSocketTest,
+    ::testing::Combine(::testing::Values(1, 3, 1024,
+                                         BufferedSocket::kDefaultBufferSize),
+#ifdef TS_IO_URING_SUPPORTED
+                       ::testing::Bool()));
+#else
+                       ::testing::Values(false)));
+#endif
+}  // namespace torchserve
@@ -0,0 +1,91 @@
+#include "src/backends/protocol/capture.hh"
+
+#include <gtest/gtest.h>
+
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+namespace torchserve {
+class CaptureTest : public ::testing::Test {
+ protected:
+  void TearDown() override { std::filesystem::remove(path_); }
+
+  std::string path_ =
+      (std::filesystem::temp_directory_path() / "ts_capture_test.bin")
+          .string();
+};
+
+TEST_F(CaptureTest, TestWriteRead) {
+  auto before = std::chrono::steady_clock::now();
+  {
+    CaptureWriter writer(path_);
+    ASSERT_EQ(writer.NextConnectionId(), 0);
+    ASSERT_EQ(writer.NextConnectionId(), 1);
+    auto now = std::chrono::steady_clock::now();
+    writer.Write(0, now, {'L', 'a'});
+    writer.Write(1, now + std::chrono::seconds(5), {'I', 'b', 'c'});
+    writer.Write(0, now + std::chrono::hours(2), {});
+  }
+
+  CaptureReader reader(path_);
+  auto first = reader.Next();
+  ASSERT_TRUE(first.has_value());
+  ASSERT_EQ(first->connection_id, 0);
+  ASSERT_EQ(first->frame, std::vector<char>({'L', 'a'}));
+  auto elapsed = std::chrono::steady_clock::now() - before;
+  ASSERT_LE(first->timestamp_ns,
+            std::chrono::duration_cast<std::chrono::nanoseconds>(elapsed)
+                .count());
+
+  auto second = reader.Next();
+  ASSERT_TRUE(second.has_value());
+  ASSERT_EQ(second->connection_id, 1);
+  ASSERT_EQ(second->frame, std::vector<char>({'I', 'b', 'c'}));
+  ASSERT_EQ(second->timestamp_ns - first->timestamp_ns, 5000000000ULL);
+
+  // needs more than 32 bits of nanoseconds
+  auto third = reader.Next();
+  ASSERT_TRUE(third.has_value());
+  ASSERT_TRUE(third->frame.empty());
+  ASSERT_EQ(third->timestamp_ns - first->timestamp_ns, 7200000000000ULL);
+
+  ASSERT_FALSE(reader.Next().has_value());
+}
+
+TEST_F(CaptureTest, TestReadConnection) {
+  {
+    CaptureWriter writer(path_);
+    auto now = std::chrono::steady_clock::now();
+    writer.Write(1, now, {'L', 'a'});
+    writer.Write(0, now, {'I', 'b'});
+    writer.Write(1, now, {'I', 'c'});
+  }
+  ASSERT_EQ(CaptureReader::ReadConnectionIds(path_),
+            std::vector<uint32_t>({1, 0}));
+
+  CaptureReader reader(path_, 1);
+  ASSERT_EQ(reader.Next()->frame, std::vector<char>({'L', 'a'}));
+  ASSERT_EQ(reader.Next()->frame, std::vector<char>({'I', 'c'}));
+  ASSERT_FALSE(reader.Next().has_value());
+}
+
+TEST_F(CaptureTest, TestReadTruncated) {
+  {
+    CaptureWriter writer(path_);
+    writer.Write(0, std::chrono::steady_clock::now(), {'L', 'a'});
+  }
+  std::filesystem::resize_file(path_, std::filesystem::file_size(path_) - 1);
+
+  CaptureReader reader(path_);
+  ASSERT_FALSE(reader.Next().has_value());
+}
+
+TEST_F(CaptureTest, TestReadNotCapture) {
+  std::ofstream(path_) << "not a capture";
+  ASSERT_THROW(CaptureReader reader(path_), std::runtime_error);
+}
+}  // namespace torchserve
@@ -6,6 +6,7 @@ namespace torchserve {
 class MockSocket : public ISocket {
  public:
   MOCK_METHOD(bool, SendAll, (size_t, char*), (const, override));
+  MOCK_METHOD(bool, SendAllV, (std::vector<iovec>&), (const, override));
   MOCK_METHOD(int, RetrieveInt, (), (const, override));
   MOCK_METHOD(bool, RetrieveBool, (), (const, override));
   MOCK_METHOD(void, RetrieveBuffer, (size_t, char*), (const, override));
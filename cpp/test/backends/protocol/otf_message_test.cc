@@ -4,6 +4,8 @@
 
 #include <cstring>
 
+#include "src/backends/protocol/memory_socket.hh"
+
 namespace torchserve {
 TEST(OTFMessageTest, TestRetieveCmd) {
   auto client_socket = std::make_shared<MockSocket>();
@@ -129,11 +131,9 @@ TEST(OTFMessageTest, TestRetrieveMsgLoadNoGpu) {
 
 TEST(OTFMessageTest, TestEncodeSuccessInferenceResponse) {
   std::string request_id = "d22dd8d8-0abf";
-  auto inference_response = std::make_shared<InferenceResponse>(request_id);
-  inference_response->SetResponse(200, "data_type", "string", "sample_message");
   auto inference_response_batch = std::make_shared<InferenceResponseBatch>();
-
-  (*inference_response_batch)[request_id] = inference_response;
+  inference_response_batch->Add(request_id)
+      .SetResponse(200, "data_type", "string", "sample_message");
   std::vector<char> data_buffer{};
   OTFMessage::EncodeInferenceResponse(inference_response_batch, data_buffer);
   const char* expectedResponse =
@@ -148,12 +148,9 @@ TEST(OTFMessageTest, TestEncodeSuccessInferenceResponse) {
 
 TEST(OTFMessageTest, TestEncodeFailureInferenceResponse) {
   std::string request_id = "d22dd8d8-0abf";
-  auto inference_response = std::make_shared<InferenceResponse>(request_id);
-  inference_response->SetResponse(500, "data_type", "string",
-                                  "response_failure_message");
   auto inference_response_batch = std::make_shared<InferenceResponseBatch>();
-
-  (*inference_response_batch)[request_id] = inference_response;
+  inference_response_batch->Add(request_id)
+      .SetResponse(500, "data_type", "string", "response_failure_message");
   std::vector<char> data_buffer{};
   OTFMessage::EncodeInferenceResponse(inference_response_batch, data_buffer);
   TS_LOG(ERROR, "result_size: {}", data_buffer.size());
@@ -167,6 +164,49 @@ TEST(OTFMessageTest, TestEncodeFailureInferenceResponse) {
                                data_buffer.size()));
 }
 
+TEST(OTFMessageTest, TestEncodeInferenceResponseIovec) {
+  auto inference_response_batch = std::make_shared<InferenceResponseBatch>();
+  for (const auto& request_id : {"req0", "req1"}) {
+    inference_response_batch->Add(request_id)
+        .SetResponse(200, "data_type", "string",
+                     std::string(1024, request_id[3]));
+  }
+
+  std::vector<char> framing_buffer{};
+  std::vector<iovec> iovecs{};
+  OTFMessage::EncodeInferenceResponse(inference_response_batch, framing_buffer,
+                                      iovecs);
+  // framing, msg, framing, msg, framing
+  ASSERT_EQ(iovecs.size(), 5);
+  ASSERT_EQ(iovecs[1].iov_base, (*inference_response_batch)[0].msg.data());
+  ASSERT_EQ(iovecs[1].iov_len, 1024);
+  ASSERT_EQ(iovecs[3].iov_base, (*inference_response_batch)[1].msg.data());
+  ASSERT_EQ(iovecs[3].iov_len, 1024);
+
+  std::vector<char> gathered{};
+  for (const auto& iov : iovecs) {
+    auto* base = static_cast<const char*>(iov.iov_base);
+    gathered.insert(gathered.end(), base, base + iov.iov_len);
+  }
+  std::vector<char> data_buffer{};
+  OTFMessage::EncodeInferenceResponse(inference_response_batch, data_buffer);
+  ASSERT_EQ(gathered, data_buffer);
+
+  auto client_socket = std::make_shared<MockSocket>();
+  EXPECT_CALL(*client_socket, SendAllV(testing::_))
+      .Times(1)
+      .WillOnce(testing::Invoke([&](std::vector<iovec>& buffers) {
+        size_t total_size = 0;
+        for (const auto& iov : buffers) {
+          total_size += iov.iov_len;
+        }
+        EXPECT_EQ(total_size, data_buffer.size());
+        return true;
+      }));
+  ASSERT_TRUE(OTFMessage::SendInferenceResponse(*client_socket,
+                                                inference_response_batch));
+}
+
 TEST(OTFMessageTest, TestRetrieveInferenceMsg) {
   auto client_socket = std::make_shared<MockSocket>();
   EXPECT_CALL(*client_socket, RetrieveInt())
@@ -230,4 +270,190 @@ TEST(OTFMessageTest, TestRetrieveInferenceMsg) {
       torchserve::Converter::VectorToStr(inference_request.parameters["parn"]),
       "valu");
 }
+
+TEST(OTFMessageTest, TestRetrieveInferenceMsgView) {
+  auto client_socket = std::make_shared<MockSocket>();
+  EXPECT_CALL(*client_socket, RetrieveInt())
+      .Times(9)
+      // request_id length
+      .WillOnce(::testing::Return(4))
+      // header_key length
+      .WillOnce(::testing::Return(4))
+      // header_value length
+      .WillOnce(::testing::Return(4))
+      // end of headers
+      .WillOnce(::testing::Return(-1))
+      // parameter_name length
+      .WillOnce(::testing::Return(4))
+      // content_type length
+      .WillOnce(::testing::Return(4))
+      // value length
+      .WillOnce(::testing::Return(4))
+      // end of parameters
+      .WillOnce(::testing::Return(-1))
+      // end of request
+      .WillOnce(::testing::Return(-1));
+
+  EXPECT_CALL(*client_socket, RetrieveBuffer(testing::_, testing::_))
+      .Times(6)
+      .WillOnce(testing::Invoke([=](size_t length, char* data) {
+        ASSERT_EQ(length, 4);
+        strncpy(data, "reqi", length);
+      }))
+      .WillOnce(testing::Invoke([=](size_t length, char* data) {
+        ASSERT_EQ(length, 4);
+        strncpy(data, "heak", length);
+      }))
+      .WillOnce(testing::Invoke([=](size_t length, char* data) {
+        ASSERT_EQ(length, 4);
+        strncpy(data, "heav", length);
+      }))
+      .WillOnce(testing::Invoke([=](size_t length, char* data) {
+        ASSERT_EQ(length, 4);
+        strncpy(data, "parn", length);
+      }))
+      .WillOnce(testing::Invoke([=](size_t length, char* data) {
+        ASSERT_EQ(length, 4);
+        strncpy(data, "cont", length);
+      }))
+      .WillOnce(testing::Invoke([=](size_t length, char* data) {
+        ASSERT_EQ(length, 4);
+        strncpy(data, "valu", length);
+      }));
+  auto view_batch = OTFMessage::RetrieveInferenceMsgView(*client_socket);
+  ASSERT_EQ(view_batch->requests.size(), 1);
+  auto& request_view = view_batch->requests.at(0);
+  ASSERT_EQ(request_view.headers.size(), 3);
+  ASSERT_EQ(request_view.parameters.size(), 1);
+  ASSERT_EQ(request_view.request_id, "reqi");
+  ASSERT_EQ(request_view.GetHeader("heak"), "heav");
+  ASSERT_EQ(request_view.GetHeader("body_dtype"), "bytes");
+  ASSERT_EQ(request_view.GetHeader("parn:contentType"), "cont");
+  ASSERT_EQ(request_view.GetParameter("parn"), "valu");
+  ASSERT_FALSE(request_view.GetParameter("heak").has_value());
+
+  // the fields were read into one block of the batch arena
+  ASSERT_EQ(view_batch->arena.Bytes(), Arena::kBlockSize);
+}
+
+TEST(OTFMessageTest, TestRetrieveInferenceMsgViewNegativeLength) {
+  auto client_socket = std::make_shared<MockSocket>();
+  EXPECT_CALL(*client_socket, RetrieveInt())
+      .Times(3)
+      // request_id length
+      .WillOnce(::testing::Return(4))
+      // header_key length
+      .WillOnce(::testing::Return(4))
+      // header_value length
+      .WillOnce(::testing::Return(-2));
+  EXPECT_CALL(*client_socket, RetrieveBuffer(testing::_, testing::_))
+      .Times(2);
+  ASSERT_THROW(OTFMessage::RetrieveInferenceMsgView(*client_socket),
+               SocketError);
+}
+
+TEST(OTFMessageTest, TestEncodeLoadModelRequest) {
+  LoadModelRequest expected("model_path", "测试", 1, "handler", "envelope", 4,
+                            true);
+  std::vector<char> data_buffer{};
+  OTFMessage::EncodeLoadModelRequest(expected, data_buffer);
+
+  MemorySocket client_socket(data_buffer);
+  ASSERT_EQ(OTFMessage::RetrieveCmd(client_socket), LOAD_MSG);
+  auto load_model_request = OTFMessage::RetrieveLoadMsg(client_socket);
+  ASSERT_TRUE(*load_model_request == expected);
+  ASSERT_EQ(load_model_request->envelope, "envelope");
+  ASSERT_TRUE(client_socket.AtEnd());
+}
+
+TEST(OTFMessageTest, TestEncodeInferenceRequest) {
+  InferenceRequestBatch expected;
+  for (const auto& request_id : {"req0", "req1"}) {
+    InferenceRequest request;
+    request.request_id = request_id;
+    request.headers["heak"] = "heav";
+    request.headers[PayloadType::kHEADER_NAME_BODY_TYPE] =
+        PayloadType::kDATA_TYPE_BYTES;
+    request.headers["body:contentType"] = "application/json";
+    request.parameters["body"] = Converter::StrToVector("{}");
+    request.headers["extra:contentType"] = "";
+    request.parameters["extra"] = Converter::StrToVector(request_id);
+    expected.push_back(request);
+  }
+  std::vector<char> data_buffer{};
+  OTFMessage::EncodeInferenceRequest(expected, data_buffer);
+
+  MemorySocket client_socket(data_buffer);
+  ASSERT_EQ(OTFMessage::RetrieveCmd(client_socket), PREDICT_MSG);
+  auto batch = OTFMessage::RetrieveInferenceMsg(client_socket);
+  ASSERT_EQ(batch->size(), expected.size());
+  for (size_t i = 0; i < expected.size(); ++i) {
+    ASSERT_EQ(batch->at(i).request_id, expected[i].request_id);
+    ASSERT_EQ(batch->at(i).headers, expected[i].headers);
+    ASSERT_EQ(batch->at(i).parameters, expected[i].parameters);
+  }
+  ASSERT_TRUE(client_socket.AtEnd());
+}
+
+TEST(OTFMessageTest, TestRetrieveInferenceMsgViewIndex) {
+  InferenceRequestBatch expected(3);
+  for (size_t i = 0; i < expected.size(); ++i) {
+    expected[i].request_id = "req" + std::to_string(i);
+  }
+  std::vector<char> data_buffer{};
+  OTFMessage::EncodeInferenceRequest(expected, data_buffer);
+
+  MemorySocket client_socket(data_buffer);
+  ASSERT_EQ(OTFMessage::RetrieveCmd(client_socket), PREDICT_MSG);
+  auto view_batch = OTFMessage::RetrieveInferenceMsgView(client_socket);
+  ASSERT_EQ(view_batch->requests.size(), expected.size());
+  // where the responses of the requests go
+  for (size_t i = 0; i < expected.size(); ++i) {
+    ASSERT_EQ(view_batch->requests[i].request_id, expected[i].request_id);
+    ASSERT_EQ(view_batch->requests[i].index, i);
+  }
+}
+
+TEST(OTFMessageTest, TestRetrieveLoadModelResponse) {
+  MemorySocket client_socket;
+  ASSERT_TRUE(OTFMessage::SendLoadModelResponse(
+      client_socket, std::make_unique<LoadModelResponse>(200, "loaded")));
+
+  MemorySocket frontend_socket(client_socket.GetOutput());
+  auto response = OTFMessage::RetrieveLoadModelResponse(frontend_socket);
+  ASSERT_EQ(response->code, 200);
+  ASSERT_EQ(response->buf, "loaded");
+  ASSERT_TRUE(frontend_socket.AtEnd());
+}
+
+TEST(OTFMessageTest, TestRetrieveInferenceResponse) {
+  auto expected = std::make_shared<InferenceResponseBatch>();
+  // in the order of the requests, not of their ids
+  for (const auto& request_id : {"req1", "req0"}) {
+    auto& response = expected->Add(request_id);
+    response.SetResponse(200, "data_type", PayloadType::kDATA_TYPE_STRING,
+                         std::string("msg_") + request_id);
+    response.headers[PayloadType::kHEADER_NAME_STREAM_NEXT] = "true";
+  }
+  MemorySocket client_socket;
+  ASSERT_TRUE(OTFMessage::SendInferenceResponse(client_socket, expected));
+
+  MemorySocket frontend_socket(client_socket.GetOutput());
+  auto batch = OTFMessage::RetrieveInferenceResponse(frontend_socket);
+  ASSERT_EQ(batch->Size(), expected->Size());
+  for (size_t i = 0; i < expected->Size(); ++i) {
+    const auto& response = (*expected)[i];
+    const auto& retrieved = (*batch)[i];
+    ASSERT_EQ(retrieved.request_id, response.request_id);
+    ASSERT_EQ(retrieved.code, response.code);
+    ASSERT_EQ(retrieved.headers, response.headers);
+    ASSERT_EQ(retrieved.msg, response.msg);
+  }
+  ASSERT_TRUE(frontend_socket.AtEnd());
+}
+
+TEST(OTFMessageTest, TestMemorySocketEndOfInput) {
+  MemorySocket client_socket({'\x00', '\x00'});
+  ASSERT_THROW(client_socket.RetrieveInt(), SocketError);
+}
 }  // namespace torchserve
@@ -0,0 +1,206 @@
+#include "src/backends/protocol/shared_memory.hh"
+
+#include <gtest/gtest.h>
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <cstring>
+#include <string>
+
+#include "mock_socket.hh"
+
+namespace torchserve {
+class SharedMemoryTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    // stand-in for the frontend: the producer owns the ring
+    shm_name_ = "/ts_shared_memory_test_" + std::to_string(getpid());
+    producer_ring_ = std::make_unique<SharedMemoryRing>(
+        SharedMemoryRegion::Create(shm_name_, 64 * 1024));
+    ASSERT_NE(producer_ring_->GetRegion(), nullptr);
+  }
+  void TearDown() override { shm_unlink(shm_name_.c_str()); }
+
+  std::string shm_name_;
+  std::unique_ptr<SharedMemoryRing> producer_ring_;
+};
+
+TEST_F(SharedMemoryTest, TestReferenceParse) {
+  auto reference = SharedMemoryReference::Parse("/ts:ring:0:4096:1024");
+  ASSERT_TRUE(reference.has_value());
+  ASSERT_EQ(reference->name, "/ts:ring:0");
+  ASSERT_EQ(reference->offset, 4096);
+  ASSERT_EQ(reference->length, 1024);
+  ASSERT_EQ(reference->ToString(), "/ts:ring:0:4096:1024");
+
+  ASSERT_FALSE(SharedMemoryReference::Parse("/ts_ring:4096").has_value());
+  ASSERT_FALSE(SharedMemoryReference::Parse("/ts_ring:x:1").has_value());
+  ASSERT_FALSE(SharedMemoryReference::Parse(":1:1").has_value());
+}
+
+TEST_F(SharedMemoryTest, TestRingWaitsForRelease) {
+  const auto& region = *producer_ring_->GetRegion();
+  std::string payload(40 * 1024, 'p');
+  auto first = producer_ring_->Write(payload);
+  ASSERT_EQ(first->offset, SharedMemoryRing::kSlotHeaderSize);
+  // does not fit next to the first payload, which is not released yet
+  ASSERT_FALSE(producer_ring_->Write(payload));
+  ASSERT_EQ(region.View(*first), payload);
+
+  SharedMemoryRing::Release(region, *first);
+  auto second = producer_ring_->Write(payload);
+  ASSERT_EQ(second->offset, SharedMemoryRing::kSlotHeaderSize);
+  ASSERT_FALSE(producer_ring_->Write(std::string(128 * 1024, 'p')));
+}
+
+TEST_F(SharedMemoryTest, TestRingWrapsAround) {
+  const auto& region = *producer_ring_->GetRegion();
+  std::string payload(30 * 1024, 'p');
+  auto first = producer_ring_->Write(payload);
+  auto second = producer_ring_->Write(payload);
+  ASSERT_TRUE(first && second);
+  // released out of order, the first slot is only reclaimed with the second
+  SharedMemoryRing::Release(region, *second);
+  ASSERT_EQ(producer_ring_->GetBytesInUse(),
+            2 * (SharedMemoryRing::kSlotHeaderSize + payload.size()));
+  SharedMemoryRing::Release(region, *first);
+  ASSERT_EQ(producer_ring_->GetBytesInUse(), 0);
+
+  first = producer_ring_->Write(payload);
+  second = producer_ring_->Write(payload);
+  SharedMemoryRing::Release(region, *first);
+  // skips the end of the region, which is too small, and reuses the first
+  // slot
+  std::string wrapped(10 * 1024, 'w');
+  auto third = producer_ring_->Write(wrapped);
+  ASSERT_EQ(third->offset, SharedMemoryRing::kSlotHeaderSize);
+  ASSERT_EQ(region.View(*second), payload);
+  ASSERT_EQ(region.View(*third), wrapped);
+}
+
+TEST_F(SharedMemoryTest, TestHoldReleasesOnDestruction) {
+  auto reference = producer_ring_->Write(std::string(1024, 'p'));
+  auto handle =
+      SharedMemoryRing::Hold(producer_ring_->GetRegion(), *reference);
+  ASSERT_GT(producer_ring_->GetBytesInUse(), 0);
+  handle.reset();
+  ASSERT_EQ(producer_ring_->GetBytesInUse(), 0);
+}
+
+TEST_F(SharedMemoryTest, TestRegistryRemapsRecreatedObject) {
+  SharedMemoryRegistry registry;
+  auto region = registry.Get(shm_name_);
+  ASSERT_NE(region, nullptr);
+  ASSERT_EQ(registry.Get(shm_name_), region);
+
+  shm_unlink(shm_name_.c_str());
+  ASSERT_EQ(registry.Get(shm_name_), nullptr);
+
+  auto recreated = SharedMemoryRegion::Create(shm_name_, 128 * 1024);
+  auto remapped = registry.Get(shm_name_);
+  ASSERT_NE(remapped, nullptr);
+  ASSERT_NE(remapped, region);
+  ASSERT_EQ(remapped->GetSize(), 128 * 1024);
+  // the old mapping stays valid for its holders
+  ASSERT_EQ(region->GetSize(), 64 * 1024);
+}
+
+TEST_F(SharedMemoryTest, TestResolveSharedMemoryReferences) {
+  std::string payload(3000, 'x');
+  auto reference = producer_ring_->Write(payload)->ToString();
+  std::string content_type =
+      PayloadType::kCONTENT_TYPE_SHM_REFERENCE_PREFIX + "application/x-image";
+
+  auto client_socket = std::make_shared<MockSocket>();
+  EXPECT_CALL(*client_socket, RetrieveInt())
+      .Times(7)
+      // request_id length
+      .WillOnce(::testing::Return(4))
+      // end of headers
+      .WillOnce(::testing::Return(-1))
+      // parameter_name length
+      .WillOnce(::testing::Return(4))
+      // content_type length
+      .WillOnce(::testing::Return(content_type.size()))
+      // value length
+      .WillOnce(::testing::Return(reference.size()))
+      // end of parameters
+      .WillOnce(::testing::Return(-1))
+      // end of request
+      .WillOnce(::testing::Return(-1));
+  EXPECT_CALL(*client_socket, RetrieveBuffer(testing::_, testing::_))
+      .Times(4)
+      .WillOnce(testing::Invoke(
+          [=](size_t length, char* data) { memcpy(data, "reqi", length); }))
+      .WillOnce(testing::Invoke(
+          [=](size_t length, char* data) { memcpy(data, "body", length); }))
+      .WillOnce(testing::Invoke([=](size_t length, char* data) {
+        memcpy(data, content_type.data(), length);
+      }))
+      .WillOnce(testing::Invoke([=](size_t length, char* data) {
+        memcpy(data, reference.data(), length);
+      }));
+
+  auto view_batch = OTFMessage::RetrieveInferenceMsgView(*client_socket);
+  SharedMemoryRegistry registry;
+  ASSERT_TRUE(OTFMessage::ResolveSharedMemoryReferences(*view_batch, registry));
+
+  auto& request_view = view_batch->requests.at(0);
+  ASSERT_EQ(request_view.GetHeader("body:contentType"), "application/x-image");
+  auto body = request_view.GetParameter("body");
+  ASSERT_EQ(body, payload);
+  // zero copy: the parameter points into the worker's mapping of the ring
+  auto region = registry.Get(shm_name_);
+  ASSERT_GE(body->data(), region->GetData());
+  ASSERT_LT(body->data(), region->GetData() + region->GetSize());
+  ASSERT_EQ(view_batch->external_buffers.size(), 1);
+
+  // consumed, the producer can reuse the space
+  region.reset();
+  view_batch.reset();
+  ASSERT_EQ(producer_ring_->GetBytesInUse(), 0);
+}
+
+TEST_F(SharedMemoryTest, TestResolveInvalidReference) {
+  InferenceRequestViewBatch view_batch;
+  InferenceRequestView request_view;
+  std::string content_type = PayloadType::kCONTENT_TYPE_SHM_REFERENCE_PREFIX;
+  request_view.headers.emplace_back("body:contentType", content_type);
+  // out of bounds
+  std::string reference = shm_name_ + ":0:1000000";
+  request_view.parameters.emplace_back("body", reference);
+  view_batch.requests.push_back(request_view);
+
+  SharedMemoryRegistry registry;
+  ASSERT_FALSE(OTFMessage::ResolveSharedMemoryReferences(view_batch, registry));
+  ASSERT_EQ(view_batch.requests[0].GetParameter("body"), "");
+}
+
+TEST_F(SharedMemoryTest, TestWriteResponsesToSharedMemory) {
+  auto inference_response_batch = std::make_shared<InferenceResponseBatch>();
+  inference_response_batch->Add("large").SetResponse(
+      200, "data_type", "bytes", std::string(4096, 'l'));
+  inference_response_batch->Add("small").SetResponse(200, "data_type",
+                                                      "bytes", "s");
+
+  OTFMessage::WriteResponsesToSharedMemory(inference_response_batch,
+                                           *producer_ring_, 1024);
+
+  auto& large_response = (*inference_response_batch)[0];
+  ASSERT_TRUE(large_response.msg.empty());
+  auto reference = SharedMemoryReference::Parse(
+      large_response.headers[PayloadType::kHEADER_NAME_SHM_REFERENCE]);
+  ASSERT_TRUE(reference.has_value());
+  // read back by the stand-in frontend
+  auto region = SharedMemoryRegion::Open(reference->name, true);
+  ASSERT_EQ(region->View(*reference), std::string(4096, 'l'));
+  SharedMemoryRing::Release(*region, *reference);
+  ASSERT_EQ(producer_ring_->GetBytesInUse(), 0);
+
+  const auto& small_response = (*inference_response_batch)[1];
+  ASSERT_EQ(small_response.msg.size(), 1);
+  ASSERT_EQ(
+      small_response.headers.count(PayloadType::kHEADER_NAME_SHM_REFERENCE),
+      0);
+}
+}  // namespace torchserve
@@ -0,0 +1,38 @@
+#pragma once
+
+#include <memory>
+
+#include "src/backends/protocol/otf_message.hh"
+#include "src/backends/protocol/socket.hh"
+
+namespace torchserve {
+// Answers every command on fd, streaming one intermediate response per
+// request before the final one. Returns once the peer disconnects.
+inline void RunFakeWorker(int fd) {
+  Socket worker_socket(fd);
+  try {
+    while (true) {
+      char cmd = OTFMessage::RetrieveCmd(worker_socket);
+      if (cmd == LOAD_MSG) {
+        OTFMessage::RetrieveLoadMsg(worker_socket);
+        OTFMessage::SendLoadModelResponse(
+            worker_socket, std::make_unique<LoadModelResponse>(200, "loaded"));
+        continue;
+      }
+      auto requests = OTFMessage::RetrieveInferenceMsg(worker_socket);
+      for (const auto& stream_next : {"true", "false"}) {
+        auto responses = std::make_shared<InferenceResponseBatch>();
+        for (const auto& request : *requests) {
+          auto& response = responses->Add(request.request_id);
+          response.SetResponse(200, "data_type", PayloadType::kDATA_TYPE_BYTES,
+                               request.parameters.at("body"));
+          response.headers[PayloadType::kHEADER_NAME_STREAM_NEXT] =
+              stream_next;
+        }
+        OTFMessage::SendInferenceResponse(worker_socket, responses);
+      }
+    }
+  } catch (const SocketError& e) {
+  }
+}
+}  // namespace torchserve
@@ -0,0 +1,51 @@
+#include "src/tools/load_generator.hh"
+
+#include <gtest/gtest.h>
+#include <sys/socket.h>
+
+#include <algorithm>
+#include <memory>
+#include <thread>
+
+#include "src/backends/protocol/buffered_socket.hh"
+#include "fake_worker.hh"
+
+namespace torchserve {
+TEST(LoadGeneratorTest, TestRun) {
+  int fds[2];
+  ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+  std::thread worker(RunFakeWorker, fds[1]);
+
+  LoadGeneratorConfig config;
+  config.load_model_request = std::make_shared<LoadModelRequest>(
+      "model_dir", "model", -1, "", "", 4, false);
+  config.payloads = {{'a'}, {'b', 'b'}};
+  config.batch_size = 4;
+  config.max_batches = 5;
+  LoadGenerator load_generator(config, [&fds]() {
+    return std::make_unique<BufferedSocket>(fds[0]);
+  });
+  auto report = load_generator.Run();
+  worker.join();
+
+  ASSERT_EQ(report.batches, 5);
+  ASSERT_EQ(report.requests, 20);
+  ASSERT_EQ(report.errors, 0);
+  ASSERT_EQ(report.latencies_ms.size(), 5);
+  ASSERT_TRUE(std::is_sorted(report.latencies_ms.begin(),
+                             report.latencies_ms.end()));
+}
+
+TEST(LoadGeneratorTest, TestPercentile) {
+  LoadReport report;
+  ASSERT_EQ(report.Percentile(50), 0);
+  for (int i = 1; i <= 1000; ++i) {
+    report.latencies_ms.push_back(i);
+  }
+  ASSERT_EQ(report.Percentile(0), 1);
+  ASSERT_EQ(report.Percentile(50), 500);
+  ASSERT_EQ(report.Percentile(99), 990);
+  ASSERT_EQ(report.Percentile(99.9), 999);
+  ASSERT_EQ(report.Percentile(100), 1000);
+}
+}  // namespace torchserve
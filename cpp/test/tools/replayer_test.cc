@@ -0,0 +1,141 @@
+#include "src/tools/replayer.hh"
+
+#include <gtest/gtest.h>
+#include <sys/socket.h>
+
+#include <chrono>
+#include <filesystem>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "fake_worker.hh"
+#include "src/backends/protocol/buffered_socket.hh"
+#include "src/backends/protocol/otf_message.hh"
+
+namespace torchserve {
+TEST(ReplayerTest, TestRun) {
+  auto path = (std::filesystem::temp_directory_path() / "ts_replay_test.bin")
+                  .string();
+  {
+    CaptureWriter writer(path);
+    auto start = std::chrono::steady_clock::now();
+    std::vector<char> frame;
+    OTFMessage::EncodeLoadModelRequest(
+        LoadModelRequest("model_dir", "model", -1, "", "", 2, false), frame);
+    writer.Write(0, start, frame);
+    for (int i = 0; i < 3; ++i) {
+      InferenceRequestBatch batch(2);
+      batch[0].request_id = "a" + std::to_string(i);
+      batch[1].request_id = "b" + std::to_string(i);
+      for (auto& request : batch) {
+        request.parameters[PayloadType::kPARAMETER_NAME_BODY] = {'x'};
+      }
+      frame.clear();
+      OTFMessage::EncodeInferenceRequest(batch, frame);
+      writer.Write(0, start + std::chrono::milliseconds(20 * (i + 1)), frame);
+    }
+  }
+
+  int fds[2];
+  ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, fds), 0);
+  std::thread worker(RunFakeWorker, fds[1]);
+  ReplayConfig config;
+  config.capture_file = path;
+  config.speed = 2;
+  Replayer replayer(config, [&fds]() {
+    return std::make_unique<BufferedSocket>(fds[0]);
+  });
+  auto report = replayer.Run();
+  worker.join();
+  std::filesystem::remove(path);
+
+  ASSERT_EQ(report.batches, 3);
+  ASSERT_EQ(report.requests, 6);
+  ASSERT_EQ(report.errors, 0);
+  // the last command is due 60 ms into the capture, 30 ms at twice the speed
+  ASSERT_GE(report.elapsed_sec, 0.03);
+}
+
+TEST(ReplayerTest, TestSlowConnectionDoesNotBlockOthers) {
+  auto path =
+      (std::filesystem::temp_directory_path() / "ts_replay_hol_test.bin")
+          .string();
+  // enough commands on the stalled connection to fill any read-ahead, all
+  // captured before the command of the other connection
+  constexpr int kLoadCount = 2000;
+  {
+    CaptureWriter writer(path);
+    auto start = std::chrono::steady_clock::now();
+    std::vector<char> frame;
+    OTFMessage::EncodeLoadModelRequest(
+        LoadModelRequest("model_dir", "model", -1, "", "", 1, false), frame);
+    for (int i = 0; i < kLoadCount; ++i) {
+      writer.Write(0, start, frame);
+    }
+    InferenceRequestBatch batch(1);
+    batch[0].request_id = "a";
+    batch[0].parameters[PayloadType::kPARAMETER_NAME_BODY] = {'x'};
+    frame.clear();
+    OTFMessage::EncodeInferenceRequest(batch, frame);
+    writer.Write(1, start, frame);
+  }
+
+  // loads are answered only once the inference of the other connection was
+  std::promise<void> inference_done;
+  auto inference_done_future = inference_done.get_future().share();
+  auto run_worker = [&inference_done, inference_done_future](int fd) {
+    Socket worker_socket(fd);
+    try {
+      while (true) {
+        char cmd = OTFMessage::RetrieveCmd(worker_socket);
+        if (cmd == LOAD_MSG) {
+          OTFMessage::RetrieveLoadMsg(worker_socket);
+          inference_done_future.wait();
+          OTFMessage::SendLoadModelResponse(
+              worker_socket, std::make_unique<LoadModelResponse>(200, ""));
+          continue;
+        }
+        auto requests = OTFMessage::RetrieveInferenceMsg(worker_socket);
+        auto responses = std::make_shared<InferenceResponseBatch>();
+        for (const auto& request : *requests) {
+          responses->Add(request.request_id)
+              .SetResponse(200, "data_type", PayloadType::kDATA_TYPE_BYTES,
+                           "y");
+        }
+        OTFMessage::SendInferenceResponse(worker_socket, responses);
+        inference_done.set_value();
+      }
+    } catch (const SocketError& e) {
+    }
+  };
+
+  int fds[2][2];
+  std::vector<std::thread> workers;
+  for (auto& pair_fds : fds) {
+    ASSERT_EQ(socketpair(AF_UNIX, SOCK_STREAM, 0, pair_fds), 0);
+    workers.emplace_back(run_worker, pair_fds[1]);
+  }
+  std::mutex connector_mutex;
+  size_t next_socket = 0;
+  ReplayConfig config;
+  config.capture_file = path;
+  config.speed = 0;
+  Replayer replayer(config, [&]() {
+    std::lock_guard<std::mutex> lock(connector_mutex);
+    return std::make_unique<BufferedSocket>(fds[next_socket++][0]);
+  });
+  auto report = replayer.Run();
+  for (auto& worker : workers) {
+    worker.join();
+  }
+  std::filesystem::remove(path);
+
+  ASSERT_EQ(report.batches, 1);
+  ASSERT_EQ(report.requests, 1);
+  ASSERT_EQ(report.errors, 0);
+}
+}  // namespace torchserve
@@ -1,8 +1,11 @@
 #include <fmt/format.h>
 #include <gtest/gtest.h>
 
+#include <chrono>
 #include <iostream>
 #include <memory>
+#include <thread>
+#include <vector>
 
 #include "src/utils/message.hh"
 #include "test/utils/common.hh"
@@ -25,6 +28,26 @@ TEST_F(ModelPredictTest, TestLoadPredictMnistHandler) {
                     200);
 }
 
+TEST_F(ModelPredictTest, TestLoadPredictWithWarmup) {
+  // warms up batch sizes 1 and 2 on 0_png.pt before the instance is ready
+  this->LoadPredict(std::make_shared<torchserve::LoadModelRequest>(
+                        "resources/examples/mnist/mnist_handler",
+                        "mnist_scripted_v2", -1, "", "", 2, false),
+                    "resources/examples/mnist/warmup",
+                    "resources/examples/mnist/0_png.pt", "mnist_ts",
+                    200);
+}
+
+TEST_F(ModelPredictTest, TestLoadPredictWithAutotuneThreads) {
+  // picks the fastest intra-op thread count of the pinned instance on 0_png.pt
+  this->LoadPredict(std::make_shared<torchserve::LoadModelRequest>(
+                        "resources/examples/mnist/mnist_handler",
+                        "mnist_scripted_v2", -1, "", "", 1, false),
+                    "resources/examples/mnist/autotune",
+                    "resources/examples/mnist/0_png.pt", "mnist_ts",
+                    200);
+}
+
 TEST_F(ModelPredictTest, TestBackendInitWrongModelDir) {
   auto result = backend_->Initialize("resources/examples/mnist");
   ASSERT_EQ(result, false);
@@ -53,3 +76,165 @@ TEST_F(ModelPredictTest, TestLoadPredictMnistHandlerFailure) {
                     "resources/examples/mnist/0.png", "mnist_ts",
                     500);
 }
+
+TEST_F(ModelPredictTest, TestLoadModelReusesModelInstance) {
+  torchserve::MetricsRegistry::Initialize(
+      "resources/metrics/default_config.yaml",
+      torchserve::MetricsContext::BACKEND);
+  backend_->Initialize("resources/examples/mnist/base_handler");
+  auto load_model = [this]() {
+    return backend_->LoadModel(std::make_shared<torchserve::LoadModelRequest>(
+        "resources/examples/mnist/mnist_handler", "mnist_scripted_v2", -1, "",
+        "", 1, false));
+  };
+  // e.g. two frontend connections served by the same worker process
+  ASSERT_EQ(load_model()->code, 200);
+  ASSERT_EQ(load_model()->code, 200);
+  ASSERT_EQ(backend_->GetModelInstanceStatus("cpu:-1:0"),
+            torchserve::Backend::ModelInstanceStatus::READY);
+  ASSERT_EQ(backend_->GetModelInstanceStatus("cpu:-1:1"),
+            torchserve::Backend::ModelInstanceStatus::NOT_INIT);
+}
+
+TEST_F(ModelPredictTest, TestGetModelInstanceLeastOutstanding) {
+  torchserve::MetricsRegistry::Initialize(
+      "resources/metrics/default_config.yaml",
+      torchserve::MetricsContext::BACKEND);
+  backend_->Initialize("resources/examples/mnist/instances");
+  ASSERT_EQ(backend_->GetInstanceSelection(),
+            torchserve::Backend::InstanceSelection::LEAST_OUTSTANDING);
+  // the archive has two CPU instances, loaded by the first two loads
+  for (int i = 0; i < 2; ++i) {
+    ASSERT_EQ(backend_
+                  ->LoadModel(std::make_shared<torchserve::LoadModelRequest>(
+                      "resources/examples/mnist/mnist_handler",
+                      "mnist_scripted_v2", -1, "", "", 1, false))
+                  ->code,
+              200);
+  }
+
+  auto first = backend_->GetModelInstance();
+  auto second = backend_->GetModelInstance();
+  ASSERT_NE(first->GetInstanceId(), second->GetInstanceId());
+  ASSERT_EQ(first->GetInFlight(), 1);
+  ASSERT_EQ(second->GetInFlight(), 1);
+
+  // the idle instance is picked while the other one is still busy
+  auto first_instance_id = first->GetInstanceId();
+  first.reset();
+  auto third = backend_->GetModelInstance();
+  ASSERT_EQ(third->GetInstanceId(), first_instance_id);
+  third.reset();
+  ASSERT_EQ(backend_->GetModelInstance(first_instance_id)->GetInFlight(), 0);
+}
+
+TEST_F(ModelPredictTest, TestConcurrentLoadModel) {
+  torchserve::MetricsRegistry::Initialize(
+      "resources/metrics/default_config.yaml",
+      torchserve::MetricsContext::BACKEND);
+  auto load_model = [](torchserve::Backend& backend) {
+    return backend
+        .LoadModel(std::make_shared<torchserve::LoadModelRequest>(
+            "resources/examples/mnist/mnist_handler", "mnist_scripted_v2", -1,
+            "", "", 1, false))
+        ->code;
+  };
+  auto single_backend = std::make_shared<torchserve::Backend>();
+  single_backend->Initialize("resources/examples/mnist/base_handler");
+  auto start = std::chrono::steady_clock::now();
+  ASSERT_EQ(load_model(*single_backend), 200);
+  auto single_load_time = std::chrono::steady_clock::now() - start;
+
+  // equal requests of four connections: the first two load the archive's
+  // two CPU instances in parallel, the others wait for them
+  backend_->Initialize("resources/examples/mnist/instances");
+  std::vector<std::thread> connections;
+  std::vector<int> codes(4);
+  start = std::chrono::steady_clock::now();
+  for (size_t i = 0; i < codes.size(); ++i) {
+    connections.emplace_back([&, i]() { codes[i] = load_model(*backend_); });
+  }
+  for (auto& connection : connections) {
+    connection.join();
+  }
+  auto concurrent_load_time = std::chrono::steady_clock::now() - start;
+
+  ASSERT_EQ(codes, std::vector<int>(4, 200));
+  ASSERT_EQ(backend_->GetModelInstanceStatus("cpu:-1:0"),
+            torchserve::Backend::ModelInstanceStatus::READY);
+  ASSERT_EQ(backend_->GetModelInstanceStatus("cpu:-1:1"),
+            torchserve::Backend::ModelInstanceStatus::READY);
+  ASSERT_EQ(backend_->GetModelInstanceStatus("cpu:-1:2"),
+            torchserve::Backend::ModelInstanceStatus::NOT_INIT);
+  ASSERT_LT(concurrent_load_time, 2 * single_load_time);
+}
+
+TEST_F(ModelPredictTest, TestWorkersPinToDisjointCpuSets) {
+  torchserve::MetricsRegistry::Initialize(
+      "resources/metrics/default_config.yaml",
+      torchserve::MetricsContext::BACKEND);
+  // one process per worker, each loads one CPU instance
+  std::vector<torchserve::CpuAffinity::CpuSet> worker_cpus;
+  for (unsigned int worker_index : {0, 1}) {
+    auto backend = std::make_shared<torchserve::Backend>();
+    ASSERT_TRUE(
+        backend->Initialize("resources/examples/mnist/affinity", worker_index));
+    ASSERT_EQ(backend
+                  ->LoadModel(std::make_shared<torchserve::LoadModelRequest>(
+                      "resources/examples/mnist/mnist_handler",
+                      "mnist_scripted_v2", -1, "", "", 1, false))
+                  ->code,
+              200);
+    worker_cpus.push_back(backend->GetModelInstance()->GetCpus());
+  }
+
+  ASSERT_EQ(worker_cpus[0], torchserve::CpuAffinity::CpuSet{0});
+  ASSERT_EQ(worker_cpus[1], torchserve::CpuAffinity::CpuSet{1});
+}
+
+TEST_F(ModelPredictTest, TestSwapModel) {
+  torchserve::MetricsRegistry::Initialize(
+      "resources/metrics/default_config.yaml",
+      torchserve::MetricsContext::BACKEND);
+  backend_->Initialize("resources/examples/mnist/base_handler");
+  ASSERT_EQ(backend_
+                ->LoadModel(std::make_shared<torchserve::LoadModelRequest>(
+                    "resources/examples/mnist/mnist_handler",
+                    "mnist_scripted_v2", -1, "", "", 1, false))
+                ->code,
+            200);
+  // a batch still running on the old version
+  auto old_instance = backend_->GetModelInstance();
+  auto old_instance_id = old_instance->GetInstanceId();
+
+  // swaps from the base handler archive to the mnist handler archive
+  ASSERT_EQ(backend_
+                ->SwapModel(std::make_shared<torchserve::LoadModelRequest>(
+                    "resources/examples/mnist/mnist_handler",
+                    "mnist_scripted_v2", -1, "", "", 1, false))
+                ->code,
+            200);
+  ASSERT_EQ(backend_->GetModelInstanceStatus(old_instance_id),
+            torchserve::Backend::ModelInstanceStatus::NOT_INIT);
+  ASSERT_NE(backend_->GetModelInstance()->GetInstanceId(), old_instance_id);
+  // the settings of the new manifest apply
+  ASSERT_EQ(backend_->GetInstanceSelection(),
+            torchserve::Backend::InstanceSelection::ROUND_ROBIN);
+
+  // the old instance completes its batch
+  std::ifstream input("resources/examples/mnist/0_png.pt",
+                      std::ios::in | std::ios::binary);
+  std::vector<char> image((std::istreambuf_iterator<char>(input)),
+                          (std::istreambuf_iterator<char>()));
+  torchserve::InferenceRequest inference_request;
+  inference_request.request_id = "mnist_ts_0";
+  inference_request.headers[torchserve::PayloadType::kHEADER_NAME_DATA_TYPE] =
+      torchserve::PayloadType::kDATA_TYPE_BYTES;
+  inference_request.parameters[torchserve::PayloadType::kPARAMETER_NAME_DATA] =
+      image;
+  auto inference_request_batch =
+      torchserve::InferenceRequestViewBatch::FromRequests({inference_request});
+  std::shared_ptr<torchserve::InferenceResponseBatch> inference_response_batch;
+  old_instance->Predict(inference_request_batch, inference_response_batch);
+  ASSERT_EQ((*inference_response_batch)[0].code, 200);
+}
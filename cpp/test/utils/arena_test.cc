@@ -0,0 +1,44 @@
+#include "src/utils/arena.hh"
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace torchserve {
+TEST(ArenaTest, TestAllocationsNeverMove) {
+  Arena arena;
+  std::vector<std::string_view> copies;
+  std::vector<std::string> expected;
+  // spans several small blocks and a few large ones
+  for (int i = 0; i < 2000; ++i) {
+    expected.push_back(std::string(i % 7 == 0 ? Arena::kLargeSize : 100,
+                                   static_cast<char>('a' + i % 26)));
+    copies.push_back(arena.Copy(expected.back()));
+  }
+  for (size_t i = 0; i < expected.size(); ++i) {
+    ASSERT_EQ(copies[i], expected[i]);
+  }
+}
+
+TEST(ArenaTest, TestLargeAllocationGetsOwnBlock) {
+  Arena arena;
+  arena.Allocate(10);
+  auto bytes = arena.Bytes();
+  arena.Allocate(Arena::kLargeSize);
+  ASSERT_EQ(arena.Bytes(), bytes + Arena::kLargeSize);
+  // the small block is still used
+  arena.Allocate(10);
+  ASSERT_EQ(arena.Bytes(), bytes + Arena::kLargeSize);
+}
+
+TEST(ArenaTest, TestAlignment) {
+  Arena arena;
+  arena.Allocate(3);
+  auto* data = arena.Allocate(16, Arena::kBlockAlignment);
+  ASSERT_EQ(reinterpret_cast<uintptr_t>(data) % Arena::kBlockAlignment, 0);
+  ASSERT_TRUE(arena.Copy("").empty());
+}
+}  // namespace torchserve
@@ -0,0 +1,41 @@
+#include "src/utils/bounded_queue.hh"
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <thread>
+#include <vector>
+
+namespace torchserve {
+TEST(BoundedQueueTest, TestFifoOrderAcrossThreads) {
+  BoundedQueue<std::unique_ptr<int>> queue(2);
+  constexpr int kItemCount = 1000;
+  std::thread producer([&queue]() {
+    for (int i = 0; i < kItemCount; ++i) {
+      ASSERT_TRUE(queue.Push(std::make_unique<int>(i)));
+    }
+    queue.Close();
+  });
+
+  std::vector<int> received;
+  while (auto item = queue.Pop()) {
+    received.push_back(**item);
+  }
+  producer.join();
+
+  ASSERT_EQ(received.size(), kItemCount);
+  for (int i = 0; i < kItemCount; ++i) {
+    ASSERT_EQ(received[i], i);
+  }
+}
+
+TEST(BoundedQueueTest, TestClose) {
+  BoundedQueue<int> queue(1);
+  ASSERT_TRUE(queue.Push(1));
+  queue.Close();
+  ASSERT_FALSE(queue.Push(2));
+  // remaining items are drained after close
+  ASSERT_EQ(queue.Pop(), 1);
+  ASSERT_EQ(queue.Pop(), std::nullopt);
+}
+}  // namespace torchserve
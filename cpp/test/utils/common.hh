@@ -27,8 +27,7 @@ class ModelPredictTest : public ::testing::Test {
                             (std::istreambuf_iterator<char>()));
     input.close();
 
-    auto inference_request_batch =
-        std::make_shared<torchserve::InferenceRequestBatch>();
+    torchserve::InferenceRequestBatch inference_request_batch;
     for (uint8_t i = 0; i < batch_size_; i++) {
       torchserve::InferenceRequest inference_request;
       inference_request.request_id =
@@ -39,13 +38,17 @@ class ModelPredictTest : public ::testing::Test {
       inference_request
           .parameters[torchserve::PayloadType::kPARAMETER_NAME_DATA] = image;
 
-      (*inference_request_batch).emplace_back(inference_request);
+      inference_request_batch.emplace_back(inference_request);
     }
 
-    auto inference_response_batch =
-        backend_->GetModelInstance()->Predict(inference_request_batch);
-    for (const auto& kv : *inference_response_batch) {
-      ASSERT_EQ(kv.second->code, inference_expect_code);
+    auto request_batch = torchserve::InferenceRequestViewBatch::FromRequests(
+        inference_request_batch);
+    std::shared_ptr<torchserve::InferenceResponseBatch>
+        inference_response_batch;
+    backend_->GetModelInstance()->Predict(request_batch,
+                                          inference_response_batch);
+    for (const auto& inference_response : *inference_response_batch) {
+      ASSERT_EQ(inference_response.code, inference_expect_code);
     }
   };
 
@@ -0,0 +1,99 @@
+#include "src/utils/cpu_affinity.hh"
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <stdexcept>
+#include <thread>
+#include <vector>
+
+namespace torchserve {
+TEST(CpuAffinityTest, TestParseCpuList) {
+  CpuAffinity::CpuSet expected = {0, 1, 2, 3, 8, 10, 11};
+  ASSERT_EQ(CpuAffinity::ParseCpuList("0-3,8,10-11"), expected);
+  ASSERT_EQ(CpuAffinity::ToCpuList(expected), "0-3,8,10-11");
+  ASSERT_TRUE(CpuAffinity::ParseCpuList("").empty());
+  ASSERT_THROW(CpuAffinity::ParseCpuList("3-1"), std::invalid_argument);
+  ASSERT_THROW(CpuAffinity::ParseCpuList("a"), std::invalid_argument);
+}
+
+TEST(CpuAffinityTest, TestPartitionNodes) {
+  std::vector<CpuAffinity::CpuSet> nodes = {{0, 1, 2, 3}, {4, 5, 6, 7}};
+
+  // instances alternate between the nodes and split their cpus
+  std::vector<CpuAffinity::CpuSet> expected = {{0, 1}, {4, 5}, {2, 3}, {6, 7}};
+  ASSERT_EQ(CpuAffinity::Partition(nodes, 4), expected);
+
+  expected = {{0, 1}, {4, 5, 6, 7}, {2, 3}};
+  ASSERT_EQ(CpuAffinity::Partition(nodes, 3), expected);
+
+  // a single instance spans every node
+  expected = {{0, 1, 2, 3, 4, 5, 6, 7}};
+  ASSERT_EQ(CpuAffinity::Partition(nodes, 1), expected);
+}
+
+TEST(CpuAffinityTest, TestScopedCpuAffinity) {
+  auto previous = CpuAffinity::GetThreadAffinity();
+  if (previous.empty()) {
+    GTEST_SKIP() << "thread affinity is not supported";
+  }
+  {
+    ScopedCpuAffinity cpu_affinity({previous.front()});
+    ASSERT_EQ(CpuAffinity::GetThreadAffinity(),
+              CpuAffinity::CpuSet{previous.front()});
+  }
+  ASSERT_EQ(CpuAffinity::GetThreadAffinity(), previous);
+}
+
+TEST(CpuAffinityTest, TestPinnedExecutor) {
+  auto previous = CpuAffinity::GetThreadAffinity();
+  if (previous.empty()) {
+    GTEST_SKIP() << "thread affinity is not supported";
+  }
+  CpuAffinity::CpuSet cpus = {previous.back()};
+  std::atomic<int> inits{0};
+  PinnedExecutor executor(cpus, [&inits]() { ++inits; });
+
+  // runs on a pinned thread, the caller's affinity is left alone
+  CpuAffinity::CpuSet affinity;
+  std::thread::id runner;
+  executor.Run([&]() {
+    affinity = CpuAffinity::GetThreadAffinity();
+    runner = std::this_thread::get_id();
+  });
+  ASSERT_EQ(affinity, cpus);
+  ASSERT_NE(runner, std::this_thread::get_id());
+  ASSERT_EQ(CpuAffinity::GetThreadAffinity(), previous);
+
+  // an idle thread is reused
+  std::thread::id reused;
+  executor.Run([&]() { reused = std::this_thread::get_id(); });
+  ASSERT_EQ(reused, runner);
+  ASSERT_EQ(executor.GetThreadCount(), 1);
+  ASSERT_EQ(inits.load(), 1);
+
+  ASSERT_THROW(executor.Run([]() { throw std::runtime_error("failed"); }),
+               std::runtime_error);
+}
+
+TEST(CpuAffinityTest, TestPinnedExecutorConcurrentCallers) {
+  PinnedExecutor executor({});
+  // each task waits for the other, so they only complete if they run
+  // concurrently
+  std::mutex mutex;
+  std::condition_variable cv;
+  int arrived = 0;
+  auto meet = [&]() {
+    std::unique_lock<std::mutex> lock(mutex);
+    ++arrived;
+    cv.notify_all();
+    cv.wait(lock, [&arrived]() { return arrived == 2; });
+  };
+  std::thread other([&]() { executor.Run(meet); });
+  executor.Run(meet);
+  other.join();
+  ASSERT_EQ(executor.GetThreadCount(), 2);
+}
+}  // namespace torchserve
@@ -0,0 +1,62 @@
+#include "src/utils/hash128.hh"
+
+#include <gtest/gtest.h>
+
+#include <cstdint>
+#include <set>
+#include <string>
+#include <string_view>
+#include <utility>
+
+namespace torchserve {
+namespace {
+Digest128 Hash(std::string_view data) {
+  Hasher128 hasher;
+  hasher.Update(data);
+  return hasher.Digest();
+}
+}  // namespace
+
+TEST(Hasher128Test, TestIncrementalMatchesWhole) {
+  std::string data;
+  for (int i = 0; i < 1000; ++i) {
+    data += static_cast<char>(i * 31 + 7);
+  }
+  auto whole = Hash(data);
+  // splits within and across stripes, and empty pieces
+  for (size_t split : {0, 1, 7, 31, 32, 33, 500, 999, 1000}) {
+    Hasher128 hasher;
+    hasher.Update(std::string_view(data).substr(0, split));
+    hasher.Update("", 0);
+    hasher.Update(std::string_view(data).substr(split));
+    ASSERT_EQ(hasher.Digest(), whole) << split;
+  }
+  Hasher128 bytewise;
+  for (char byte : data) {
+    bytewise.Update(&byte, 1);
+  }
+  ASSERT_EQ(bytewise.Digest(), whole);
+}
+
+TEST(Hasher128Test, TestDistinctInputs) {
+  std::set<std::pair<uint64_t, uint64_t>> lows_and_highs;
+  std::set<uint64_t> highs;
+  // every length up to a few stripes, e.g. zeros of different lengths
+  for (size_t size = 1; size <= 100; ++size) {
+    for (char fill : {'\0', 'a'}) {
+      auto digest = Hash(std::string(size, fill));
+      lows_and_highs.emplace(digest.low, digest.high);
+      highs.insert(digest.high);
+    }
+  }
+  ASSERT_EQ(lows_and_highs.size(), 200);
+  ASSERT_EQ(highs.size(), 200);
+
+  std::string data(4096, 'x');
+  auto digest = Hash(data);
+  data[2048] = 'y';
+  ASSERT_NE(Hash(data), digest);
+  ASSERT_EQ(Hash(""), Hash(""));
+  ASSERT_NE(Hasher128(1).Digest(), Hasher128(2).Digest());
+}
+}  // namespace torchserve
@@ -12,6 +12,8 @@ TEST(JsonTest, TestParsingAndGetValue) {
 
   EXPECT_TRUE(data.GetValue("int").AsInt() == 42);
 
+  EXPECT_TRUE(data.GetValue("bool").AsBool());
+
   auto data2 = data.GetValue("json");
 
   EXPECT_TRUE(data2.GetValue("string").AsString().compare("test2") == 0);
@@ -0,0 +1,63 @@
+#include "src/utils/message.hh"
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <string>
+
+namespace torchserve {
+TEST(InferenceResponseBatchTest, TestResetByRequestIndex) {
+  InferenceRequestBatch requests(3);
+  for (size_t i = 0; i < requests.size(); ++i) {
+    requests[i].request_id = "req" + std::to_string(i);
+  }
+  auto request_batch = InferenceRequestViewBatch::FromRequests(requests);
+  // the views moved around, their responses stay in request order
+  std::swap(request_batch->requests[0], request_batch->requests[2]);
+
+  InferenceResponseBatch response_batch;
+  response_batch.Add("stale").code = 500;
+  response_batch.Reset(*request_batch);
+  ASSERT_EQ(response_batch.Size(), 3);
+  for (size_t i = 0; i < requests.size(); ++i) {
+    ASSERT_EQ(response_batch[i].request_id, requests[i].request_id);
+    ASSERT_EQ(response_batch[i].code, 200);
+  }
+}
+
+TEST(InferenceResponseBatchTest, TestAddInOrder) {
+  InferenceResponseBatch response_batch;
+  for (int i = 9; i >= 0; --i) {
+    response_batch.Add("req" + std::to_string(i)).code = i;
+  }
+  ASSERT_EQ(response_batch.Size(), 10);
+  int expected = 9;
+  for (const auto& response : response_batch) {
+    ASSERT_EQ(response.request_id, "req" + std::to_string(expected));
+    ASSERT_EQ(response.code, expected);
+    --expected;
+  }
+  ASSERT_EQ(response_batch.Find("req3")->code, 3);
+  ASSERT_EQ(response_batch.Find("req10"), nullptr);
+}
+
+TEST(InferenceResponseBatchTest, TestClearKeepsBuffers) {
+  InferenceResponseBatch response_batch;
+  auto& response = response_batch.Add("req0");
+  response.SetResponse(500, "data_type", PayloadType::kDATA_TYPE_STRING,
+                       std::string(1024, 'x'));
+  const auto* msg_data = response.msg.data();
+  response_batch.Clear();
+  ASSERT_TRUE(response_batch.Empty());
+  ASSERT_EQ(response_batch.Find("req0"), nullptr);
+
+  auto& reused = response_batch.Add("req1");
+  ASSERT_EQ(reused.request_id, "req1");
+  ASSERT_EQ(reused.code, 200);
+  ASSERT_TRUE(reused.headers.empty());
+  ASSERT_TRUE(reused.msg.empty());
+  reused.SetResponse(200, "data_type", PayloadType::kDATA_TYPE_STRING,
+                     std::string(512, 'y'));
+  ASSERT_EQ(reused.msg.data(), msg_data);
+}
+}  // namespace torchserve
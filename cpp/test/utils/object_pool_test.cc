@@ -0,0 +1,41 @@
+#include "src/utils/object_pool.hh"
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <string>
+
+namespace torchserve {
+TEST(ObjectPoolTest, TestReuseReleased) {
+  ObjectPool<std::string> pool(1);
+  auto object = pool.Acquire();
+  object->assign(1024, 'x');
+  auto* data = object->data();
+  pool.Release(std::move(object));
+  ASSERT_EQ(pool.Size(), 1);
+
+  // as it was released, buffer and all
+  auto reused = pool.Acquire();
+  ASSERT_EQ(reused->data(), data);
+  ASSERT_EQ(pool.Size(), 0);
+}
+
+TEST(ObjectPoolTest, TestReleaseBounded) {
+  ObjectPool<std::string> pool(1);
+  auto first = pool.Acquire();
+  auto second = pool.Acquire();
+  pool.Release(std::move(first));
+  pool.Release(std::move(second));
+  ASSERT_EQ(pool.Size(), 1);
+}
+
+TEST(ObjectPoolTest, TestReleaseSharedObject) {
+  ObjectPool<std::string> pool(1);
+  auto object = pool.Acquire();
+  // e.g. still queued to be sent
+  auto holder = object;
+  pool.Release(std::move(object));
+  ASSERT_EQ(pool.Size(), 0);
+  ASSERT_NE(pool.Acquire(), holder);
+}
+}  // namespace torchserve
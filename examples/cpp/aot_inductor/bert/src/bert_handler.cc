@@ -73,65 +73,59 @@ BertCppHandler::LoadModel(
 
 c10::IValue BertCppHandler::Preprocess(
     std::shared_ptr<torch::Device> &device,
-    std::pair<std::string &, std::map<uint8_t, std::string> &> &idx_to_req_id,
-    std::shared_ptr<torchserve::InferenceRequestBatch> &request_batch,
+    torchserve::BatchContext &batch_context,
+    std::shared_ptr<torchserve::InferenceRequestViewBatch> &request_batch,
     std::shared_ptr<torchserve::InferenceResponseBatch> &response_batch) {
   auto options = torch::TensorOptions().dtype(torch::kLong);
-  auto attention_mask = torch::zeros({static_cast<long>(request_batch->size()), max_length_}, torch::kLong);
-  auto batch_tokens = torch::full({static_cast<long>(request_batch->size()), max_length_}, tokenizer_->TokenToId("<pad>"), torch::kLong);
+  auto attention_mask = torch::zeros({static_cast<long>(request_batch->requests.size()), max_length_}, torch::kLong);
+  auto batch_tokens = torch::full({static_cast<long>(request_batch->requests.size()), max_length_}, tokenizer_->TokenToId("<pad>"), torch::kLong);
 
-  uint8_t idx = 0;
-  for (auto& request : *request_batch) {
+  for (auto& request : request_batch->requests) {
+    auto* response = &(*response_batch)[request.index];
     try {
-      (*response_batch)[request.request_id] =
-          std::make_shared<torchserve::InferenceResponse>(request.request_id);
-      idx_to_req_id.first += idx_to_req_id.first.empty()
-                                 ? request.request_id
-                                 : "," + request.request_id;
 
-      auto data_it = request.parameters.find(
+      auto data = request.GetParameter(
           torchserve::PayloadType::kPARAMETER_NAME_DATA);
-      auto dtype_it =
-          request.headers.find(torchserve::PayloadType::kHEADER_NAME_DATA_TYPE);
-      if (data_it == request.parameters.end()) {
-        data_it = request.parameters.find(
+      auto dtype =
+          request.GetHeader(torchserve::PayloadType::kHEADER_NAME_DATA_TYPE);
+      if (!data) {
+        data = request.GetParameter(
             torchserve::PayloadType::kPARAMETER_NAME_BODY);
-        dtype_it = request.headers.find(
+        dtype = request.GetHeader(
             torchserve::PayloadType::kHEADER_NAME_BODY_TYPE);
       }
 
-      if (data_it == request.parameters.end() ||
-          dtype_it == request.headers.end()) {
-        (*response_batch)[request.request_id]->SetResponse(
-            500, "data_type", torchserve::PayloadType::kCONTENT_TYPE_TEXT,
-            "Empty payload");
+      if (!data || !dtype) {
+        response->SetResponse(500, "data_type",
+                              torchserve::PayloadType::kCONTENT_TYPE_TEXT,
+                              "Empty payload");
         continue;
       }
 
-      std::string msg = torchserve::Converter::VectorToStr(data_it->second);
+      std::string msg(*data);
       // tokenization
       std::vector<int32_t> token_ids = tokenizer_->Encode(msg);;
       int cur_token_ids_length = (int)token_ids.size();
       if (cur_token_ids_length > max_length_) {
         TS_LOGF(ERROR, "prompt too long ({} tokens, max {})", cur_token_ids_length,  max_length_);
       }
+      // row of the request in the batch
+      auto idx = static_cast<long>(batch_context.Size());
       for (int i = 0; i < std::min(cur_token_ids_length, max_length_); i++) {
         attention_mask[idx][i] = 1;
         batch_tokens[idx][i] = token_ids[i];
       }
 
-      idx_to_req_id.second[idx++] = request.request_id;
+      batch_context.Add(request.request_id, response);
     } catch (const std::runtime_error& e) {
       TS_LOGF(ERROR, "Failed to load tensor for request id: {}, error: {}",
               request.request_id, e.what());
-      auto response = (*response_batch)[request.request_id];
       response->SetResponse(500, "data_type",
                             torchserve::PayloadType::kDATA_TYPE_STRING,
                             "runtime_error, failed to load tensor");
     } catch (const c10::Error& e) {
       TS_LOGF(ERROR, "Failed to load tensor for request id: {}, c10 error: {}",
               request.request_id, e.msg());
-      auto response = (*response_batch)[request.request_id];
       response->SetResponse(500, "data_type",
                             torchserve::PayloadType::kDATA_TYPE_STRING,
                             "c10 error, failed to load tensor");
@@ -147,7 +141,7 @@ c10::IValue BertCppHandler::Preprocess(
 c10::IValue BertCppHandler::Inference(
     std::shared_ptr<void> model, c10::IValue &inputs,
     std::shared_ptr<torch::Device> &device,
-    std::pair<std::string &, std::map<uint8_t, std::string> &> &idx_to_req_id,
+    torchserve::BatchContext &batch_context,
     std::shared_ptr<torchserve::InferenceResponseBatch> &response_batch) {
   c10::InferenceMode mode;
   try {
@@ -170,34 +164,28 @@ c10::IValue BertCppHandler::Inference(
 
 void BertCppHandler::Postprocess(
     c10::IValue &inputs,
-    std::pair<std::string &, std::map<uint8_t, std::string> &> &idx_to_req_id,
+    torchserve::BatchContext &batch_context,
     std::shared_ptr<torchserve::InferenceResponseBatch> &response_batch) {
   auto& data = inputs.toTensor();
-  for (const auto &kv : idx_to_req_id.second) {
+  for (size_t i = 0; i < batch_context.Size(); ++i) {
+    auto &slot = batch_context[i];
     try {
-      auto out = data[kv.first].unsqueeze(0);
+      auto out = data[i].unsqueeze(0);
       auto y_hat = torch::argmax(out, 1).item<int>();
       auto predicted_idx = std::to_string(y_hat);
-      auto response = (*response_batch)[kv.second];
 
-      response->SetResponse(200, "data_type",
-                            torchserve::PayloadType::kDATA_TYPE_STRING,
-                            mapping_json_->GetValue(predicted_idx).AsString());
+      slot.response->SetResponse(
+          200, "data_type", torchserve::PayloadType::kDATA_TYPE_STRING,
+          mapping_json_->GetValue(predicted_idx).AsString());
     } catch (const std::runtime_error &e) {
       TS_LOGF(ERROR, "Failed to load tensor for request id: {}, error: {}",
-              kv.second, e.what());
-      auto response = (*response_batch)[kv.second];
-      response->SetResponse(500, "data_type",
-                            torchserve::PayloadType::kDATA_TYPE_STRING,
-                            "runtime_error, failed to postprocess tensor");
+              slot.request_id, e.what());
+      batch_context.Fail(i, "runtime_error, failed to postprocess tensor");
     } catch (const c10::Error &e) {
       TS_LOGF(ERROR,
               "Failed to postprocess tensor for request id: {}, error: {}",
-              kv.second, e.msg());
-      auto response = (*response_batch)[kv.second];
-      response->SetResponse(500, "data_type",
-                            torchserve::PayloadType::kDATA_TYPE_STRING,
-                            "c10 error, failed to postprocess tensor");
+              slot.request_id, e.msg());
+      batch_context.Fail(i, "c10 error, failed to postprocess tensor");
     }
   }
 }
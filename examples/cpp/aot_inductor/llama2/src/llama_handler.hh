@@ -2,10 +2,10 @@
 
 #include <iostream>
 
-#include "src/backends/handler/base_handler.hh"
+#include "src/backends/handler/continuous_batching_handler.hh"
 
 namespace llm {
-class LlamaHandler : public torchserve::BaseHandler {
+class LlamaHandler : public torchserve::ContinuousBatchingHandler {
  public:
   // NOLINTBEGIN(bugprone-exception-escape)
   LlamaHandler() = default;
@@ -18,24 +18,14 @@ class LlamaHandler : public torchserve::BaseHandler {
       std::shared_ptr<torchserve::LoadModelRequest>& load_model_request)
       override;
 
-  c10::IValue Preprocess(
-      std::shared_ptr<torch::Device>& device,
-      std::pair<std::string&, std::map<uint8_t, std::string>&>& idx_to_req_id,
-      std::shared_ptr<torchserve::InferenceRequestBatch>& request_batch,
-      std::shared_ptr<torchserve::InferenceResponseBatch>& response_batch)
-      override;
+ protected:
+  std::shared_ptr<Sequence> StartSequence(
+      const std::string& prompt, std::shared_ptr<Sequence> previous) override;
 
-  c10::IValue Inference(
-      std::shared_ptr<void> model, c10::IValue& inputs,
-      std::shared_ptr<torch::Device>& device,
-      std::pair<std::string&, std::map<uint8_t, std::string>&>& idx_to_req_id,
-      std::shared_ptr<torchserve::InferenceResponseBatch>& response_batch)
-      override;
+  void Step(std::shared_ptr<void>& model,
+            std::vector<std::shared_ptr<Sequence>>& sequences) override;
 
-  void Postprocess(
-      c10::IValue& data,
-      std::pair<std::string&, std::map<uint8_t, std::string>&>& idx_to_req_id,
-      std::shared_ptr<torchserve::InferenceResponseBatch>& response_batch)
-      override;
+ private:
+  struct LlamaSequence;
 };
 }  // namespace llm
@@ -88,47 +88,43 @@ ResnetCppHandler::LoadModel(
 
 c10::IValue ResnetCppHandler::Preprocess(
     std::shared_ptr<torch::Device>& device,
-    std::pair<std::string&, std::map<uint8_t, std::string>&>& idx_to_req_id,
-    std::shared_ptr<torchserve::InferenceRequestBatch>& request_batch,
+    torchserve::BatchContext& batch_context,
+    std::shared_ptr<torchserve::InferenceRequestViewBatch>& request_batch,
     std::shared_ptr<torchserve::InferenceResponseBatch>& response_batch) {
   auto batch_ivalue = c10::impl::GenericList(c10::TensorType::get());
 
   std::vector<torch::Tensor> batch_tensors;
-  uint8_t idx = 0;
-  for (auto& request : *request_batch) {
-    (*response_batch)[request.request_id] =
-        std::make_shared<torchserve::InferenceResponse>(request.request_id);
-    idx_to_req_id.first += idx_to_req_id.first.empty()
-                               ? request.request_id
-                               : "," + request.request_id;
-    auto data_it =
-        request.parameters.find(torchserve::PayloadType::kPARAMETER_NAME_DATA);
-    auto dtype_it =
-        request.headers.find(torchserve::PayloadType::kHEADER_NAME_DATA_TYPE);
-    if (data_it == request.parameters.end()) {
-      data_it = request.parameters.find(
-          torchserve::PayloadType::kPARAMETER_NAME_BODY);
-      dtype_it =
-          request.headers.find(torchserve::PayloadType::kHEADER_NAME_BODY_TYPE);
+  batch_tensors.reserve(request_batch->requests.size());
+  for (auto& request : request_batch->requests) {
+    auto* response = &(*response_batch)[request.index];
+    auto data =
+        request.GetParameter(torchserve::PayloadType::kPARAMETER_NAME_DATA);
+    auto dtype =
+        request.GetHeader(torchserve::PayloadType::kHEADER_NAME_DATA_TYPE);
+    if (!data) {
+      data =
+          request.GetParameter(torchserve::PayloadType::kPARAMETER_NAME_BODY);
+      dtype =
+          request.GetHeader(torchserve::PayloadType::kHEADER_NAME_BODY_TYPE);
     }
 
-    if (data_it == request.parameters.end() ||
-        dtype_it == request.headers.end()) {
+    if (!data || !dtype) {
       TS_LOGF(ERROR, "Empty payload for request id: {}", request.request_id);
-      (*response_batch)[request.request_id]->SetResponse(
-          500, "data_type", torchserve::PayloadType::kCONTENT_TYPE_TEXT,
-          "Empty payload");
+      response->SetResponse(500, "data_type",
+                            torchserve::PayloadType::kCONTENT_TYPE_TEXT,
+                            "Empty payload");
       continue;
     }
 
     try {
-      if (dtype_it->second == torchserve::PayloadType::kDATA_TYPE_BYTES) {
+      if (*dtype == torchserve::PayloadType::kDATA_TYPE_BYTES) {
         batch_tensors.emplace_back(
-            torch::pickle_load(data_it->second).toTensor());
-        idx_to_req_id.second[idx++] = request.request_id;
+            torch::pickle_load(std::vector<char>(data->begin(), data->end()))
+                .toTensor());
+        batch_context.Add(request.request_id, response);
       } else {
         TS_LOG(ERROR, "Not supported input format, only support bytesstring in this example");
-        (*response_batch)[request.request_id]->SetResponse(
+        response->SetResponse(
           500, "data_type", torchserve::PayloadType::kCONTENT_TYPE_TEXT,
           "Not supported input format, only support bytesstring in this example");
         continue;
@@ -136,14 +132,12 @@ c10::IValue ResnetCppHandler::Preprocess(
     } catch (const std::runtime_error& e) {
       TS_LOGF(ERROR, "Failed to load tensor for request id: {}, error: {}",
               request.request_id, e.what());
-      auto response = (*response_batch)[request.request_id];
       response->SetResponse(500, "data_type",
                             torchserve::PayloadType::kDATA_TYPE_STRING,
                             "runtime_error, failed to load tensor");
     } catch (const c10::Error& e) {
       TS_LOGF(ERROR, "Failed to load tensor for request id: {}, c10 error: {}",
               request.request_id, e.msg());
-      auto response = (*response_batch)[request.request_id];
       response->SetResponse(500, "data_type",
                             torchserve::PayloadType::kDATA_TYPE_STRING,
                             "c10 error, failed to load tensor");
@@ -159,7 +153,7 @@ c10::IValue ResnetCppHandler::Preprocess(
 c10::IValue ResnetCppHandler::Inference(
     std::shared_ptr<void> model, c10::IValue &inputs,
     std::shared_ptr<torch::Device> &device,
-    std::pair<std::string &, std::map<uint8_t, std::string> &> &idx_to_req_id,
+    torchserve::BatchContext &batch_context,
     std::shared_ptr<torchserve::InferenceResponseBatch> &response_batch) {
   c10::InferenceMode mode;
   auto batch_ivalue = c10::impl::GenericList(c10::TensorType::get());
@@ -185,34 +179,28 @@ c10::IValue ResnetCppHandler::Inference(
 
 void ResnetCppHandler::Postprocess(
     c10::IValue &inputs,
-    std::pair<std::string &, std::map<uint8_t, std::string> &> &idx_to_req_id,
+    torchserve::BatchContext &batch_context,
     std::shared_ptr<torchserve::InferenceResponseBatch> &response_batch) {
   auto data = inputs.toTensorList().get(0);
   auto ps = torch::softmax(data[0], 1);
   auto top5 = torch::topk(ps, 5, 1);
-  for (const auto &kv : idx_to_req_id.second) {
+  for (size_t i = 0; i < batch_context.Size(); ++i) {
+    auto &slot = batch_context[i];
     try {
-      auto probs = std::get<0>(top5)[kv.first];
-      auto classes = std::get<1>(top5)[kv.first];
-      auto response = (*response_batch)[kv.second];
-      response->SetResponse(200, "data_type",
-                            torchserve::PayloadType::kDATA_TYPE_STRING,
-                            MapClassToLabel(classes, probs));
+      auto probs = std::get<0>(top5)[i];
+      auto classes = std::get<1>(top5)[i];
+      slot.response->SetResponse(200, "data_type",
+                                 torchserve::PayloadType::kDATA_TYPE_STRING,
+                                 MapClassToLabel(classes, probs));
     } catch (const std::runtime_error &e) {
       TS_LOGF(ERROR, "Failed to load tensor for request id: {}, error: {}",
-              kv.second, e.what());
-      auto response = (*response_batch)[kv.second];
-      response->SetResponse(500, "data_type",
-                            torchserve::PayloadType::kDATA_TYPE_STRING,
-                            "runtime_error, failed to postprocess tensor");
+              slot.request_id, e.what());
+      batch_context.Fail(i, "runtime_error, failed to postprocess tensor");
     } catch (const c10::Error &e) {
       TS_LOGF(ERROR,
               "Failed to postprocess tensor for request id: {}, error: {}",
-              kv.second, e.msg());
-      auto response = (*response_batch)[kv.second];
-      response->SetResponse(500, "data_type",
-                            torchserve::PayloadType::kDATA_TYPE_STRING,
-                            "c10 error, failed to postprocess tensor");
+              slot.request_id, e.msg());
+      batch_context.Fail(i, "c10 error, failed to postprocess tensor");
     }
   }
 }
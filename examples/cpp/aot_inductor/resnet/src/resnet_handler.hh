@@ -20,21 +20,20 @@ class ResnetCppHandler : public torchserve::BaseHandler {
 
   c10::IValue Preprocess(
     std::shared_ptr<torch::Device>& device,
-    std::pair<std::string&, std::map<uint8_t, std::string>&>& idx_to_req_id,
-    std::shared_ptr<torchserve::InferenceRequestBatch>& request_batch,
+    torchserve::BatchContext& batch_context,
+    std::shared_ptr<torchserve::InferenceRequestViewBatch>& request_batch,
     std::shared_ptr<torchserve::InferenceResponseBatch>& response_batch)
     override;
 
   c10::IValue Inference(
       std::shared_ptr<void> model, c10::IValue& inputs,
       std::shared_ptr<torch::Device>& device,
-      std::pair<std::string&, std::map<uint8_t, std::string>&>& idx_to_req_id,
+      torchserve::BatchContext& batch_context,
       std::shared_ptr<torchserve::InferenceResponseBatch>& response_batch)
       override;
 
   void Postprocess(
-      c10::IValue& data,
-      std::pair<std::string&, std::map<uint8_t, std::string>&>& idx_to_req_id,
+      c10::IValue& data, torchserve::BatchContext& batch_context,
       std::shared_ptr<torchserve::InferenceResponseBatch>& response_batch)
       override;
 
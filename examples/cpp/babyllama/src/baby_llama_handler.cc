@@ -1,6 +1,7 @@
 #include "baby_llama_handler.hh"
 
 #include <typeinfo>
+#include <vector>
 
 #include "src/utils/json.hh"
 
@@ -55,6 +56,10 @@ BabyLlamaHandler::LoadModel(
     build_sampler(&sampler, transformer.config.vocab_size, temperature, topp,
                   rng_seed);
 
+    // requires continuousBatching: true in the model config
+    continuous_batching_ = json.HasKey("continuous_batching") &&
+                           json.GetValue("continuous_batching").AsBool();
+
     return std::make_pair(nullptr, device);
   } catch (const c10::Error &e) {
     TS_LOGF(ERROR, "loading the model: {}, device id: {}, error: {}",
@@ -69,213 +74,97 @@ BabyLlamaHandler::LoadModel(
   }
 }
 
-c10::IValue BabyLlamaHandler::Preprocess(
-    std::shared_ptr<torch::Device> &device,
-    std::pair<std::string &, std::map<uint8_t, std::string> &> &idx_to_req_id,
-    std::shared_ptr<torchserve::InferenceRequestBatch> &request_batch,
-    std::shared_ptr<torchserve::InferenceResponseBatch> &response_batch) {
-  auto batch_ivalue = c10::impl::GenericList(torch::TensorType::get());
-  std::vector<torch::Tensor> batch_tensors;
-  uint8_t idx = 0;
-  for (auto &request : *request_batch) {
-    try {
-      (*response_batch)[request.request_id] =
-          std::make_shared<torchserve::InferenceResponse>(request.request_id);
-      idx_to_req_id.first += idx_to_req_id.first.empty()
-                                 ? request.request_id
-                                 : "," + request.request_id;
-
-      auto data_it = request.parameters.find(
-          torchserve::PayloadType::kPARAMETER_NAME_DATA);
-      auto dtype_it =
-          request.headers.find(torchserve::PayloadType::kHEADER_NAME_DATA_TYPE);
-      if (data_it == request.parameters.end()) {
-        data_it = request.parameters.find(
-            torchserve::PayloadType::kPARAMETER_NAME_BODY);
-        dtype_it = request.headers.find(
-            torchserve::PayloadType::kHEADER_NAME_BODY_TYPE);
-      }
-
-      if (data_it == request.parameters.end() ||
-          dtype_it == request.headers.end()) {
-        TS_LOGF(ERROR, "Empty payload for request id: {}", request.request_id);
-        (*response_batch)[request.request_id]->SetResponse(
-            500, "data_type", torchserve::PayloadType::kCONTENT_TYPE_TEXT,
-            "Empty payload");
-        continue;
-      }
-
-      std::string msg = torchserve::Converter::VectorToStr(data_it->second);
-
-      int num_prompt_tokens = 0;
-
-      std::unique_ptr<char[], void (*)(char *)> msgCStr(
-          new char[msg.size() + 1], [](char *ptr) { delete[] ptr; });
-
-      std::strcpy(msgCStr.get(), msg.c_str());
-
-      std::unique_ptr<int[]> prompt_tokens(new int[msg.length() + 3]);
-
-      encode(&tokenizer, msgCStr.get(), 1, 0, prompt_tokens.get(),
-             &num_prompt_tokens);
-
-      std::vector<torch::Tensor> tensor_vector;
-      for (int64_t i = 0; i < num_prompt_tokens; ++i) {
-        int token = prompt_tokens[i];
-        torch::Tensor tensor = torch::tensor(token, torch::kInt64);
-        tensor_vector.push_back(tensor);
-      }
-      batch_ivalue.emplace_back(torch::stack(tensor_vector));
-
-      idx_to_req_id.second[idx++] = request.request_id;
-    } catch (const std::runtime_error &e) {
-      TS_LOGF(ERROR, "Failed to load tensor for request id: {}, error: {}",
-              request.request_id, e.what());
-      auto response = (*response_batch)[request.request_id];
-      response->SetResponse(500, "data_type",
-                            torchserve::PayloadType::kDATA_TYPE_STRING,
-                            "runtime_error, failed to load tensor");
-    } catch (const c10::Error &e) {
-      TS_LOGF(ERROR, "Failed to load tensor for request id: {}, c10 error:{}",
-              request.request_id, e.msg());
-      auto response = (*response_batch)[request.request_id];
-      response->SetResponse(500, "data_type",
-                            torchserve::PayloadType::kDATA_TYPE_STRING,
-                            "c10 error, failed to load tensor");
-    }
+// A prompt being completed, with its own KV cache so that sequences can be
+// decoded in turn at every step. The next turn of a conversation continues
+// on the same KV cache.
+struct BabyLlamaHandler::LlamaSequence : public Sequence {
+  LlamaSequence(std::vector<int> prompt_tokens,
+                std::shared_ptr<RunState> state, int start_pos)
+      : prompt_tokens(std::move(prompt_tokens)),
+        state(std::move(state)),
+        token(this->prompt_tokens.front()),
+        start_pos(start_pos),
+        pos(start_pos) {}
+
+  size_t Bytes() const override {
+    const Config &config = transformer.config;
+    size_t kv_dim = config.dim * config.n_kv_heads / config.n_heads;
+    return Sequence::Bytes() +
+           2 * config.n_layers * config.seq_len * kv_dim * sizeof(float);
   }
 
-  return batch_ivalue;
-}
-
-c10::IValue BabyLlamaHandler::Inference(
-    std::shared_ptr<void> model, c10::IValue &inputs,
-    std::shared_ptr<torch::Device> &device,
-    std::pair<std::string &, std::map<uint8_t, std::string> &> &idx_to_req_id,
-    std::shared_ptr<torchserve::InferenceResponseBatch> &response_batch) {
-  torch::InferenceMode guard;
-  auto batch_output_vector = c10::impl::GenericList(torch::TensorType::get());
-  long batch_token_length = 0;
-  long start =
-      0;  // used to time our code, only initialized after first iteration
-
-  try {
-    for (auto input : inputs.toTensorList()) {
-      std::vector<torch::Tensor> tensor_vector;
-      tensor_vector.reserve(steps);
-      torch::Tensor tokens_list_tensor = input.get().toTensor();
-
-      int64_t num_elements = tokens_list_tensor.numel();
-
-      int64_t *data_ptr = tokens_list_tensor.data_ptr<int64_t>();
-
-      std::unique_ptr<int[]> prompt_tokens(new int[num_elements]);
-
-      for (int64_t i = 0; i < num_elements; ++i) {
-        prompt_tokens[i] = data_ptr[i];
-      }
-
-      // start the main loop
-      int next;  // will store the next token in the sequence
-      int token =
-          prompt_tokens[0];  // kick off with the first token in the prompt
-      int pos = 0;           // position in the sequence
-      while (pos < steps) {
-        // forward the transformer to get logits for the next token
-        float *logits = forward(&transformer, token, pos);
-
-        // advance the state state machine
-        if (pos < num_elements - 1) {
-          // if we are still processing the input prompt, force the next prompt
-          // token
-          next = prompt_tokens[pos + 1];
-        } else {
-          // otherwise sample the next token from the logits
-          next = sample(&sampler, logits);
-        }
-        pos++;
-
-        torch::Tensor tensor = torch::tensor(next, torch::kLong);
-        tensor_vector.push_back(tensor);
-
-        // data-dependent terminating condition: the BOS (=1) token delimits
-        // sequences
-        if (next == 1) {
-          break;
-        }
-        token = next;
-
-        // init the timer here because the first iteration can be slower
-        if (start == 0) {
-          start = time_in_ms();
-        }
-      }
-      batch_token_length = batch_token_length + pos - 1;
-
-      torch::Tensor stacked_tensor = torch::stack(tensor_vector);
-
-      batch_output_vector.push_back(stacked_tensor);
-    }
-
-    std::cout << "Total number of tokens generated: " << batch_token_length
-              << std::endl;
-    if (batch_token_length > 1) {
-      long end = time_in_ms();
-      double token_per_sec = batch_token_length / (double)(end - start) * 1000;
-      std::cout << "Achieved tok per sec: " << token_per_sec << std::endl;
-    }
-  } catch (std::runtime_error &e) {
-    TS_LOG(ERROR, e.what());
-  } catch (const c10::Error &e) {
-    TS_LOGF(ERROR, "Failed to apply inference on input, c10 error:{}", e.msg());
-  } catch (...) {
-    TS_LOG(ERROR, "Failed to run inference on this batch");
+  std::vector<int> prompt_tokens;
+  std::shared_ptr<RunState> state;
+  // the last token and its position in the sequence
+  int token;
+  // position of the first prompt token
+  int start_pos;
+  int pos;
+};
+
+std::shared_ptr<torchserve::ContinuousBatchingHandler::Sequence>
+BabyLlamaHandler::StartSequence(const std::string &prompt,
+                                std::shared_ptr<Sequence> previous) {
+  std::vector<char> text(prompt.begin(), prompt.end());
+  text.push_back('\0');
+  std::vector<int> prompt_tokens(prompt.length() + 3);
+  int num_prompt_tokens = 0;
+  encode(&tokenizer, text.data(), 0, 0, prompt_tokens.data(),
+         &num_prompt_tokens);
+  prompt_tokens.resize(num_prompt_tokens);
+
+  auto previous_sequence = std::static_pointer_cast<LlamaSequence>(previous);
+  if (previous_sequence &&
+      previous_sequence->pos + num_prompt_tokens < steps) {
+    // continue after the last token of the previous turn, whose KV cache
+    // holds everything before it
+    prompt_tokens.insert(prompt_tokens.begin(), previous_sequence->token);
+    return std::make_shared<LlamaSequence>(std::move(prompt_tokens),
+                                           previous_sequence->state,
+                                           previous_sequence->pos);
   }
-  return batch_output_vector;
-}
 
-void BabyLlamaHandler::Postprocess(
-    c10::IValue &outputs,
-    std::pair<std::string &, std::map<uint8_t, std::string> &> &idx_to_req_id,
-    std::shared_ptr<torchserve::InferenceResponseBatch> &response_batch) {
-  auto data = outputs.toTensorList();
-  for (const auto &kv : idx_to_req_id.second) {
-    try {
-      int64_t num_elements = data[kv.first].get().toTensor().numel();
-      int64_t *data_ptr = data[kv.first].get().toTensor().data_ptr<int64_t>();
-      int64_t token = 1;
-      std::string concatenated_string;
-      for (int64_t i = 0; i < num_elements; ++i) {
-        char *piece = decode(&tokenizer, token, data_ptr[i]);
-        std::string piece_string(piece);
-        token = data_ptr[i];
-        concatenated_string += piece_string;
-      }
-
-      std::cout << "Generated String:  " << concatenated_string << std::endl;
-
-      auto response = (*response_batch)[kv.second];
+  // BOS
+  prompt_tokens.insert(prompt_tokens.begin(), 1);
+  auto state = std::shared_ptr<RunState>(new RunState, [](RunState *state) {
+    free_run_state(state);
+    delete state;
+  });
+  malloc_run_state(state.get(), &transformer.config);
+  return std::make_shared<LlamaSequence>(std::move(prompt_tokens),
+                                         std::move(state), 0);
+}
 
-      response->SetResponse(200, "data_type",
-                            torchserve::PayloadType::kDATA_TYPE_STRING,
-                            concatenated_string);
-    } catch (const std::runtime_error &e) {
-      TS_LOGF(ERROR, "Failed to load tensor for request id: {}, error: {}",
-              kv.second, e.what());
-      auto response = (*response_batch)[kv.second];
-      response->SetResponse(500, "data_type",
-                            torchserve::PayloadType::kDATA_TYPE_STRING,
-                            "runtime_error, failed to postprocess tensor");
-    } catch (const c10::Error &e) {
-      TS_LOGF(ERROR,
-              "Failed to postprocess tensor for request id: {}, error: {}",
-              kv.second, e.msg());
-      auto response = (*response_batch)[kv.second];
-      response->SetResponse(500, "data_type",
-                            torchserve::PayloadType::kDATA_TYPE_STRING,
-                            "c10 error, failed to postprocess tensor");
-    }
+void BabyLlamaHandler::Step(
+    std::shared_ptr<void> &model,
+    std::vector<std::shared_ptr<Sequence>> &sequences) {
+  // forward runs on transformer.state, so each sequence swaps in its own
+  RunState shared_state = transformer.state;
+  for (auto &base_sequence : sequences) {
+    auto sequence = std::static_pointer_cast<LlamaSequence>(base_sequence);
+    auto num_prompt_tokens = static_cast<int>(sequence->prompt_tokens.size());
+    transformer.state = *sequence->state;
+    sequence->piece.clear();
+    bool prefill = false;
+    do {
+      // forward the transformer to get logits for the next token
+      float *logits = forward(&transformer, sequence->token, sequence->pos);
+
+      // force the prompt tokens, then sample from the logits
+      int prompt_pos = sequence->pos - sequence->start_pos;
+      prefill = prompt_pos < num_prompt_tokens - 1;
+      int next = prefill ? sequence->prompt_tokens[prompt_pos + 1]
+                         : sample(&sampler, logits);
+      sequence->piece += decode(&tokenizer, sequence->token, next);
+      sequence->pos++;
+      sequence->token = next;
+
+      // data-dependent terminating condition: the BOS (=1) token delimits
+      // sequences
+      sequence->finished = next == 1 || sequence->pos >= steps;
+    } while (prefill && !sequence->finished);
   }
+  transformer.state = shared_state;
 }
 
 BabyLlamaHandler::~BabyLlamaHandler() noexcept {
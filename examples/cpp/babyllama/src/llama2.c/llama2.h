@@ -101,6 +101,8 @@ typedef struct {
     unsigned long long rng_state;
 } Sampler;
 void build_transformer(Transformer *t, char* checkpoint_path);
+void malloc_run_state(RunState* s, Config* p);
+void free_run_state(RunState* s);
 void build_tokenizer(Tokenizer* t, char* tokenizer_path, int vocab_size);
 void build_sampler(Sampler* sampler, int vocab_size, float temperature, float topp, unsigned long long rng_seed);
 void encode(Tokenizer* t, char *text, int8_t bos, int8_t eos, int *tokens, int *n_tokens);
@@ -62,43 +62,37 @@ LlamaCppHandler::LoadModel(
 
 c10::IValue LlamaCppHandler::Preprocess(
     std::shared_ptr<torch::Device>& device,
-    std::pair<std::string&, std::map<uint8_t, std::string>&>& idx_to_req_id,
-    std::shared_ptr<torchserve::InferenceRequestBatch>& request_batch,
+    torchserve::BatchContext& batch_context,
+    std::shared_ptr<torchserve::InferenceRequestViewBatch>& request_batch,
     std::shared_ptr<torchserve::InferenceResponseBatch>& response_batch) {
   initialize_context();
 
   auto batch_ivalue = c10::impl::GenericList(torch::TensorType::get());
   std::vector<torch::Tensor> batch_tensors;
-  uint8_t idx = 0;
-  for (auto& request : *request_batch) {
+  for (auto& request : request_batch->requests) {
+    auto* response = &(*response_batch)[request.index];
     try {
-      (*response_batch)[request.request_id] =
-          std::make_shared<torchserve::InferenceResponse>(request.request_id);
-      idx_to_req_id.first += idx_to_req_id.first.empty()
-                                 ? request.request_id
-                                 : "," + request.request_id;
 
-      auto data_it = request.parameters.find(
+      auto data = request.GetParameter(
           torchserve::PayloadType::kPARAMETER_NAME_DATA);
-      auto dtype_it =
-          request.headers.find(torchserve::PayloadType::kHEADER_NAME_DATA_TYPE);
-      if (data_it == request.parameters.end()) {
-        data_it = request.parameters.find(
+      auto dtype =
+          request.GetHeader(torchserve::PayloadType::kHEADER_NAME_DATA_TYPE);
+      if (!data) {
+        data = request.GetParameter(
             torchserve::PayloadType::kPARAMETER_NAME_BODY);
-        dtype_it = request.headers.find(
+        dtype = request.GetHeader(
             torchserve::PayloadType::kHEADER_NAME_BODY_TYPE);
       }
 
-      if (data_it == request.parameters.end() ||
-          dtype_it == request.headers.end()) {
+      if (!data || !dtype) {
         TS_LOGF(ERROR, "Empty payload for request id: {}", request.request_id);
-        (*response_batch)[request.request_id]->SetResponse(
-            500, "data_type", torchserve::PayloadType::kCONTENT_TYPE_TEXT,
-            "Empty payload");
+        response->SetResponse(500, "data_type",
+                              torchserve::PayloadType::kCONTENT_TYPE_TEXT,
+                              "Empty payload");
         continue;
       }
 
-      std::string msg = torchserve::Converter::VectorToStr(data_it->second);
+      std::string msg(*data);
 
       // tokenization
 
@@ -121,19 +115,17 @@ c10::IValue LlamaCppHandler::Preprocess(
 
       torch::Tensor stacked_tensor = torch::stack(tensor_vector);
       batch_ivalue.push_back(stacked_tensor);
-      idx_to_req_id.second[idx++] = request.request_id;
+      batch_context.Add(request.request_id, response);
 
     } catch (const std::runtime_error& e) {
       TS_LOGF(ERROR, "Failed to load tensor for request id: {}, error: {}",
               request.request_id, e.what());
-      auto response = (*response_batch)[request.request_id];
       response->SetResponse(500, "data_type",
                             torchserve::PayloadType::kDATA_TYPE_STRING,
                             "runtime_error, failed to load tensor");
     } catch (const c10::Error& e) {
       TS_LOGF(ERROR, "Failed to load tensor for request id: {}, c10 error: {}",
               request.request_id, e.msg());
-      auto response = (*response_batch)[request.request_id];
       response->SetResponse(500, "data_type",
                             torchserve::PayloadType::kDATA_TYPE_STRING,
                             "c10 error, failed to load tensor");
@@ -146,7 +138,7 @@ c10::IValue LlamaCppHandler::Preprocess(
 c10::IValue LlamaCppHandler::Inference(
     std::shared_ptr<void> model, c10::IValue& inputs,
     std::shared_ptr<torch::Device>& device,
-    std::pair<std::string&, std::map<uint8_t, std::string>&>& idx_to_req_id,
+    torchserve::BatchContext& batch_context,
     std::shared_ptr<torchserve::InferenceResponseBatch>& response_batch) {
   torch::InferenceMode guard;
   auto batch_output_vector = c10::impl::GenericList(torch::TensorType::get());
@@ -228,45 +220,37 @@ c10::IValue LlamaCppHandler::Inference(
 }
 
 void LlamaCppHandler::Postprocess(
-    c10::IValue& output,
-    std::pair<std::string&, std::map<uint8_t, std::string>&>& idx_to_req_id,
+    c10::IValue& output, torchserve::BatchContext& batch_context,
     std::shared_ptr<torchserve::InferenceResponseBatch>& response_batch) {
-  for (const auto& kv : idx_to_req_id.second) {
-    auto data = output.toTensorList();
+  auto data = output.toTensorList();
+  for (size_t i = 0; i < batch_context.Size(); ++i) {
+    auto& slot = batch_context[i];
     try {
-      int64_t num_elements = data[kv.first].get().toTensor().numel();
+      int64_t num_elements = data[i].get().toTensor().numel();
 
       // Convert the tensor to a vector of long values
       std::stringstream generated_text_stream;
 
-      auto data_ptr = data[kv.first].get().toTensor().data_ptr<int64_t>();
-      for (int64_t i = 0; i < num_elements; ++i) {
-        generated_text_stream << llama_token_to_piece(llama_ctx, data_ptr[i]);
+      auto data_ptr = data[i].get().toTensor().data_ptr<int64_t>();
+      for (int64_t j = 0; j < num_elements; ++j) {
+        generated_text_stream << llama_token_to_piece(llama_ctx, data_ptr[j]);
       }
 
       std::string generated_text_str = generated_text_stream.str();
       TS_LOGF(DEBUG, "Generated Text Str: {}", generated_text_str);
 
-      auto response = (*response_batch)[kv.second];
-
-      response->SetResponse(200, "data_type",
-                            torchserve::PayloadType::kDATA_TYPE_STRING,
-                            generated_text_str);
+      slot.response->SetResponse(200, "data_type",
+                                 torchserve::PayloadType::kDATA_TYPE_STRING,
+                                 generated_text_str);
     } catch (const std::runtime_error& e) {
       TS_LOGF(ERROR, "Failed to load tensor for request id: {}, error: {}",
-              kv.second, e.what());
-      auto response = (*response_batch)[kv.second];
-      response->SetResponse(500, "data_type",
-                            torchserve::PayloadType::kDATA_TYPE_STRING,
-                            "runtime_error, failed to postprocess tensor");
+              slot.request_id, e.what());
+      batch_context.Fail(i, "runtime_error, failed to postprocess tensor");
     } catch (const c10::Error& e) {
       TS_LOGF(ERROR,
               "Failed to postprocess tensor for request id: {}, error: {}",
-              kv.second, e.msg());
-      auto response = (*response_batch)[kv.second];
-      response->SetResponse(500, "data_type",
-                            torchserve::PayloadType::kDATA_TYPE_STRING,
-                            "c10 error, failed to postprocess tensor");
+              slot.request_id, e.msg());
+      batch_context.Fail(i, "c10 error, failed to postprocess tensor");
     }
   }
 }
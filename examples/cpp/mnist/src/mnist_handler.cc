@@ -2,31 +2,24 @@
 
 namespace mnist {
 void MnistHandler::Postprocess(
-    c10::IValue& data,
-    std::pair<std::string&, std::map<uint8_t, std::string>&>& idx_to_req_id,
+    c10::IValue& data, torchserve::BatchContext& batch_context,
     std::shared_ptr<torchserve::InferenceResponseBatch>& response_batch) {
   auto data_tensor = data.toTensor();
-  for (const auto& kv : idx_to_req_id.second) {
+  for (size_t i = 0; i < batch_context.Size(); ++i) {
+    auto& slot = batch_context[i];
     try {
-      auto response = (*response_batch)[kv.second];
-      response->SetResponse(
+      slot.response->SetResponse(
           200, "data_tpye", torchserve::PayloadType::kDATA_TYPE_BYTES,
-          torch::pickle_save(torch::argmax(data_tensor[kv.first])));
+          torch::pickle_save(torch::argmax(data_tensor[i])));
     } catch (const std::runtime_error& e) {
-      LOG(ERROR) << "Failed to load tensor for request id:" << kv.second
+      LOG(ERROR) << "Failed to load tensor for request id:" << slot.request_id
                  << ", error: " << e.what();
-      auto response = (*response_batch)[kv.second];
-      response->SetResponse(500, "data_tpye",
-                            torchserve::PayloadType::kDATA_TYPE_STRING,
-                            "runtime_error, failed to load tensor");
+      batch_context.Fail(i, "runtime_error, failed to load tensor");
       throw e;
     } catch (const c10::Error& e) {
-      LOG(ERROR) << "Failed to load tensor for request id:" << kv.second
+      LOG(ERROR) << "Failed to load tensor for request id:" << slot.request_id
                  << ", c10 error: " << e.msg();
-      auto response = (*response_batch)[kv.second];
-      response->SetResponse(500, "data_tpye",
-                            torchserve::PayloadType::kDATA_TYPE_STRING,
-                            "c10 error, failed to load tensor");
+      batch_context.Fail(i, "c10 error, failed to load tensor");
       throw e;
     }
   }
@@ -252,6 +252,9 @@ public class WorkerLifeCycle {
         }
         argl.add("--metrics_config_path");
         argl.add(configManager.getMetricsConfigPath());
+        // pins the CPU instances of each worker to different cores, 0-indexed
+        argl.add("--worker_index");
+        argl.add(String.valueOf(this.currNumRunningWorkers));
 
         String[] envp = EnvironmentUtils.getCppEnvString(cppBackendLib.getAbsolutePath());
 